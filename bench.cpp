@@ -0,0 +1,909 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "include/vector2.hpp"
+#include "include/vector3.hpp"
+#include "include/vector_array.hpp"
+#include "include/vector_functions.hpp"
+#include "include/vector_expression.hpp"
+#include "include/dot_product_matrix.hpp"
+#include "include/distance_matrix.hpp"
+#include "include/quantized.hpp"
+#include "include/matrix.hpp"
+#include "include/quaternion.hpp"
+#include "include/mesh.hpp"
+#include "include/integrate.hpp"
+#include "include/barnes_hut.hpp"
+#include "include/normalize.hpp"
+#include "include/reduction.hpp"
+#include "include/vector_text.hpp"
+#include "include/kd_tree.hpp"
+#include "include/spatial_hash.hpp"
+#include "include/dynamic_vector.hpp"
+#include "include/sparse_vector.hpp"
+#include "include/hnsw.hpp"
+#include "include/accumulate.hpp"
+#include "include/magnitude.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Results are printed as a JSON array, one object per line, so they can be diffed between commits.
+// Sizes are the bytes of a single input array, chosen to sit in L1, L2, L3 & DRAM respectively.
+
+static const std::size_t batch_bytes[] = {16 << 10, 256 << 10, 4 << 20, 64 << 20};
+static const double min_seconds = 0.05;
+
+static std::mt19937 random_eng;
+static bool first_result = true;
+static volatile double sink;
+
+struct Magn {
+	template <class T>
+	T operator()(T x, T y) const
+	{
+		return std::hypot(x, y);
+	}
+
+	template <class T>
+	T operator()(T x, T y, T z) const
+	{
+		return std::hypot(x, y, z);
+	}
+
+	template <class T>
+	T operator()(T dot_prod) const
+	{
+		return std::sqrt(dot_prod);
+	}
+};
+
+template <class V>
+std::vector<V> random_vectors(std::size_t count)
+{
+	using T = typename V::scalar;
+	std::uniform_real_distribution<double> range(-20.0, 20.0);
+	std::vector<V> vcs(count);
+	for (auto& vc : vcs)
+		for (auto k = 0U; k < V::SIZE; k++)
+			vc[k] = static_cast<T>(range(random_eng));
+	return vcs;
+}
+
+void report(const char* type, const char* op, std::size_t bytes, std::size_t elements, double seconds, std::size_t bytes_moved)
+{
+	double ns_per_op = seconds * 1e9 / elements;
+	std::printf("%s\n  {\"type\": \"%s\", \"op\": \"%s\", \"batch_bytes\": %zu, \"elements\": %zu, "
+		"\"ns_per_op\": %.4f, \"gb_per_s\": %.4f, \"elements_per_s\": %.1f}",
+		first_result ? "[" : ",", type, op, bytes, elements,
+		ns_per_op, bytes_moved / seconds / 1e9, elements / seconds);
+	first_result = false;
+}
+
+// Runs body over the whole batch until at least min_seconds have passed.
+// bytes_per_element is what body reads plus what it writes for one element.
+template <class F>
+void measure(const char* type, const char* op, std::size_t bytes, std::size_t count, std::size_t bytes_per_element, F body)
+{
+	using clock = std::chrono::steady_clock;
+	body(); // warm up, fault in pages
+
+	std::size_t reps = 0;
+	auto start = clock::now();
+	double elapsed = 0;
+	do {
+		body();
+		reps++;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < min_seconds);
+
+	report(type, op, bytes, count * reps, elapsed, count * reps * bytes_per_element);
+}
+
+template <class V>
+void bench_type(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto lhs = random_vectors<V>(count);
+		auto rhs = random_vectors<V>(count);
+		std::vector<V> out(count);
+		std::vector<T> scalars(count);
+		T factor = static_cast<T>(3);
+
+		measure(type, "operator+=", bytes, count, 3 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] += rhs[i];
+		});
+		measure(type, "operator+", bytes, count, 3 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = lhs[i] + rhs[i];
+		});
+		measure(type, "operator-", bytes, count, 3 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = lhs[i] - rhs[i];
+		});
+		measure(type, "operator*", bytes, count, 2 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = lhs[i] * factor;
+		});
+		measure(type, "dot_product", bytes, count, 2 * sizeof(V) + sizeof(T), [&] {
+			for (auto i = 0U; i < count; i++)
+				scalars[i] = MathVector::dot_product(lhs[i], rhs[i]);
+		});
+		// A run time index that changes every element, so it can't be resolved while compiling
+		measure(type, "operator[]", bytes, count, sizeof(V) + sizeof(T), [&] {
+			for (auto i = 0U; i < count; i++)
+				scalars[i] = lhs[i][i % V::SIZE];
+		});
+		measure(type, "is_trivial", bytes, count, sizeof(V) + sizeof(T), [&] {
+			for (auto i = 0U; i < count; i++)
+				scalars[i] = MathVector::is_trivial(lhs[i]);
+		});
+
+		if constexpr (std::is_floating_point_v<T>) {
+			Magn magn;
+			measure(type, "magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				for (auto i = 0U; i < count; i++)
+					scalars[i] = MathVector::magnitude(lhs[i], magn);
+			});
+			measure(type, "squared_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				for (auto i = 0U; i < count; i++)
+					scalars[i] = MathVector::squared_magnitude(lhs[i]);
+			});
+			measure(type, "magnitude no functor", bytes, count, sizeof(V) + sizeof(T), [&] {
+				for (auto i = 0U; i < count; i++)
+					scalars[i] = MathVector::magnitude(lhs[i]);
+			});
+			measure(type, "fast_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				for (auto i = 0U; i < count; i++)
+					scalars[i] = MathVector::fast_magnitude(lhs[i]);
+			});
+			measure(type, "scaled_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				for (auto i = 0U; i < count; i++)
+					scalars[i] = MathVector::scaled_magnitude(lhs[i]);
+			});
+			measure(type, "batch_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				MathVector::batch_magnitude(lhs, scalars);
+			});
+			measure(type, "batch_fast_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				MathVector::batch_fast_magnitude(lhs, scalars);
+			});
+			measure(type, "batch_scaled_magnitude", bytes, count, sizeof(V) + sizeof(T), [&] {
+				MathVector::batch_scaled_magnitude(lhs, scalars);
+			});
+			measure(type, "unit_vector", bytes, count, 2 * sizeof(V), [&] {
+				for (auto i = 0U; i < count; i++)
+					out[i] = MathVector::unit_vector(lhs[i], magn).value_or(lhs[i]);
+			});
+			measure(type, "normalize_batch", bytes, count, 2 * sizeof(V), [&] {
+				MathVector::normalize_batch(MathVector::Span<const V>(lhs), MathVector::Span<V>(out));
+			});
+			measure(type, "normalize_batch fast", bytes, count, 2 * sizeof(V), [&] {
+				MathVector::normalize_batch<MathVector::FastNormalization>(MathVector::Span<const V>(lhs), MathVector::Span<V>(out));
+			});
+		}
+
+		sink = static_cast<double>(out[count / 2][0] + scalars[count / 2]);
+	}
+}
+
+// a + b * s - c, eager temporaries against a fused lazy expression
+template <class V>
+void bench_expression(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto a = random_vectors<V>(count);
+		auto b = random_vectors<V>(count);
+		auto c = random_vectors<V>(count);
+		std::vector<V> out(count);
+		T factor = static_cast<T>(3);
+
+		measure(type, "a+b*s-c eager", bytes, count, 4 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = a[i] + b[i] * factor - c[i];
+		});
+		measure(type, "a+b*s-c lazy", bytes, count, 4 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = MathVector::lazy(a[i]) + MathVector::lazy(b[i]) * factor - c[i];
+		});
+
+		sink = static_cast<double>(out[count / 2][0]);
+	}
+}
+
+// Every query against every corpus vector, pair at a time against the tiled, threaded kernel.
+// Elements are pairs, bytes are the corpus streamed once per query for the pair loop & once overall for the matrix.
+template <class V>
+void bench_dot_matrix(const char* type)
+{
+	using T = typename V::scalar;
+	const std::size_t query_count = 64;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto queries = random_vectors<V>(query_count);
+		auto corpus = random_vectors<V>(count);
+		std::vector<T> out(query_count * count);
+		std::vector<double> wide(query_count * count);
+
+		measure(type, "dot_product pairs", bytes, query_count * count, sizeof(V) + sizeof(T), [&] {
+			for (auto i = 0U; i < query_count; i++)
+				for (auto j = 0U; j < count; j++)
+					out[i * count + j] = MathVector::dot_product(queries[i], corpus[j]);
+		});
+		measure(type, "dot_product_matrix", bytes, query_count * count, sizeof(V) / query_count + sizeof(T), [&] {
+			MathVector::dot_product_matrix(MathVector::Span<const V>(queries), MathVector::Span<const V>(corpus), MathVector::Span<T>(out));
+		});
+		measure(type, "distance pairs", bytes, query_count * count, sizeof(V) + sizeof(T), [&] {
+			for (auto i = 0U; i < query_count; i++)
+				for (auto j = 0U; j < count; j++)
+					out[i * count + j] = MathVector::dot_product(queries[i] - corpus[j], queries[i] - corpus[j]);
+		});
+		measure(type, "squared_distance_matrix", bytes, query_count * count, sizeof(V) / query_count + sizeof(T), [&] {
+			MathVector::squared_distance_matrix(MathVector::Span<const V>(queries), MathVector::Span<const V>(corpus), MathVector::Span<T>(out));
+		});
+		measure(type, "squared_distance_matrix double", bytes, query_count * count, sizeof(V) / query_count + sizeof(double), [&] {
+			MathVector::squared_distance_matrix(MathVector::Span<const V>(queries), MathVector::Span<const V>(corpus), MathVector::Span<double>(wide));
+		});
+		measure(type, "nearest_rows 10", bytes, query_count * count, sizeof(V) / query_count, [&] {
+			sink = static_cast<double>(MathVector::nearest_rows(queries, corpus, 10).back().squared_distance);
+		});
+
+		sink = static_cast<double>(out[out.size() / 2]);
+	}
+}
+
+// Centroid by a serial loop of operator+= against summarize, which also finds bounds & magnitudes
+template <class V>
+void bench_reduction(const char* type)
+{
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto vcs = random_vectors<V>(count);
+		V total;
+
+		measure(type, "operator+= sum", bytes, count, sizeof(V), [&] {
+			total = V();
+			for (auto k = 0U; k < V::SIZE; k++)
+				total[k] = 0;
+			for (auto i = 0U; i < count; i++)
+				total += vcs[i];
+			sink = static_cast<double>(total[0]);
+		});
+		measure(type, "summarize", bytes, count, sizeof(V), [&] {
+			total = MathVector::summarize(vcs).sum;
+		});
+
+		sink = static_cast<double>(total[0]);
+	}
+}
+
+template <class V>
+void bench_text(const char* type)
+{
+	for (auto bytes : batch_bytes) {
+		// Here bytes is the length of the text, about 9 characters a field
+		std::size_t count = bytes / (V::SIZE * 9);
+		auto vcs = random_vectors<V>(count);
+		std::string text;
+		char field[32];
+		for (auto& vc : vcs) {
+			for (auto k = 0U; k < V::SIZE; k++) {
+				std::snprintf(field, sizeof(field), k + 1 < V::SIZE ? "%.4f " : "%.4f\n", static_cast<double>(vc[k]));
+				text += field;
+			}
+		}
+		std::size_t per_row = text.size() / count;
+
+		measure(type, "istringstream", bytes, count, per_row + sizeof(V), [&] {
+			std::istringstream in(text);
+			V vc;
+			vcs.clear();
+			while (in >> vc[0]) {
+				for (auto k = 1U; k < V::SIZE; k++)
+					in >> vc[k];
+				vcs.push_back(vc);
+			}
+		});
+		measure(type, "parse_vectors", bytes, count, per_row + sizeof(V), [&] {
+			vcs = MathVector::parse_vectors<V>(text).vectors;
+		});
+
+		sink = static_cast<double>(vcs.back()[0]);
+	}
+}
+
+template <class V>
+void bench_kd_tree(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		// Here bytes is the size of the point set, each op is one query
+		std::size_t count = bytes / sizeof(V);
+		auto points = random_vectors<V>(count);
+		auto queries = random_vectors<V>(4096);
+		MathVector::KdTree<V> tree(points);
+
+		measure(type, "nearest brute force", bytes, 16, sizeof(V) * count, [&] {
+			for (auto q = 0U; q < 16; q++) {
+				T best = std::numeric_limits<T>::max();
+				for (auto& vc : points)
+					best = std::min(best, MathVector::dot_product(vc - queries[q], vc - queries[q]));
+				sink = static_cast<double>(best);
+			}
+		});
+		measure(type, "KdTree build", bytes, count, sizeof(V), [&] {
+			MathVector::KdTree<V> built(points);
+			sink = static_cast<double>(built.size());
+		});
+		measure(type, "KdTree nearest", bytes, queries.size(), sizeof(V), [&] {
+			for (auto& query : queries)
+				sink = static_cast<double>(tree.nearest(query, 1)[0].squared_distance);
+		});
+		measure(type, "KdTree batch_nearest 8", bytes, queries.size(), sizeof(V), [&] {
+			sink = static_cast<double>(tree.batch_nearest(queries, 8).back().squared_distance);
+		});
+	}
+}
+
+template <class V>
+void bench_spatial_hash(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		// Points spread over a cube sized so each has about 10 neighbors within the radius
+		std::size_t count = bytes / sizeof(V);
+		auto points = random_vectors<V>(count);
+		T radius = static_cast<T>(40.0 * std::cbrt(10.0 / (4.19 * count)));
+		MathVector::SpatialHash<V> grid(radius);
+
+		if (count <= 1 << 15) {
+			measure(type, "pairs O(n^2)", bytes, count, sizeof(V), [&] {
+				std::size_t pairs = 0;
+				for (auto i = 0U; i < count; i++)
+					for (auto j = i + 1; j < count; j++)
+						pairs += MathVector::dot_product(points[i] - points[j], points[i] - points[j]) <= radius * radius;
+				sink = static_cast<double>(pairs);
+			});
+		}
+		measure(type, "SpatialHash build", bytes, count, 2 * sizeof(V), [&] {
+			grid.build(points);
+		});
+		measure(type, "SpatialHash build+pairs", bytes, count, 2 * sizeof(V), [&] {
+			grid.build(points);
+			std::size_t pairs = 0;
+			grid.for_each_pair([&](std::size_t, std::size_t, T) {
+				pairs++;
+			});
+			sink = static_cast<double>(pairs);
+		});
+	}
+}
+
+template <class V>
+void bench_quantized(const char* type)
+{
+	constexpr std::size_t N = V::SIZE;
+	for (auto bytes : batch_bytes) {
+		// bytes is the size of the float corpus, the compressed copies are smaller
+		std::size_t count = bytes / sizeof(V);
+		auto corpus = random_vectors<V>(count);
+		V query = random_vectors<V>(1)[0];
+		std::vector<MathVector::Int8Vector<N>> int8_corpus;
+		std::vector<MathVector::HalfVector<N>> half_corpus;
+		for (auto& vc : corpus) {
+			int8_corpus.push_back(MathVector::quantize_int8(vc));
+			half_corpus.push_back(MathVector::quantize_half(vc));
+		}
+		auto int8_query = MathVector::quantize_int8(query);
+		auto half_query = MathVector::quantize_half(query);
+		float best = 0;
+
+		measure(type, "dot_product float", bytes, count, sizeof(V), [&] {
+			for (auto& vc : corpus)
+				best = std::max(best, MathVector::dot_product(query, vc));
+		});
+		measure(type, "dot_product int8", bytes, count, sizeof(MathVector::Int8Vector<N>), [&] {
+			for (auto& vc : int8_corpus)
+				best = std::max(best, MathVector::dot_product(int8_query, vc));
+		});
+		measure(type, "squared_distance int8", bytes, count, sizeof(MathVector::Int8Vector<N>), [&] {
+			for (auto& vc : int8_corpus)
+				best = std::max(best, MathVector::squared_distance(int8_query, vc));
+		});
+		measure(type, "dot_product half", bytes, count, sizeof(MathVector::HalfVector<N>), [&] {
+			for (auto& vc : half_corpus)
+				best = std::max(best, MathVector::dot_product(half_query, vc));
+		});
+
+		sink = best;
+	}
+}
+
+// Rotate, scale & translate every point, by hand per point against the batched kernels
+template <class V>
+void bench_transform(const char* type)
+{
+	using T = typename V::scalar;
+	constexpr std::size_t N = V::SIZE;
+	V axis{};
+	axis[N - 1] = 1;
+	auto transform = MathVector::Affine<T, N>::translation(random_vectors<V>(1)[0])
+		* MathVector::Affine<T, N>{MathVector::rotation(axis, T(0.5))}
+		* MathVector::Affine<T, N>::scaling(T(2));
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto points = random_vectors<V>(count);
+		MathVector::VectorSoA<V> soa(points.begin(), points.end());
+		std::vector<V> out(count);
+
+		measure(type, "affine per point", bytes, count, 2 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = transform(points[i]);
+		});
+		measure(type, "transform_points aos", bytes, count, 2 * sizeof(V), [&] {
+			MathVector::transform_points(transform, MathVector::Span<const V>(points), MathVector::Span<V>(out));
+		});
+		measure(type, "transform_points soa", bytes, count, 2 * sizeof(V), [&] {
+			MathVector::transform_points(transform, soa);
+		});
+
+		sink = static_cast<double>(out[count / 2][0] + soa[count / 2][0]);
+	}
+}
+
+// Rotation of every vector by its own quaternion, through a matrix built per element against the batched kernels
+template <class V>
+void bench_quaternion(const char* type)
+{
+	using T = typename V::scalar;
+	typedef MathVector::Quaternion<T> Q;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto vcs = random_vectors<V>(count);
+		auto axes = random_vectors<V>(count);
+		std::vector<Q> qs(count);
+		for (auto i = 0U; i < count; i++) {
+			T length = std::sqrt(MathVector::dot_product(axes[i], axes[i]));
+			qs[i] = Q::from_axis_angle(axes[i] * (1 / length), axes[i][0]);
+		}
+		MathVector::VectorSoA<V> soa(vcs.begin(), vcs.end());
+		MathVector::VectorSoA<Q> soa_qs(qs.begin(), qs.end());
+		std::vector<V> out(count);
+
+		measure(type, "matrix per element", bytes, count, 2 * sizeof(V) + sizeof(Q), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = qs[i].matrix() * vcs[i];
+		});
+		measure(type, "rotate per element", bytes, count, 2 * sizeof(V) + sizeof(Q), [&] {
+			for (auto i = 0U; i < count; i++)
+				out[i] = MathVector::rotate(qs[i], vcs[i]);
+		});
+		measure(type, "rotate_batch aos", bytes, count, 2 * sizeof(V) + sizeof(Q), [&] {
+			MathVector::rotate_batch(MathVector::Span<const Q>(qs), MathVector::Span<const V>(vcs), MathVector::Span<V>(out));
+		});
+		measure(type, "rotate_batch soa", bytes, count, 2 * sizeof(V) + sizeof(Q), [&] {
+			MathVector::rotate_batch(soa_qs, soa);
+		});
+		measure(type, "rotate_batch one quaternion", bytes, count, 2 * sizeof(V), [&] {
+			MathVector::rotate_batch(qs[0], MathVector::Span<const V>(vcs), MathVector::Span<V>(out));
+		});
+
+		sink = static_cast<double>(out[count / 2][0] + soa[count / 2][0]);
+	}
+}
+
+// Vertex normals of a grid mesh, scattering face normals into the vertices serially against the
+// adjacency based kernels. Elements are triangles, bytes is the size of the vertex array.
+template <class V>
+void bench_mesh(const char* type)
+{
+	using T = typename V::scalar;
+	typedef MathVector::Triangle<std::uint32_t> Tri;
+	for (auto bytes : batch_bytes) {
+		auto side = static_cast<std::uint32_t>(std::sqrt(double(bytes / sizeof(V))));
+		auto vertices = random_vectors<V>(side * side);
+		std::vector<Tri> triangles;
+		for (auto y = 0U; y + 1 < side; y++) {
+			for (auto x = 0U; x + 1 < side; x++) {
+				std::uint32_t i = y * side + x;
+				triangles.push_back({i, i + 1, i + side + 1});
+				triangles.push_back({i, i + side + 1, i + side});
+			}
+		}
+		MathVector::Span<const V> vertex_span(vertices);
+		MathVector::Span<const Tri> triangle_span(triangles);
+		MathVector::VertexTriangles adjacency(vertices.size(), triangle_span);
+		std::vector<V> normals(vertices.size()), faces(triangles.size());
+		std::vector<T> areas(triangles.size());
+		std::size_t count = triangles.size();
+
+		measure(type, "vertex normals serial scatter", bytes, count, 3 * sizeof(V) + sizeof(Tri), [&] {
+			for (auto& n : normals)
+				n = V{};
+			for (auto& t : triangles) {
+				V cross = MathVector::cross_product(vertices[t[1]] - vertices[t[0]], vertices[t[2]] - vertices[t[0]]);
+				for (auto corner : t)
+					normals[corner] += cross;
+			}
+			MathVector::normalize_batch(normals);
+		});
+		measure(type, "vertex_normals", bytes, count, 3 * sizeof(V) + sizeof(Tri), [&] {
+			MathVector::vertex_normals(vertex_span, triangle_span, adjacency, MathVector::Span<V>(normals));
+		});
+		measure(type, "VertexTriangles build", bytes, count, sizeof(Tri), [&] {
+			adjacency.build(vertices.size(), triangle_span);
+		});
+		measure(type, "face_normals", bytes, count, 3 * sizeof(V) + sizeof(Tri), [&] {
+			MathVector::face_normals(vertex_span, triangle_span, MathVector::Span<V>(faces));
+		});
+		measure(type, "face_areas", bytes, count, 3 * sizeof(V) + sizeof(Tri), [&] {
+			MathVector::face_areas(vertex_span, triangle_span, MathVector::Span<T>(areas));
+		});
+
+		sink = static_cast<double>(normals[count / 4][0] + faces[count / 2][0] + areas[count / 2]);
+	}
+}
+
+// A tick of semi-implicit Euler with operator+= & operator* per particle against the fused SoA steppers
+template <class V>
+void bench_integrate(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		// bytes is the size of one of the three arrays
+		std::size_t count = bytes / sizeof(V);
+		auto x = random_vectors<V>(count);
+		auto v = random_vectors<V>(count);
+		auto a = random_vectors<V>(count);
+		MathVector::VectorSoA<V> xs(x.begin(), x.end()), vs(v.begin(), v.end()), as(a.begin(), a.end());
+		T dt = T(1e-3);
+		V gravity{};
+		gravity[V::SIZE - 1] = T(-9.8);
+
+		measure(type, "operators per particle", bytes, count, 5 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++) {
+				v[i] += a[i] * dt;
+				x[i] += v[i] * dt;
+			}
+		});
+		measure(type, "euler_step", bytes, count, 5 * sizeof(V), [&] {
+			MathVector::euler_step(xs, vs, as, dt);
+		});
+		measure(type, "semi_implicit_euler_step", bytes, count, 5 * sizeof(V), [&] {
+			MathVector::semi_implicit_euler_step(xs, vs, as, dt);
+		});
+		measure(type, "semi_implicit_euler_step uniform", bytes, count, 4 * sizeof(V), [&] {
+			MathVector::semi_implicit_euler_step(xs, vs, gravity, dt);
+		});
+		measure(type, "velocity_verlet_step", bytes, count, 8 * sizeof(V), [&] {
+			MathVector::velocity_verlet_step(xs, vs, as, dt, [](const MathVector::VectorSoA<V>&, MathVector::VectorSoA<V>&) {});
+		});
+
+		sink = static_cast<double>(x[count / 2][0] + xs[count / 2][0]);
+	}
+}
+
+// One step of accelerations for a cloud of bodies, direct O(n^2) sum against Barnes-Hut build & walk
+template <class V>
+void bench_barnes_hut(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto bodies = random_vectors<V>(count);
+		std::vector<T> masses(count, T(1));
+		std::vector<V> out(count);
+		MathVector::Span<const V> body_span(bodies);
+		MathVector::Span<const T> mass_span(masses);
+		MathVector::BarnesHut<V> tree(body_span, mass_span);
+
+		if (count <= 1 << 14) {
+			measure(type, "pairwise_accelerations", bytes, count, sizeof(V), [&] {
+				MathVector::pairwise_accelerations(body_span, mass_span, MathVector::Span<V>(out), T(0.01));
+			});
+		}
+		measure(type, "BarnesHut build", bytes, count, sizeof(V) + sizeof(T), [&] {
+			tree.build(body_span, mass_span);
+		});
+		measure(type, "BarnesHut accelerations", bytes, count, sizeof(V), [&] {
+			tree.accelerations(MathVector::Span<V>(out), T(0.5), T(0.01));
+		});
+
+		sink = static_cast<double>(out[count / 2][0]);
+	}
+}
+
+// The same vectors as Vector<T, N>, as DynamicVector, as views of one flat buffer & as the
+// std::vector with a plain loop the dynamic types replace
+template <class V>
+void bench_dynamic(const char* type)
+{
+	using T = typename V::scalar;
+	constexpr std::size_t N = V::SIZE;
+	typedef MathVector::DynamicVector<T> D;
+	for (auto bytes : batch_bytes) {
+		std::size_t count = bytes / sizeof(V);
+		auto fixed = random_vectors<V>(count);
+		V query = random_vectors<V>(1)[0];
+		std::vector<D> dynamic;
+		std::vector<std::vector<T>> plain;
+		std::vector<T> flat;
+		for (auto& vc : fixed) {
+			dynamic.emplace_back(vc);
+			plain.emplace_back(vc.begin(), vc.end());
+			flat.insert(flat.end(), vc.begin(), vc.end());
+		}
+		D dynamic_query(query);
+		std::vector<T> plain_query(query.begin(), query.end());
+		D out(N);
+		T best = 0;
+
+		measure(type, "dot_product Vector", bytes, count, sizeof(V), [&] {
+			for (auto& vc : fixed)
+				best = std::max(best, MathVector::dot_product(query, vc));
+		});
+		measure(type, "dot_product DynamicVector", bytes, count, sizeof(V), [&] {
+			for (auto& vc : dynamic)
+				best = std::max(best, MathVector::dot_product(dynamic_query, vc));
+		});
+		measure(type, "dot_product VectorView", bytes, count, sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				best = std::max(best, MathVector::dot_product(dynamic_query, MathVector::VectorView<const T>(flat.data() + i * N, N)));
+		});
+		measure(type, "dot_product std::vector", bytes, count, sizeof(V), [&] {
+			for (auto& vc : plain) {
+				T dot = 0;
+				for (auto k = 0U; k < vc.size(); k++)
+					dot += plain_query[k] * vc[k];
+				best = std::max(best, dot);
+			}
+		});
+		measure(type, "operator+ DynamicVector", bytes, count, 2 * sizeof(V), [&] {
+			for (auto& vc : dynamic)
+				out = vc + dynamic_query;
+		});
+		measure(type, "operator+ std::vector", bytes, count, 2 * sizeof(V), [&] {
+			for (auto& vc : plain) {
+				std::vector<T> sum(vc);
+				for (auto k = 0U; k < sum.size(); k++)
+					sum[k] += plain_query[k];
+				out[0] = sum[0];
+			}
+		});
+		measure(type, "operator+= VectorView", bytes, count, 3 * sizeof(V), [&] {
+			for (auto i = 0U; i < count; i++)
+				MathVector::VectorView<T>(flat.data() + i * N, N) += dynamic_query;
+		});
+		sink = static_cast<double>(best + out[0] + flat[0]);
+	}
+}
+
+// A corpus at 1% density, as dense vectors & as SparseVector, against a dense query, a query
+// of the same density (merged) & one with 4 components (galloped)
+template <class V>
+void bench_sparse(const char* type)
+{
+	using T = typename V::scalar;
+	constexpr std::size_t N = V::SIZE;
+	typedef MathVector::SparseVector<T> S;
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	auto sparsify = [&](V vc, double density) {
+		for (auto& x : vc)
+			if (chance(random_eng) >= density)
+				x = 0;
+		return vc;
+	};
+	for (auto bytes : batch_bytes) {
+		// bytes is the size of the dense corpus
+		std::size_t count = bytes / sizeof(V);
+		auto dense = random_vectors<V>(count);
+		std::vector<S> sparse;
+		std::size_t sparse_bytes = 0;
+		for (auto& vc : dense) {
+			vc = sparsify(vc, 0.01);
+			sparse.emplace_back(vc);
+			sparse_bytes += sparse.back().nonzeros() * (sizeof(T) + sizeof(std::uint32_t));
+		}
+		V query = random_vectors<V>(1)[0];
+		S sparse_query(sparsify(query, 0.01));
+		S short_query(sparsify(query, 4.0 / N));
+		std::size_t per_vector = sparse_bytes / count;
+		T best = 0;
+		bool trivial = false;
+
+		measure(type, "dot_product dense", bytes, count, sizeof(V), [&] {
+			for (auto& vc : dense)
+				best = std::max(best, MathVector::dot_product(query, vc));
+		});
+		measure(type, "dot_product sparse-dense", bytes, count, per_vector, [&] {
+			for (auto& vc : sparse)
+				best = std::max(best, MathVector::dot_product(vc, query));
+		});
+		measure(type, "dot_product sparse-sparse merge", bytes, count, per_vector, [&] {
+			for (auto& vc : sparse)
+				best = std::max(best, MathVector::dot_product(vc, sparse_query));
+		});
+		measure(type, "dot_product sparse-sparse gallop", bytes, count, per_vector, [&] {
+			for (auto& vc : sparse)
+				best = std::max(best, MathVector::dot_product(vc, short_query));
+		});
+		measure(type, "is_trivial dense", bytes, count, sizeof(V), [&] {
+			for (auto& vc : dense)
+				trivial |= MathVector::is_trivial(vc);
+		});
+		measure(type, "operator+ sparse", bytes, count, 3 * per_vector, [&] {
+			for (auto& vc : sparse)
+				best = std::max(best, (vc + sparse_query).values()[0]);
+		});
+		sink = static_cast<double>(best) + trivial;
+	}
+}
+
+template <class V>
+void bench_hnsw(const char* type)
+{
+	using T = typename V::scalar;
+	const std::size_t k = 10;
+	MathVector::HnswParameters parameters;
+	parameters.ef_construction = 100;
+	// Building from 64MB of points takes minutes, so stop at the L3 sized set
+	for (auto bytes : {batch_bytes[0], batch_bytes[1], batch_bytes[2]}) {
+		// Here bytes is the size of the point set, each op is one query
+		std::size_t count = bytes / sizeof(V);
+		auto points = random_vectors<V>(count);
+		auto queries = random_vectors<V>(1024);
+		auto exact = MathVector::nearest_rows(queries, points, k);
+		MathVector::HnswIndex<V> index(points, parameters);
+
+		measure(type, "HnswIndex build", bytes, count, sizeof(V), [&] {
+			MathVector::HnswIndex<V> built(points, parameters);
+			sink = static_cast<double>(built.size());
+		});
+		measure(type, "nearest_rows brute force", bytes, queries.size(), sizeof(V) * count, [&] {
+			sink = static_cast<double>(MathVector::nearest_rows(queries, points, k).back().squared_distance);
+		});
+		for (std::size_t ef : {16, 64, 256}) {
+			// Recall counts a result as found when it's no farther than the exact kth nearest
+			auto found = index.batch_nearest(queries, k, ef);
+			std::size_t hits = 0;
+			for (auto q = 0U; q < queries.size(); q++)
+				for (auto i = 0U; i < k; i++)
+					hits += found[q * k + i].squared_distance <= exact[q * k + k - 1].squared_distance * T(1.0001);
+			auto op = "HnswIndex nearest ef " + std::to_string(ef) + " recall@10 "
+				+ std::to_string(static_cast<double>(hits) / found.size()).substr(0, 5);
+			measure(type, op.c_str(), bytes, queries.size(), sizeof(V), [&] {
+				for (auto& query : queries)
+					sink = static_cast<double>(index.nearest(query, k, ef)[0].squared_distance);
+			});
+			measure(type, ("HnswIndex batch_nearest ef " + std::to_string(ef)).c_str(), bytes, queries.size(), sizeof(V), [&] {
+				sink = static_cast<double>(index.batch_nearest(queries, k, ef).back().squared_distance);
+			});
+		}
+	}
+}
+
+template <class Policy, class V>
+void bench_accumulation_policy(const char* type, const char* name, std::size_t bytes, const std::vector<V>& vcs, const V& query)
+{
+	// Mean error relative to the sum of the products' magnitudes, against a long double sum
+	double error = 0;
+	std::size_t sampled = std::min<std::size_t>(vcs.size(), 64);
+	for (auto i = 0U; i < sampled; i++) {
+		long double exact = 0, absolute = 0;
+		for (auto k = 0U; k < V::SIZE; k++) {
+			long double product = static_cast<long double>(vcs[i][k]) * query[k];
+			exact += product;
+			absolute += std::fabs(product);
+		}
+		auto sum = MathVector::dot_product<Policy>(vcs[i], query);
+		error += static_cast<double>(std::fabs(static_cast<long double>(sum) - exact) / absolute);
+	}
+	char op[96];
+	std::snprintf(op, sizeof(op), "dot_product %s error %.2e", name, error / sampled);
+
+	double best = 0;
+	measure(type, op, bytes, vcs.size(), sizeof(V), [&] {
+		for (auto& vc : vcs)
+			best = std::max(best, static_cast<double>(MathVector::dot_product<Policy>(vc, query)));
+	});
+	sink = best;
+}
+
+template <class V>
+void bench_accumulation(const char* type)
+{
+	using T = typename V::scalar;
+	for (auto bytes : batch_bytes) {
+		// bytes is the size of the corpus, each op is one dot product with the query
+		std::size_t count = std::max<std::size_t>(bytes / sizeof(V), 1);
+		auto vcs = random_vectors<V>(count);
+		V query = random_vectors<V>(1)[0];
+		// Integers span all of short, so their products overflow an int sum
+		if constexpr (std::is_integral_v<T>) {
+			for (auto& vc : vcs)
+				for (auto& x : vc)
+					x *= 1600;
+			for (auto& x : query)
+				x *= 1600;
+		}
+		bench_accumulation_policy<MathVector::SerialAccumulation>(type, "serial", bytes, vcs, query);
+		bench_accumulation_policy<MathVector::UnrolledAccumulation>(type, "unrolled", bytes, vcs, query);
+		bench_accumulation_policy<MathVector::PairwiseAccumulation>(type, "pairwise", bytes, vcs, query);
+		bench_accumulation_policy<MathVector::CompensatedAccumulation>(type, "compensated", bytes, vcs, query);
+		bench_accumulation_policy<MathVector::WidenedAccumulation>(type, "widened", bytes, vcs, query);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// Pass a type name, e.g. "Vector3<float>", to only run that type.
+	const char* only = argc > 1 ? argv[1] : nullptr;
+	auto run = [only](const char* type, void (*fn)(const char*)) {
+		if (!only || std::strcmp(only, type) == 0)
+			fn(type);
+	};
+
+	run("Vector2<float>", bench_type<MathVector::Vector2<float>>);
+	run("Vector2<double>", bench_type<MathVector::Vector2<double>>);
+	run("Vector3<float>", bench_type<MathVector::Vector3<float>>);
+	run("Vector3<double>", bench_type<MathVector::Vector3<double>>);
+	run("Vector3<int>", bench_type<MathVector::Vector3<int>>);
+	run("Vector<float,4>", bench_type<MathVector::Vector<float, 4>>);
+	run("Vector<float,16>", bench_type<MathVector::Vector<float, 16>>);
+	run("Vector<double,8>", bench_type<MathVector::Vector<double, 8>>);
+	run("Vector<float,256>", bench_type<MathVector::Vector<float, 256>>);
+	run("Vector<double,64>", bench_type<MathVector::Vector<double, 64>>);
+	run("Vector<int,8>", bench_type<MathVector::Vector<int, 8>>);
+	run("Vector<double,64> expression", bench_expression<MathVector::Vector<double, 64>>);
+	run("Vector3<float> reduction", bench_reduction<MathVector::Vector3<float>>);
+	run("Vector3<float> text", bench_text<MathVector::Vector3<float>>);
+	run("Vector3<double> kd tree", bench_kd_tree<MathVector::Vector3<double>>);
+	run("Vector3<float> spatial hash", bench_spatial_hash<MathVector::Vector3<float>>);
+	run("Vector3<float> transform", bench_transform<MathVector::Vector3<float>>);
+	run("Vector3<double> quaternion", bench_quaternion<MathVector::Vector3<double>>);
+	run("Vector3<float> mesh", bench_mesh<MathVector::Vector3<float>>);
+	run("Vector3<float> integrate", bench_integrate<MathVector::Vector3<float>>);
+	run("Vector3<double> barnes hut", bench_barnes_hut<MathVector::Vector3<double>>);
+	run("Vector<float,8> dynamic", bench_dynamic<MathVector::Vector<float, 8>>);
+	run("Vector<float,768> dynamic", bench_dynamic<MathVector::Vector<float, 768>>);
+	run("Vector<float,4096> sparse", bench_sparse<MathVector::Vector<float, 4096>>);
+	run("Vector<float,64> hnsw", bench_hnsw<MathVector::Vector<float, 64>>);
+	run("Vector<float,4096> accumulation", bench_accumulation<MathVector::Vector<float, 4096>>);
+	run("Vector<int,4096> accumulation", bench_accumulation<MathVector::Vector<int, 4096>>);
+	run("Vector<float,768> quantized", bench_quantized<MathVector::Vector<float, 768>>);
+	run("Vector<float,128> matrix", bench_dot_matrix<MathVector::Vector<float, 128>>);
+
+	std::printf("%s\n", first_result ? "[]" : "\n]");
+	return 0;
+}
@@ -0,0 +1,277 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_ACCUMULATE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_ACCUMULATE_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "unroll.hpp"
+#include "vector_functions.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace MathVector {
+
+// Accumulation policies for dot_product<Policy>, each sums the products of two arrays.
+// accumulator<T> is the type the sum is kept & returned in.
+
+namespace detail {
+
+// Independent pack accumulators, so consecutive adds don't wait on each other
+constexpr std::size_t dot_accumulators = 4;
+
+// Loads T & multiplies in the wider W, P is a pack of W
+template <class P, class W, class T>
+inline W unrolled_dot(const T* lhs, const T* rhs, std::size_t n)
+{
+	W accumulated_val = 0;
+	std::size_t i = 0;
+	// Integer sums are the same in any order, so the compiler vectorizes the plain loop
+	if constexpr (!std::is_integral_v<W>) {
+		constexpr std::size_t WIDTH = P::width;
+		typename P::type acc[dot_accumulators];
+		for (auto& a : acc)
+			a = P::zero();
+		for (; i + dot_accumulators * WIDTH <= n; i += dot_accumulators * WIDTH)
+			MathVector::unroll<dot_accumulators>([&](auto r) {
+				acc[r] = P::fmadd(P::load(lhs + i + r * WIDTH), P::load(rhs + i + r * WIDTH), acc[r]);
+			});
+		for (; i + WIDTH <= n; i += WIDTH)
+			acc[0] = P::fmadd(P::load(lhs + i), P::load(rhs + i), acc[0]);
+		accumulated_val = P::hsum(P::add(P::add(acc[0], acc[1]), P::add(acc[2], acc[3])));
+	}
+	for (; i < n; i++)
+		accumulated_val += static_cast<W>(lhs[i]) * static_cast<W>(rhs[i]);
+	return accumulated_val;
+}
+
+// Knuth's two-sum: sum + x exactly as the new sum plus what its rounding lost,
+// which is added to error. Gives Neumaier's correction without comparing magnitudes.
+template <class P>
+inline void two_sum(typename P::type& sum, typename P::type& error, typename P::type x)
+{
+	auto t = P::add(sum, x);
+	auto z = P::sub(t, sum);
+	error = P::add(error, P::add(P::sub(sum, P::sub(t, z)), P::sub(x, z)));
+	sum = t;
+}
+
+// a * b rounded, & exactly what the rounding lost. A fused multiply add gives the loss directly,
+// without one Dekker's product splits both factors into halves whose products are exact.
+template <class P, class T>
+inline void exact_product(typename P::type a, typename P::type b, typename P::type& product, typename P::type& error)
+{
+#if defined(__FMA__)
+	// The product is a fused multiply add of zero too, as a plain multiply could be
+	// contracted into the adds of the two-sum & then wouldn't match the error
+	if constexpr (P::width == 1) {
+		product = std::fma(a, b, T(0));
+		error = std::fma(a, b, -product);
+	} else {
+		product = P::fmadd(a, b, P::zero());
+		error = P::fmadd(a, b, P::sub(P::zero(), product));
+	}
+#else
+	constexpr T factor = static_cast<T>((1ULL << ((std::numeric_limits<T>::digits + 1) / 2)) + 1);
+	auto split = [](typename P::type x, typename P::type& hi, typename P::type& lo) {
+		auto c = P::mul(P::set1(factor), x);
+		hi = P::sub(c, P::sub(c, x));
+		lo = P::sub(x, hi);
+	};
+	typename P::type a_hi, a_lo, b_hi, b_lo;
+	split(a, a_hi, a_lo);
+	split(b, b_hi, b_lo);
+	product = P::mul(a, b);
+	error = P::sub(P::mul(a_hi, b_hi), product);
+	error = P::add(error, P::mul(a_hi, b_lo));
+	error = P::add(error, P::mul(a_lo, b_hi));
+	error = P::add(error, P::mul(a_lo, b_lo));
+#endif
+}
+
+// Adds a * b to the compensated sum, the product's rounding included
+template <class P, class T>
+inline void compensated_step(typename P::type& sum, typename P::type& error, typename P::type a, typename P::type b)
+{
+	typename P::type product, product_error;
+	exact_product<P, T>(a, b, product, product_error);
+	error = P::add(error, product_error);
+	two_sum<P>(sum, error, product);
+}
+
+// Pack of W able to load T directly, e.g. double lanes from floats
+template <class W, class T, class = void>
+struct loading_pack {
+	using type = simd::scalar_pack<W>;
+};
+
+template <class W, class T>
+struct loading_pack<W, T, std::void_t<decltype(static_cast<void>(simd::pack<W>::load(std::declval<const T*>())))>> {
+	using type = simd::pack<W>;
+};
+
+// Vectors with contiguous components
+template <class V, class = void>
+constexpr bool has_data = false;
+
+template <class V>
+constexpr bool has_data<V, std::void_t<decltype(std::declval<const V&>().data())>> = true;
+
+}
+
+// One running sum in component order, the same result on every target
+struct SerialAccumulation {
+	template <class T>
+	using accumulator = T;
+
+	template <class T>
+	static T sum_products(const T* lhs, const T* rhs, std::size_t n)
+	{
+		T accumulated_val = 0;
+		for (std::size_t i = 0; i < n; i++)
+			accumulated_val += lhs[i] * rhs[i];
+		return accumulated_val;
+	}
+};
+
+// Four independent SIMD accumulators, the fastest. The error grows with n like the serial sum,
+// but every lane only adds n / (4 * width) of the products.
+struct UnrolledAccumulation {
+	template <class T>
+	using accumulator = T;
+
+	template <class T>
+	static T sum_products(const T* lhs, const T* rhs, std::size_t n)
+	{
+		return detail::unrolled_dot<simd::pack<T>, T>(lhs, rhs, n);
+	}
+};
+
+// Halves are summed recursively & added, so the error grows with log n instead of n.
+// Blocks of up to BLOCK products are summed unrolled, which keeps the speed close to it.
+struct PairwiseAccumulation {
+	static constexpr std::size_t BLOCK = 256;
+
+	template <class T>
+	using accumulator = T;
+
+	template <class T>
+	static T sum_products(const T* lhs, const T* rhs, std::size_t n)
+	{
+		if (n <= BLOCK || std::is_integral_v<T>)
+			return detail::unrolled_dot<simd::pack<T>, T>(lhs, rhs, n);
+		std::size_t half = (n / 2 + BLOCK - 1) / BLOCK * BLOCK;
+		return sum_products(lhs, rhs, half) + sum_products(lhs + half, rhs + half, n - half);
+	}
+};
+
+// Neumaier compensated sum in every lane, with the products' rounding compensated as well.
+// About as accurate as summing in twice the precision & rounding once, unless the products
+// cancel to almost nothing. Several times the work of the unrolled sum.
+struct CompensatedAccumulation {
+	template <class T>
+	using accumulator = T;
+
+	template <class T>
+	static T sum_products(const T* lhs, const T* rhs, std::size_t n)
+	{
+		// Integers round nothing
+		if constexpr (std::is_integral_v<T>)
+			return detail::unrolled_dot<simd::pack<T>, T>(lhs, rhs, n);
+		using P = simd::pack<T>;
+		using S = simd::scalar_pack<T>;
+		constexpr std::size_t WIDTH = P::width;
+		typename P::type sum[2] = {P::zero(), P::zero()}, error[2] = {P::zero(), P::zero()};
+		std::size_t i = 0;
+		for (; i + 2 * WIDTH <= n; i += 2 * WIDTH)
+			unroll<2>([&](auto r) {
+				detail::compensated_step<P, T>(sum[r], error[r], P::load(lhs + i + r * WIDTH), P::load(rhs + i + r * WIDTH));
+			});
+		for (; i + WIDTH <= n; i += WIDTH)
+			detail::compensated_step<P, T>(sum[0], error[0], P::load(lhs + i), P::load(rhs + i));
+
+		// The lanes are combined with the same two-sum, so nothing is lost folding them
+		T sum_lanes[2][WIDTH], error_lanes[2][WIDTH];
+		T total = 0, total_error = 0;
+		for (auto r = 0U; r < 2; r++) {
+			P::store(sum_lanes[r], sum[r]);
+			P::store(error_lanes[r], error[r]);
+			for (auto l = 0U; l < WIDTH; l++) {
+				detail::two_sum<S>(total, total_error, sum_lanes[r][l]);
+				total_error += error_lanes[r][l];
+			}
+		}
+		for (; i < n; i++)
+			detail::compensated_step<S, T>(total, total_error, lhs[i], rhs[i]);
+		return total + total_error;
+	}
+};
+
+// Sums in a wider type: integers in 64 bits & floats in double, where their products
+// are exact. Integers of up to 16 bits never overflow below 2^32 components, 32 bit ones
+// while the sum fits. Doubles have nothing wider with SIMD & are summed as unrolled.
+struct WidenedAccumulation {
+	template <class T>
+	using accumulator = std::conditional_t<std::is_floating_point_v<T>,
+		std::conditional_t<(sizeof(T) < sizeof(double)), double, T>,
+		std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+	template <class T>
+	static accumulator<T> sum_products(const T* lhs, const T* rhs, std::size_t n)
+	{
+		using W = accumulator<T>;
+		return detail::unrolled_dot<typename detail::loading_pack<W, T>::type, W>(lhs, rhs, n);
+	}
+};
+
+// Sum of lhs[i] * rhs[i] over n components, accumulated as Policy says
+template <class Policy, class T>
+auto dot_product(const T* lhs, const T* rhs, std::size_t n)
+{
+	return Policy::sum_products(lhs, rhs, n);
+}
+
+template <class Policy, class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+auto dot_product(const T& lhs, const T& rhs)
+{
+	using S = typename T::scalar;
+	if constexpr (detail::has_data<T>) {
+		return Policy::sum_products(lhs.data(), rhs.data(), T::SIZE);
+	} else {
+		// Vector2 & Vector3 keep their components as members
+		S a[T::SIZE], b[T::SIZE];
+		for_each_index<T::SIZE>([&](auto i) {
+			a[i] = lhs[i];
+			b[i] = rhs[i];
+		});
+		return Policy::sum_products(a, b, T::SIZE);
+	}
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_ACCUMULATE_HPP_INCLUDED
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_ALIGNED_ALLOCATOR_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_ALIGNED_ALLOCATOR_HPP_INCLUDED
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace MathVector {
+
+// Allocator handing out storage aligned to at least ALIGNMENT bytes,
+// so whole cache lines & SIMD registers can be loaded from the start of a buffer.
+template <class T, std::size_t ALIGNMENT = 64>
+struct AlignedAllocator {
+	static_assert(ALIGNMENT >= alignof(T) && (ALIGNMENT & (ALIGNMENT - 1)) == 0,
+		"ALIGNMENT must be a power of two no smaller than alignof(T)");
+
+	using value_type = T;
+
+	template <class U>
+	struct rebind {
+		using other = AlignedAllocator<U, ALIGNMENT>;
+	};
+
+	constexpr AlignedAllocator() noexcept = default;
+
+	template <class U>
+	constexpr AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)));
+	}
+
+	void deallocate(T* p, std::size_t) noexcept
+	{
+		::operator delete(p, std::align_val_t(ALIGNMENT));
+	}
+};
+
+template <class T, class U, std::size_t A>
+constexpr bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&)
+{
+	return true;
+}
+
+template <class T, class U, std::size_t A>
+constexpr bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&)
+{
+	return false;
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_ALIGNED_ALLOCATOR_HPP_INCLUDED
@@ -0,0 +1,207 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_ARENA_ALLOCATOR_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_ARENA_ALLOCATOR_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace MathVector {
+
+// Bump allocator over large blocks. Freeing single allocations does nothing,
+// everything is released together by reset, which keeps the blocks for reuse.
+// Not thread safe, give each thread its own arena, e.g. thread_arena().
+class Arena {
+public:
+	static constexpr std::size_t BLOCK_ALIGNMENT = 64;
+
+	explicit Arena(std::size_t block_size = 1 << 20) noexcept : block_size(std::max<std::size_t>(block_size, 64)) {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena()
+	{
+		release();
+	}
+
+	void* allocate(std::size_t bytes, std::size_t alignment)
+	{
+		for (;;) {
+			if (current < blocks.size()) {
+				auto base = reinterpret_cast<std::uintptr_t>(blocks[current].data);
+				auto start = (base + offset + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+				if (start + bytes <= base + blocks[current].size) {
+					offset = start + bytes - base;
+					return reinterpret_cast<void*>(start);
+				}
+				if (current + 1 < blocks.size()) {
+					current++;
+					offset = 0;
+					continue;
+				}
+			}
+			grow(bytes + alignment);
+		}
+	}
+
+	// Makes all the memory available again. If the last round needed more than one
+	// block they're replaced by one large enough for everything, so the next round
+	// of the same size makes no heap calls at all.
+	void reset()
+	{
+		if (blocks.size() > 1) {
+			std::size_t total = capacity();
+			release();
+			add_block(total);
+		}
+		current = 0;
+		offset = 0;
+	}
+
+	// Frees every block
+	void release() noexcept
+	{
+		for (auto& block : blocks)
+			::operator delete(block.data, std::align_val_t(BLOCK_ALIGNMENT));
+		blocks.clear();
+		current = 0;
+		offset = 0;
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		std::size_t total = 0;
+		for (auto& block : blocks)
+			total += block.size;
+		return total;
+	}
+
+	// Number of blocks requested from the heap over the arena's lifetime
+	std::size_t heap_allocations() const noexcept
+	{
+		return allocations;
+	}
+
+private:
+	struct Block {
+		char* data;
+		std::size_t size;
+	};
+
+	void grow(std::size_t bytes)
+	{
+		std::size_t size = blocks.empty() ? block_size : blocks.back().size * 2;
+		add_block(std::max(size, bytes));
+		current = blocks.size() - 1;
+		offset = 0;
+	}
+
+	void add_block(std::size_t size)
+	{
+		auto data = static_cast<char*>(::operator new(size, std::align_val_t(BLOCK_ALIGNMENT)));
+		blocks.push_back({data, size});
+		allocations++;
+	}
+
+	std::vector<Block> blocks;
+	std::size_t block_size;
+	std::size_t current = 0;
+	std::size_t offset = 0;
+	std::size_t allocations = 0;
+};
+
+// Arena owned by the calling thread
+inline Arena& thread_arena()
+{
+	thread_local Arena arena;
+	return arena;
+}
+
+// Standard allocator handing out ALIGNMENT aligned memory from an Arena.
+// Default constructed allocators use the constructing thread's thread_arena().
+template <class T, std::size_t ALIGNMENT = 64>
+class ArenaAllocator {
+public:
+	static_assert(ALIGNMENT >= alignof(T) && (ALIGNMENT & (ALIGNMENT - 1)) == 0,
+		"ALIGNMENT must be a power of two no smaller than alignof(T)");
+
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	template <class U>
+	struct rebind {
+		using other = ArenaAllocator<U, ALIGNMENT>;
+	};
+
+	ArenaAllocator() noexcept : source(&thread_arena()) {}
+	explicit ArenaAllocator(Arena& arena) noexcept : source(&arena) {}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U, ALIGNMENT>& other) noexcept : source(&other.arena()) {}
+
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(source->allocate(n * sizeof(T), ALIGNMENT));
+	}
+
+	void deallocate(T*, std::size_t) noexcept {}
+
+	Arena& arena() const noexcept
+	{
+		return *source;
+	}
+
+private:
+	Arena* source;
+};
+
+template <class T, class U, std::size_t A>
+bool operator==(const ArenaAllocator<T, A>& lhs, const ArenaAllocator<U, A>& rhs) noexcept
+{
+	return &lhs.arena() == &rhs.arena();
+}
+
+template <class T, class U, std::size_t A>
+bool operator!=(const ArenaAllocator<T, A>& lhs, const ArenaAllocator<U, A>& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+// std::vector of vectors drawing from an arena
+template <class V, std::size_t ALIGNMENT = 64>
+using ArenaVector = std::vector<V, ArenaAllocator<V, ALIGNMENT>>;
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_ARENA_ALLOCATOR_HPP_INCLUDED
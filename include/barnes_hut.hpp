@@ -0,0 +1,419 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_BARNES_HUT_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_BARNES_HUT_HPP_INCLUDED
+
+#include "reduction.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+// out[i] = sum over j of masses[j] (positions[j] - positions[i]) / (|positions[j] - positions[i]|^2 + softening^2)^(3/2),
+// the O(n^2) sum Barnes-Hut approximates. Bodies at the same position don't act on each other.
+template <class V>
+void pairwise_accelerations(Span<const V> positions, Span<const typename V::scalar> masses, Span<V> out,
+	typename V::scalar softening = 0, ThreadPool& pool = default_pool())
+{
+	using T = typename V::scalar;
+	assert(masses.size() == positions.size() && out.size() == positions.size());
+	T eps = softening * softening;
+	parallel_for_chunks(positions.size(), 64, [&](std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; i++) {
+			T acc[3] = {0, 0, 0};
+			for (auto j = 0U; j < positions.size(); j++) {
+				T d[3] = {positions[j][0] - positions[i][0], positions[j][1] - positions[i][1], positions[j][2] - positions[i][2]};
+				T squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+				if (squared == 0)
+					continue;
+				squared += eps;
+				T scale = masses[j] / (squared * std::sqrt(squared));
+				for (auto k = 0U; k < 3; k++)
+					acc[k] += scale * d[k];
+			}
+			for (auto k = 0U; k < 3; k++)
+				out[i][k] = acc[k];
+		}
+	}, pool);
+}
+
+// Octree over bodies in three space for approximating the field of inverse square forces, gravity
+// or electrostatics. Masses may be negative, a cell is summarized by its total mass at the center
+// of its bodies weighted by |mass|. Bodies are sorted along a Morton curve, cells are contiguous
+// runs of them, & the nodes live in one array in depth first order, each knowing where its subtree
+// ends, so the walk needs no stack & neighboring bodies walk neighboring nodes.
+template <class V>
+class BarnesHut {
+public:
+	using scalar = typename V::scalar;
+	static_assert(V::SIZE == 3, "BarnesHut works in three space");
+	static_assert(std::is_floating_point_v<scalar>, "BarnesHut needs floating point vectors");
+
+	BarnesHut(Span<const V> positions, Span<const scalar> masses, std::size_t leaf_size = 8,
+		ThreadPool& pool = default_pool())
+		: leaf(std::max<std::size_t>(leaf_size, 1))
+	{
+		build(positions, masses, pool);
+	}
+
+	// Replaces the bodies, buffers are kept between builds
+	void build(Span<const V> positions, Span<const scalar> masses, ThreadPool& pool = default_pool())
+	{
+		if (positions.size() > std::numeric_limits<std::uint32_t>::max())
+			throw std::length_error("too many bodies for BarnesHut");
+		assert(masses.size() == positions.size());
+		std::size_t count = positions.size();
+		nodes.clear();
+		order.resize(count);
+		bodies.resize(count);
+		if (count == 0)
+			return;
+
+		sort_bodies(positions, masses, pool);
+		build_tree(pool);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return order.size();
+	}
+
+	// out[i] approximates pairwise_accelerations for body i. A cell is used as a whole when its side
+	// is less than theta times its distance, 0 gives the exact sum, about 0.5 is typical.
+	void accelerations(Span<V> out, scalar theta = scalar(0.5), scalar softening = 0,
+		ThreadPool& pool = default_pool()) const
+	{
+		assert(out.size() == size());
+		parallel_for_chunks(size(), 256, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++) {
+				auto acc = field(bodies[i].position, theta * theta, softening * softening);
+				for (auto k = 0U; k < 3; k++)
+					out[order[i]][k] = acc[k];
+			}
+		}, pool);
+	}
+
+	// The acceleration a body at point would feel
+	V acceleration(const V& point, scalar theta = scalar(0.5), scalar softening = 0) const
+	{
+		auto acc = field({point[0], point[1], point[2]}, theta * theta, softening * softening);
+		V vc{};
+		for (auto k = 0U; k < 3; k++)
+			vc[k] = acc[k];
+		return vc;
+	}
+
+private:
+	using Point = std::array<scalar, 3>;
+
+	struct Body {
+		Point position;
+		scalar mass;
+	};
+
+	struct Node {
+		Point center;
+		scalar mass;
+		// Sum of |mass|
+		scalar weight;
+		scalar squared_side;
+		std::uint32_t begin;
+		std::uint32_t end;
+		// The node after this subtree, the first child is always the next node
+		std::uint32_t next;
+		std::uint32_t is_leaf;
+	};
+
+	// Morton codes interleave 21 bits of each axis
+	static constexpr unsigned LEVELS = 21;
+
+	static std::uint64_t spread_bits(std::uint64_t x)
+	{
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffULL;
+		x = (x | x << 16) & 0x1f0000ff0000ffULL;
+		x = (x | x << 8) & 0x100f00f00f00f00fULL;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+		x = (x | x << 2) & 0x1249249249249249ULL;
+		return x;
+	}
+
+	void sort_bodies(Span<const V> positions, Span<const scalar> masses, ThreadPool& pool)
+	{
+		std::size_t count = positions.size();
+		auto box = bounds(positions, pool);
+		root_side = 0;
+		for (auto k = 0U; k < 3; k++) {
+			origin[k] = box.first[k];
+			root_side = std::max(root_side, box.second[k] - box.first[k]);
+		}
+		// Slightly larger so the far corner still maps inside the grid
+		root_side = root_side > 0 ? root_side * scalar(1.0001) : scalar(1);
+		scalar to_grid = scalar(1 << LEVELS) / root_side;
+
+		keys.resize(count);
+		parallel_for_chunks(count, 4096, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++) {
+				std::uint64_t code = 0;
+				for (auto k = 0U; k < 3; k++) {
+					auto cell = static_cast<std::uint64_t>((positions[i][k] - origin[k]) * to_grid);
+					code |= spread_bits(std::min<std::uint64_t>(cell, (1 << LEVELS) - 1)) << (2 - k);
+				}
+				keys[i] = {code, static_cast<std::uint32_t>(i)};
+			}
+		}, pool);
+
+		// Chunks sorted in parallel, then merged pairwise
+		std::size_t chunk = std::max<std::size_t>(4096, (count + pool.size() * 4 - 1) / (pool.size() * 4));
+		std::size_t chunks = (count + chunk - 1) / chunk;
+		pool.parallel_for(chunks, [&](std::size_t c) {
+			std::sort(keys.begin() + c * chunk, keys.begin() + std::min(count, (c + 1) * chunk));
+		});
+		for (std::size_t width = chunk; width < count; width *= 2) {
+			pool.parallel_for((count + 2 * width - 1) / (2 * width), [&](std::size_t m) {
+				std::size_t begin = m * 2 * width;
+				std::size_t middle = std::min(count, begin + width), end = std::min(count, begin + 2 * width);
+				std::inplace_merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + end);
+			});
+		}
+
+		parallel_for_chunks(count, 4096, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++) {
+				std::uint32_t j = keys[i].second;
+				order[i] = j;
+				bodies[i] = {{positions[j][0], positions[j][1], positions[j][2]}, masses[j]};
+			}
+		}, pool);
+	}
+
+	// The range of bodies in [begin, end) whose cell at level has octant index octant,
+	// the range is sorted so the octants are consecutive runs
+	std::uint32_t octant_end(std::uint32_t begin, std::uint32_t end, unsigned level, std::uint64_t octant) const
+	{
+		unsigned shift = 3 * (LEVELS - 1 - level);
+		return static_cast<std::uint32_t>(std::partition_point(keys.begin() + begin, keys.begin() + end,
+			[&](const std::pair<std::uint64_t, std::uint32_t>& key) {
+				return ((key.first >> shift) & 7) <= octant;
+			}) - keys.begin());
+	}
+
+	bool is_leaf_range(std::uint32_t begin, std::uint32_t end, unsigned level) const
+	{
+		return end - begin <= leaf || level == LEVELS;
+	}
+
+	// Calls f(begin, end, level) for each non-empty child cell of an internal node
+	template <class F>
+	void for_each_child(std::uint32_t begin, std::uint32_t end, unsigned level, F&& f) const
+	{
+		for (std::uint64_t octant = 0; octant < 8 && begin < end; octant++) {
+			std::uint32_t child_end = octant_end(begin, end, level, octant);
+			if (child_end != begin)
+				f(begin, child_end, level + 1);
+			begin = child_end;
+		}
+	}
+
+	// Appends the subtree for bodies [begin, end) at level to out, with node indices relative to out
+	void build_subtree(std::uint32_t begin, std::uint32_t end, unsigned level, std::vector<Node>& out) const
+	{
+		auto index = out.size();
+		out.push_back(Node{});
+		Node node{};
+		node.begin = begin;
+		node.end = end;
+		scalar side = std::ldexp(root_side, -static_cast<int>(level));
+		node.squared_side = side * side;
+		node.is_leaf = is_leaf_range(begin, end, level);
+		if (node.is_leaf) {
+			for (auto i = begin; i < end; i++)
+				add_moment(node, bodies[i].position, bodies[i].mass, std::abs(bodies[i].mass));
+			finish_moment(node);
+		}
+		else {
+			for_each_child(begin, end, level, [&](std::uint32_t b, std::uint32_t e, unsigned l) {
+				build_subtree(b, e, l, out);
+			});
+			merge_children(node, out, index);
+		}
+		node.next = static_cast<std::uint32_t>(out.size());
+		out[index] = node;
+	}
+
+	// Centers are weighted by |mass| so opposite charges still have a sensible center
+	static void add_moment(Node& node, const Point& center, scalar mass, scalar weight)
+	{
+		for (auto k = 0U; k < 3; k++)
+			node.center[k] += weight * center[k];
+		node.mass += mass;
+		node.weight += weight;
+	}
+
+	void finish_moment(Node& node) const
+	{
+		if (node.weight != 0)
+			for (auto k = 0U; k < 3; k++)
+				node.center[k] /= node.weight;
+		else
+			node.center = bodies[node.begin].position;
+	}
+
+	// Moments of an internal node from its children, which follow it in all
+	void merge_children(Node& node, const std::vector<Node>& all, std::size_t index) const
+	{
+		for (auto child = index + 1; child < all.size(); child = all[child].next)
+			add_moment(node, all[child].center, all[child].mass, all[child].weight);
+		finish_moment(node);
+	}
+
+	struct Frontier {
+		std::uint32_t begin;
+		std::uint32_t end;
+		unsigned level;
+	};
+
+	// Levels above this are split on the calling thread, the subtrees below are built in parallel
+	unsigned split_levels(ThreadPool& pool) const
+	{
+		unsigned levels = 0;
+		for (std::size_t cells = 1; cells < pool.size() * 8 && levels < 3; cells *= 8)
+			levels++;
+		return levels;
+	}
+
+	void collect_frontier(std::uint32_t begin, std::uint32_t end, unsigned level, unsigned top,
+		std::vector<Frontier>& frontier) const
+	{
+		if (level == top || is_leaf_range(begin, end, level)) {
+			frontier.push_back({begin, end, level});
+			return;
+		}
+		for_each_child(begin, end, level, [&](std::uint32_t b, std::uint32_t e, unsigned l) {
+			collect_frontier(b, e, l, top, frontier);
+		});
+	}
+
+	// Lays out the top nodes in depth first order, splicing in the subtrees built for the frontier
+	void place_top(std::uint32_t begin, std::uint32_t end, unsigned level, unsigned top,
+		const std::vector<std::vector<Node>>& subtrees, std::size_t& next_subtree)
+	{
+		if (level == top || is_leaf_range(begin, end, level)) {
+			auto offset = static_cast<std::uint32_t>(nodes.size());
+			for (auto node : subtrees[next_subtree++]) {
+				node.next += offset;
+				nodes.push_back(node);
+			}
+			return;
+		}
+		auto index = nodes.size();
+		nodes.push_back(Node{});
+		for_each_child(begin, end, level, [&](std::uint32_t b, std::uint32_t e, unsigned l) {
+			place_top(b, e, l, top, subtrees, next_subtree);
+		});
+		Node node{};
+		node.begin = begin;
+		node.end = end;
+		scalar side = std::ldexp(root_side, -static_cast<int>(level));
+		node.squared_side = side * side;
+		node.is_leaf = 0;
+		merge_children(node, nodes, index);
+		node.next = static_cast<std::uint32_t>(nodes.size());
+		nodes[index] = node;
+	}
+
+	void build_tree(ThreadPool& pool)
+	{
+		auto count = static_cast<std::uint32_t>(size());
+		unsigned top = split_levels(pool);
+		std::vector<Frontier> frontier;
+		collect_frontier(0, count, 0, top, frontier);
+
+		std::vector<std::vector<Node>> subtrees(frontier.size());
+		pool.parallel_for(frontier.size(), [&](std::size_t f) {
+			build_subtree(frontier[f].begin, frontier[f].end, frontier[f].level, subtrees[f]);
+		});
+
+		std::size_t next_subtree = 0;
+		place_top(0, count, 0, top, subtrees, next_subtree);
+	}
+
+	Point field(const Point& point, scalar squared_theta, scalar eps) const
+	{
+		Point acc = {0, 0, 0};
+		auto pull = [&](const Point& center, scalar mass) {
+			scalar d[3] = {center[0] - point[0], center[1] - point[1], center[2] - point[2]};
+			scalar squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+			if (squared == 0)
+				return;
+			squared += eps;
+			scalar scale = mass / (squared * std::sqrt(squared));
+			for (auto k = 0U; k < 3; k++)
+				acc[k] += scale * d[k];
+		};
+
+		std::uint32_t n = 0;
+		while (n < nodes.size()) {
+			const Node& node = nodes[n];
+			if (node.is_leaf) {
+				for (auto i = node.begin; i < node.end; i++)
+					pull(bodies[i].position, bodies[i].mass);
+				n = node.next;
+				continue;
+			}
+			scalar d[3] = {node.center[0] - point[0], node.center[1] - point[1], node.center[2] - point[2]};
+			scalar squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+			if (node.squared_side < squared_theta * squared) {
+				pull(node.center, node.mass);
+				n = node.next;
+			}
+			else {
+				n++;
+			}
+		}
+		return acc;
+	}
+
+	std::size_t leaf;
+	Point origin = {0, 0, 0};
+	scalar root_side = 0;
+	std::vector<Node> nodes;
+	// Bodies in Morton order, their Morton codes & their original indices
+	std::vector<Body> bodies;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+	std::vector<std::uint32_t> order;
+};
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_BARNES_HUT_HPP_INCLUDED
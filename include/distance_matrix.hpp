@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_DISTANCE_MATRIX_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_DISTANCE_MATRIX_HPP_INCLUDED
+
+#include "dot_product_matrix.hpp"
+#include "neighbor.hpp"
+
+namespace MathVector {
+
+namespace detail {
+
+template <class A, class T, std::size_t N>
+std::vector<A> squared_norms(Span<const Vector<T, N>> vcs, ThreadPool& pool)
+{
+	std::vector<A> norms(vcs.size());
+	parallel_for_chunks(vcs.size(), 1024, [&](std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; i++)
+			dot_block<A, T, N, 1>(vcs.data() + i, vcs[i], norms.data() + i, 1);
+	}, pool);
+	return norms;
+}
+
+// Turns a tile of dot products into squared distances. Rounding can take
+// the difference of nearly equal vectors below zero, so it's clamped.
+template <class A>
+inline void dots_to_distances(A* tile, std::size_t rows, std::size_t cols, std::size_t stride,
+	const A* lhs_norms, const A* rhs_norms)
+{
+	for (auto i = 0U; i < rows; i++) {
+		A* row = tile + i * stride;
+		for (auto j = 0U; j < cols; j++)
+			row[j] = std::max(A(0), lhs_norms[i] + rhs_norms[j] - 2 * row[j]);
+	}
+}
+
+}
+
+// Fills out, row major lhs.size() x rhs.size(), with the squared distance between every pair of lhs & rhs.
+// Uses ||a||^2 + ||b||^2 - 2 a.b over the tiles of dot_product_matrix, sums are done in A, so
+// float vectors can be accumulated in double by passing a double out.
+template <class T, std::size_t N, class A>
+void squared_distance_matrix(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs, Span<A> out,
+	ThreadPool& pool = default_pool())
+{
+	assert(out.size() == lhs.size() * rhs.size());
+	auto lhs_norms = detail::squared_norms<A>(lhs, pool);
+	auto rhs_norms = detail::squared_norms<A>(rhs, pool);
+	detail::for_each_dot_tile<T, N>(lhs.size(), rhs.size(), pool,
+		[&](std::size_t lhs_begin, std::size_t lhs_end, std::size_t rhs_begin, std::size_t rhs_end) {
+			A* tile = out.data() + lhs_begin * rhs.size() + rhs_begin;
+			detail::dot_tile(lhs.data(), lhs_begin, lhs_end, rhs.data(), rhs_begin, rhs_end, out.data(), rhs.size());
+			detail::dots_to_distances(tile, lhs_end - lhs_begin, rhs_end - rhs_begin, rhs.size(),
+				lhs_norms.data() + lhs_begin, rhs_norms.data() + rhs_begin);
+		});
+}
+
+template <class T, std::size_t N>
+std::vector<T> squared_distance_matrix(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs,
+	ThreadPool& pool = default_pool())
+{
+	std::vector<T> out(lhs.size() * rhs.size());
+	squared_distance_matrix(lhs, rhs, Span<T>(out), pool);
+	return out;
+}
+
+template <class T, std::size_t N, class A1, class A2>
+std::vector<T> squared_distance_matrix(const std::vector<Vector<T, N>, A1>& lhs, const std::vector<Vector<T, N>, A2>& rhs,
+	ThreadPool& pool = default_pool())
+{
+	return squared_distance_matrix(Span<const Vector<T, N>>(lhs), Span<const Vector<T, N>>(rhs), pool);
+}
+
+// The k nearest rhs vectors to each lhs vector, closest first, without building the whole matrix.
+// Row i of out, min(k, rhs.size()) long, belongs to lhs[i]. Ties keep no particular order.
+template <class T, std::size_t N, class A>
+void nearest_rows(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs, std::size_t k, Span<Neighbor<A>> out,
+	ThreadPool& pool = default_pool())
+{
+	k = std::min(k, rhs.size());
+	assert(out.size() == lhs.size() * k);
+	if (k == 0)
+		return;
+	auto lhs_norms = detail::squared_norms<A>(lhs, pool);
+	auto rhs_norms = detail::squared_norms<A>(rhs, pool);
+
+	// Each task owns a band of rows & walks all of rhs a tile at a time, so its heaps aren't shared
+	std::size_t rows = detail::dot_task_rows;
+	std::size_t cols = std::max<std::size_t>(1, std::min(detail::dot_tile_bytes / sizeof(Vector<T, N>),
+		detail::dot_tile_bytes / sizeof(A) / rows));
+	pool.parallel_for((lhs.size() + rows - 1) / rows, [&](std::size_t task) {
+		std::size_t lhs_begin = task * rows;
+		std::size_t lhs_end = std::min(lhs_begin + rows, lhs.size());
+		std::vector<A> tile(rows * cols);
+		std::vector<std::size_t> found(rows);
+		for (std::size_t rhs_begin = 0; rhs_begin < rhs.size(); rhs_begin += cols) {
+			std::size_t rhs_end = std::min(rhs_begin + cols, rhs.size());
+			detail::dot_tile(lhs.data() + lhs_begin, 0, lhs_end - lhs_begin,
+				rhs.data() + rhs_begin, 0, rhs_end - rhs_begin, tile.data(), cols);
+			detail::dots_to_distances(tile.data(), lhs_end - lhs_begin, rhs_end - rhs_begin, cols,
+				lhs_norms.data() + lhs_begin, rhs_norms.data() + rhs_begin);
+
+			for (auto i = lhs_begin; i < lhs_end; i++) {
+				Neighbor<A>* heap = out.data() + i * k;
+				std::size_t& count = found[i - lhs_begin];
+				const A* distances = tile.data() + (i - lhs_begin) * cols;
+				// Every candidate is kept until the heap is full, even infinite distances, so rows are always filled
+				for (auto j = rhs_begin; j < rhs_end; j++)
+					detail::offer_neighbor(heap, count, k, Neighbor<A>{j, distances[j - rhs_begin]});
+			}
+		}
+		for (auto i = lhs_begin; i < lhs_end; i++)
+			detail::sort_neighbors(out.data() + i * k, k);
+	});
+}
+
+template <class T, std::size_t N>
+std::vector<Neighbor<T>> nearest_rows(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs, std::size_t k,
+	ThreadPool& pool = default_pool())
+{
+	std::vector<Neighbor<T>> out(lhs.size() * std::min(k, rhs.size()));
+	nearest_rows(lhs, rhs, k, Span<Neighbor<T>>(out), pool);
+	return out;
+}
+
+template <class T, std::size_t N, class A1, class A2>
+std::vector<Neighbor<T>> nearest_rows(const std::vector<Vector<T, N>, A1>& lhs, const std::vector<Vector<T, N>, A2>& rhs,
+	std::size_t k, ThreadPool& pool = default_pool())
+{
+	return nearest_rows(Span<const Vector<T, N>>(lhs), Span<const Vector<T, N>>(rhs), k, pool);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_DISTANCE_MATRIX_HPP_INCLUDED
@@ -0,0 +1,133 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_DOT_PRODUCT_MATRIX_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_DOT_PRODUCT_MATRIX_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "vector_array.hpp"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace MathVector {
+
+namespace detail {
+
+// Rows of lhs computed together, each load of an rhs vector is shared between them
+constexpr std::size_t dot_block_rows = 4;
+// Bytes of rhs vectors per tile, sized to stay in L2 while every lhs block passes over it
+constexpr std::size_t dot_tile_bytes = 128 << 10;
+// lhs rows per task
+constexpr std::size_t dot_task_rows = 64;
+
+// Products are summed in A, which may be wider than T
+template <class A, class T, std::size_t N, std::size_t ROWS>
+inline void dot_block(const Vector<T, N>* lhs, const Vector<T, N>& rhs, A* out, std::size_t out_stride)
+{
+	static_assert(sizeof(A) >= sizeof(T), "the accumulator can't be narrower than the vectors");
+	using P = simd::pack<A>;
+	typename P::type acc[ROWS];
+	for (auto r = 0U; r < ROWS; r++)
+		acc[r] = P::zero();
+
+	std::size_t k = 0;
+	for (; k + P::width <= N; k += P::width) {
+		auto b = P::load(rhs.data() + k);
+		for (auto r = 0U; r < ROWS; r++)
+			acc[r] = P::fmadd(P::load(lhs[r].data() + k), b, acc[r]);
+	}
+	for (auto r = 0U; r < ROWS; r++) {
+		A accumulated_val = P::hsum(acc[r]);
+		for (auto j = k; j < N; j++)
+			accumulated_val += static_cast<A>(lhs[r][j]) * static_cast<A>(rhs[j]);
+		out[r * out_stride] = accumulated_val;
+	}
+}
+
+// out[i * out_stride + j] = dot_product(lhs[i], rhs[j]) for i in [lhs_begin, lhs_end) & j in [rhs_begin, rhs_end)
+template <class A, class T, std::size_t N>
+void dot_tile(const Vector<T, N>* lhs, std::size_t lhs_begin, std::size_t lhs_end,
+	const Vector<T, N>* rhs, std::size_t rhs_begin, std::size_t rhs_end,
+	A* out, std::size_t out_stride)
+{
+	std::size_t i = lhs_begin;
+	for (; i + dot_block_rows <= lhs_end; i += dot_block_rows)
+		for (auto j = rhs_begin; j < rhs_end; j++)
+			dot_block<A, T, N, dot_block_rows>(lhs + i, rhs[j], out + i * out_stride + j, out_stride);
+	for (; i < lhs_end; i++)
+		for (auto j = rhs_begin; j < rhs_end; j++)
+			dot_block<A, T, N, 1>(lhs + i, rhs[j], out + i * out_stride + j, out_stride);
+}
+
+// Calls tile(lhs_begin, lhs_end, rhs_begin, rhs_end) for every tile of the lhs x rhs grid, spread over the pool
+template <class T, std::size_t N, class F>
+void for_each_dot_tile(std::size_t lhs_count, std::size_t rhs_count, ThreadPool& pool, F&& tile)
+{
+	std::size_t tile_cols = std::max<std::size_t>(1, dot_tile_bytes / sizeof(Vector<T, N>));
+	std::size_t row_tasks = (lhs_count + dot_task_rows - 1) / dot_task_rows;
+	std::size_t col_tasks = (rhs_count + tile_cols - 1) / tile_cols;
+
+	pool.parallel_for(row_tasks * col_tasks, [&](std::size_t task) {
+		std::size_t row = task / col_tasks * dot_task_rows;
+		std::size_t col = task % col_tasks * tile_cols;
+		tile(row, std::min(row + dot_task_rows, lhs_count), col, std::min(col + tile_cols, rhs_count));
+	});
+}
+
+}
+
+// Fills out, row major lhs.size() x rhs.size(), with the dot product of every pair of lhs & rhs.
+// Work is split into cache sized tiles which run on pool.
+template <class T, std::size_t N>
+void dot_product_matrix(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs, Span<T> out,
+	ThreadPool& pool = default_pool())
+{
+	assert(out.size() == lhs.size() * rhs.size());
+	detail::for_each_dot_tile<T, N>(lhs.size(), rhs.size(), pool,
+		[&](std::size_t lhs_begin, std::size_t lhs_end, std::size_t rhs_begin, std::size_t rhs_end) {
+			detail::dot_tile(lhs.data(), lhs_begin, lhs_end, rhs.data(), rhs_begin, rhs_end, out.data(), rhs.size());
+		});
+}
+
+template <class T, std::size_t N>
+std::vector<T> dot_product_matrix(Span<const Vector<T, N>> lhs, Span<const Vector<T, N>> rhs,
+	ThreadPool& pool = default_pool())
+{
+	std::vector<T> out(lhs.size() * rhs.size());
+	dot_product_matrix(lhs, rhs, Span<T>(out), pool);
+	return out;
+}
+
+template <class T, std::size_t N, class A1, class A2>
+std::vector<T> dot_product_matrix(const std::vector<Vector<T, N>, A1>& lhs, const std::vector<Vector<T, N>, A2>& rhs,
+	ThreadPool& pool = default_pool())
+{
+	return dot_product_matrix(Span<const Vector<T, N>>(lhs), Span<const Vector<T, N>>(rhs), pool);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_DOT_PRODUCT_MATRIX_HPP_INCLUDED
@@ -0,0 +1,538 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_DYNAMIC_VECTOR_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_DYNAMIC_VECTOR_HPP_INCLUDED
+
+#include "accumulate.hpp"
+#include "aligned_allocator.hpp"
+#include "simd_dispatch.hpp"
+#include "span.hpp"
+#include "vector_array.hpp"
+#include "vector_functions.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace MathVector {
+
+template <class T, std::size_t INLINE, std::size_t ALIGNMENT>
+class DynamicVector;
+
+template <class T>
+class VectorView;
+
+// DynamicVector & VectorView, the vectors whose length is only known at run time
+template <class V>
+constexpr bool is_dynamic_vector = false;
+
+template <class T, std::size_t I, std::size_t A>
+constexpr bool is_dynamic_vector<DynamicVector<T, I, A>> = true;
+
+template <class T>
+constexpr bool is_dynamic_vector<VectorView<T>> = true;
+
+// Two dynamic vectors of the same scalar, the scalars are only looked at once both are known to be
+template <class L, class R, bool = is_dynamic_vector<L> && is_dynamic_vector<R>>
+constexpr bool is_dynamic_operands = false;
+
+template <class L, class R>
+constexpr bool is_dynamic_operands<L, R, true> = std::is_same_v<typename L::scalar, typename R::scalar>;
+
+namespace detail {
+
+// 64 bytes of components are stored in the vector itself, longer vectors go on the heap
+template <class T>
+constexpr std::size_t dynamic_inline_size = std::max<std::size_t>(1, 64 / sizeof(T));
+
+// The kernels of simd_dispatch.hpp chosen by length at run time instead of by SIZE
+template <class T>
+constexpr bool dynamic_dispatches = simd::dispatches<T, simd::dispatch_min_size>;
+
+inline void check_dimensions(std::size_t lhs, std::size_t rhs)
+{
+	if (lhs != rhs)
+		throw std::length_error("vector dimensions differ");
+}
+
+template <class T>
+void dynamic_add(T* dst, const T* src, std::size_t n)
+{
+	if constexpr (dynamic_dispatches<T>) {
+		if (n >= simd::dispatch_min_size)
+			return simd::kernels<T>().add(dst, src, n);
+	}
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] += src[i];
+}
+
+template <class T>
+void dynamic_sub(T* dst, const T* src, std::size_t n)
+{
+	if constexpr (dynamic_dispatches<T>) {
+		if (n >= simd::dispatch_min_size)
+			return simd::kernels<T>().sub(dst, src, n);
+	}
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] -= src[i];
+}
+
+template <class T>
+void dynamic_scale(T* dst, T factor, std::size_t n)
+{
+	if constexpr (dynamic_dispatches<T>) {
+		if (n >= simd::dispatch_min_size)
+			return simd::kernels<T>().scale(dst, factor, n);
+	}
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] *= factor;
+}
+
+template <class T>
+T dynamic_dot(const T* lhs, const T* rhs, std::size_t n)
+{
+	if constexpr (dynamic_dispatches<T>) {
+		if (n >= simd::dispatch_min_size)
+			return simd::kernels<T>().dot(lhs, rhs, n);
+	}
+	T accumulated_val = 0;
+	for (std::size_t i = 0; i < n; i++)
+		accumulated_val += lhs[i] * rhs[i];
+	return accumulated_val;
+}
+
+}
+
+// Vector with a length chosen at run time, e.g. when an embedding model is loaded.
+// Up to INLINE components are stored in the object, longer vectors in a heap buffer
+// aligned to ALIGNMENT bytes. Operations on 32 or more floats or doubles use the
+// kernels of simd_dispatch.hpp, operands of different lengths throw std::length_error.
+template <class T, std::size_t INLINE = detail::dynamic_inline_size<T>, std::size_t ALIGNMENT = 64>
+class DynamicVector {
+public:
+	static_assert(std::is_trivially_copyable_v<T>, "DynamicVector components are copied as bytes");
+	static_assert(INLINE > 0, "DynamicVector needs room for at least one inline component");
+
+	using scalar = T;
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	DynamicVector() noexcept : ptr(buffer), count(0), capacity(INLINE) {}
+
+	explicit DynamicVector(std::size_t dimension, const T& value = T())
+		: DynamicVector()
+	{
+		resize(dimension, value);
+	}
+
+	DynamicVector(std::initializer_list<T> values)
+		: DynamicVector()
+	{
+		assign(values.begin(), values.size());
+	}
+
+	explicit DynamicVector(Span<const T> values)
+		: DynamicVector()
+	{
+		assign(values.data(), values.size());
+	}
+
+	template <std::size_t N>
+	explicit DynamicVector(const Vector<T, N>& vc)
+		: DynamicVector()
+	{
+		assign(vc.data(), N);
+	}
+
+	// Copies a view or a vector with a different inline size or alignment
+	template <class R, typename std::enable_if_t<is_dynamic_operands<DynamicVector, R>, int> = 0>
+	explicit DynamicVector(const R& vc)
+		: DynamicVector()
+	{
+		assign(vc.data(), vc.size());
+	}
+
+	DynamicVector(const DynamicVector& other)
+		: DynamicVector()
+	{
+		assign(other.data(), other.size());
+	}
+
+	DynamicVector(DynamicVector&& other) noexcept
+		: DynamicVector()
+	{
+		take(other);
+	}
+
+	~DynamicVector()
+	{
+		release();
+	}
+
+	DynamicVector& operator=(const DynamicVector& other)
+	{
+		if (this != &other)
+			assign(other.data(), other.size());
+		return *this;
+	}
+
+	DynamicVector& operator=(DynamicVector&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			take(other);
+		}
+		return *this;
+	}
+
+	std::size_t size() const noexcept { return count; }
+	bool empty() const noexcept { return count == 0; }
+	// True while the components are stored in the object itself
+	bool is_inline() const noexcept { return ptr == buffer; }
+
+	T* data() noexcept { return ptr; }
+	const T* data() const noexcept { return ptr; }
+	T* begin() noexcept { return ptr; }
+	T* end() noexcept { return ptr + count; }
+	const T* begin() const noexcept { return ptr; }
+	const T* end() const noexcept { return ptr + count; }
+
+	T& operator[](std::size_t i)
+	{
+		assert(i < count);
+		return ptr[i];
+	}
+
+	const T& operator[](std::size_t i) const
+	{
+		assert(i < count);
+		return ptr[i];
+	}
+
+	// New components are set to value, a shorter vector keeps its first dimension components
+	void resize(std::size_t dimension, const T& value = T())
+	{
+		// value may be one of the components, so a new buffer is filled before the old one is released
+		if (dimension > capacity) {
+			T* grown = AlignedAllocator<T, ALIGNMENT>().allocate(dimension);
+			std::copy(ptr, ptr + count, grown);
+			std::fill(grown + count, grown + dimension, value);
+			release();
+			ptr = grown;
+			capacity = dimension;
+		}
+		else if (dimension > count) {
+			std::fill(ptr + count, ptr + dimension, value);
+		}
+		count = dimension;
+	}
+
+	template <class R, typename std::enable_if_t<is_dynamic_operands<DynamicVector, R>, int> = 0>
+	DynamicVector& operator+=(const R& rhs)
+	{
+		detail::check_dimensions(count, rhs.size());
+		detail::dynamic_add(ptr, rhs.data(), count);
+		return *this;
+	}
+
+	template <class R, typename std::enable_if_t<is_dynamic_operands<DynamicVector, R>, int> = 0>
+	DynamicVector& operator-=(const R& rhs)
+	{
+		detail::check_dimensions(count, rhs.size());
+		detail::dynamic_sub(ptr, rhs.data(), count);
+		return *this;
+	}
+
+	DynamicVector& operator*=(const T& rhs)
+	{
+		detail::dynamic_scale(ptr, rhs, count);
+		return *this;
+	}
+
+	const DynamicVector& operator+() const
+	{
+		return *this;
+	}
+
+	DynamicVector operator-() const
+	{
+		DynamicVector result(*this);
+		for (auto& x : result)
+			x = -x;
+		return result;
+	}
+
+private:
+	void assign(const T* values, std::size_t dimension)
+	{
+		// Allocated before releasing, so a throwing allocation leaves the vector as it was
+		if (dimension > capacity) {
+			T* grown = AlignedAllocator<T, ALIGNMENT>().allocate(dimension);
+			release();
+			ptr = grown;
+			capacity = dimension;
+		}
+		if (dimension != 0)
+			std::memmove(ptr, values, dimension * sizeof(T));
+		count = dimension;
+	}
+
+	// Heap buffers are moved by pointer, inline components have to be copied
+	void take(DynamicVector& other) noexcept
+	{
+		if (other.is_inline()) {
+			std::copy(other.buffer, other.buffer + other.count, buffer);
+			ptr = buffer;
+			capacity = INLINE;
+		}
+		else {
+			ptr = other.ptr;
+			capacity = other.capacity;
+		}
+		count = other.count;
+		other.ptr = other.buffer;
+		other.count = 0;
+		other.capacity = INLINE;
+	}
+
+	void release() noexcept
+	{
+		if (!is_inline())
+			AlignedAllocator<T, ALIGNMENT>().deallocate(ptr, capacity);
+		ptr = buffer;
+		capacity = INLINE;
+	}
+
+	T* ptr;
+	std::size_t count;
+	std::size_t capacity;
+	T buffer[INLINE];
+};
+
+// Dynamic vector borrowing memory it doesn't own, e.g. one row of a flat embedding matrix.
+// T may be const for a read only view, the memory must outlive the view.
+template <class T>
+class VectorView : public Span<T> {
+public:
+	using scalar = std::remove_const_t<T>;
+
+	using Span<T>::Span;
+
+	constexpr VectorView(Span<T> values) noexcept : Span<T>(values) {}
+
+	template <class U, std::size_t I, std::size_t A, typename std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>, int> = 0>
+	VectorView(DynamicVector<U, I, A>& vc) noexcept : Span<T>(vc.data(), vc.size()) {}
+
+	template <class U, std::size_t I, std::size_t A, typename std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>, int> = 0>
+	VectorView(const DynamicVector<U, I, A>& vc) noexcept : Span<T>(vc.data(), vc.size()) {}
+
+	template <class U, std::size_t N, typename std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>, int> = 0>
+	constexpr VectorView(Vector<U, N>& vc) noexcept : Span<T>(vc.data(), N) {}
+
+	template <class U, std::size_t N, typename std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>, int> = 0>
+	constexpr VectorView(const Vector<U, N>& vc) noexcept : Span<T>(vc.data(), N) {}
+
+	// The compound assignments write through to the borrowed memory
+	template <class R, typename std::enable_if_t<is_dynamic_operands<VectorView, R>, int> = 0>
+	VectorView& operator+=(const R& rhs)
+	{
+		static_assert(!std::is_const_v<T>, "can't write through a read only VectorView");
+		detail::check_dimensions(this->size(), rhs.size());
+		detail::dynamic_add(this->data(), rhs.data(), this->size());
+		return *this;
+	}
+
+	template <class R, typename std::enable_if_t<is_dynamic_operands<VectorView, R>, int> = 0>
+	VectorView& operator-=(const R& rhs)
+	{
+		static_assert(!std::is_const_v<T>, "can't write through a read only VectorView");
+		detail::check_dimensions(this->size(), rhs.size());
+		detail::dynamic_sub(this->data(), rhs.data(), this->size());
+		return *this;
+	}
+
+	VectorView& operator*=(const scalar& rhs)
+	{
+		static_assert(!std::is_const_v<T>, "can't write through a read only VectorView");
+		detail::dynamic_scale(this->data(), rhs, this->size());
+		return *this;
+	}
+
+	DynamicVector<scalar> operator-() const
+	{
+		return -DynamicVector<scalar>(*this);
+	}
+};
+
+template <class T, std::size_t I, std::size_t A>
+VectorView(DynamicVector<T, I, A>&) -> VectorView<T>;
+
+template <class T, std::size_t I, std::size_t A>
+VectorView(const DynamicVector<T, I, A>&) -> VectorView<const T>;
+
+namespace detail {
+
+// Owning result of an operation, a view's result is a DynamicVector with the default storage
+template <class V>
+struct dynamic_owner {
+	using type = DynamicVector<typename V::scalar>;
+};
+
+template <class T, std::size_t I, std::size_t A>
+struct dynamic_owner<DynamicVector<T, I, A>> {
+	using type = DynamicVector<T, I, A>;
+};
+
+}
+
+template <class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+typename detail::dynamic_owner<L>::type operator+(const L& lhs, const R& rhs)
+{
+	typename detail::dynamic_owner<L>::type result(lhs);
+	result += rhs;
+	return result;
+}
+
+template <class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+typename detail::dynamic_owner<L>::type operator-(const L& lhs, const R& rhs)
+{
+	typename detail::dynamic_owner<L>::type result(lhs);
+	result -= rhs;
+	return result;
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+typename detail::dynamic_owner<V>::type operator*(const V& lhs, const typename V::scalar& rhs)
+{
+	typename detail::dynamic_owner<V>::type result(lhs);
+	result *= rhs;
+	return result;
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+typename detail::dynamic_owner<V>::type operator*(const typename V::scalar& lhs, const V& rhs)
+{
+	return rhs * lhs;
+}
+
+template <class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+bool operator==(const L& lhs, const R& rhs)
+{
+	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+bool operator!=(const L& lhs, const R& rhs)
+{
+	return !(lhs == rhs);
+}
+
+template <class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+auto dot_product(const L& lhs, const R& rhs)
+{
+	detail::check_dimensions(lhs.size(), rhs.size());
+	return detail::dynamic_dot(lhs.data(), rhs.data(), lhs.size());
+}
+
+// Accumulated as Policy from accumulate.hpp says
+template <class Policy, class L, class R, typename std::enable_if_t<is_dynamic_operands<L, R>, int> = 0>
+auto dot_product(const L& lhs, const R& rhs)
+{
+	detail::check_dimensions(lhs.size(), rhs.size());
+	return dot_product<Policy>(lhs.data(), rhs.data(), lhs.size());
+}
+
+// The length isn't known while compiling, so F is always a square root, never a hypot
+template <class V, class F, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+auto magnitude(const V& vc, F func)
+{
+	return func(dot_product(vc, vc));
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+auto squared_magnitude(const V& vc)
+{
+	return dot_product(vc, vc);
+}
+
+// The functor free magnitudes of vector_functions.hpp
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+auto magnitude(const V& vc)
+{
+	return std::sqrt(squared_magnitude(vc));
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+auto fast_magnitude(const V& vc)
+{
+	static_assert(std::is_floating_point_v<typename V::scalar>, "fast_magnitude needs floating point vectors");
+	return detail::estimate_sqrt(squared_magnitude(vc));
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+auto scaled_magnitude(const V& vc)
+{
+	static_assert(std::is_floating_point_v<typename V::scalar>, "scaled_magnitude needs floating point vectors");
+	auto squared = squared_magnitude(vc);
+	if (detail::magnitude_in_range(squared))
+		return std::sqrt(squared);
+	return detail::rescaled_magnitude(squared, [&](auto f) {
+		for (const auto& x : vc)
+			f(x);
+	});
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+bool is_trivial(const V& vc)
+{
+	return std::all_of(vc.begin(), vc.end(), [](const auto& x) { return x == 0; });
+}
+
+template <class V, class F, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+std::optional<typename detail::dynamic_owner<V>::type> unit_vector(const V& vc, F func)
+{
+	if (is_trivial(vc))
+		return {};
+
+	return vc * (1 / magnitude(vc, func));
+}
+
+template <class V, typename std::enable_if_t<is_dynamic_vector<V>, int> = 0>
+std::optional<typename detail::dynamic_owner<V>::type> unit_vector(const V& vc)
+{
+	if (is_trivial(vc))
+		return {};
+
+	return vc * (1 / magnitude(vc));
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_DYNAMIC_VECTOR_HPP_INCLUDED
@@ -0,0 +1,633 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_HNSW_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_HNSW_HPP_INCLUDED
+
+#include "aligned_allocator.hpp"
+#include "neighbor.hpp"
+#include "simd.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "vector_array.hpp"
+#include "vector_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+struct HnswParameters {
+	// Links kept per point on the upper levels, level 0 keeps twice as many
+	std::size_t m = 16;
+	// Candidates kept while linking a new point, more builds a better graph more slowly
+	std::size_t ef_construction = 200;
+	// Candidates kept by a search that doesn't pass its own, never fewer than k
+	std::size_t ef_search = 64;
+	// Levels are drawn from a hash of the seed & the point's index, so a build is repeatable
+	std::uint64_t seed = 0x9e3779b97f4a7c15;
+};
+
+// Layout of a saved index, all in native byte order:
+//   HnswFileHeader
+//   count points of dimension scalars each
+//   count uint32 levels
+//   count level 0 link lists of 2m + 1 uint32, the length first
+//   for every point above level 0, level link lists of m + 1 uint32
+struct HnswFileHeader {
+	static constexpr char MAGIC[4] = {'M', 'V', 'H', 'N'};
+	static constexpr std::uint32_t VERSION = 1;
+
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	ScalarType scalar_type;
+	std::uint64_t dimension;
+	std::uint64_t count;
+	std::uint64_t m;
+	std::uint64_t ef_construction;
+	std::uint64_t ef_search;
+	std::uint64_t seed;
+	std::uint32_t entry;
+	std::uint32_t top_level;
+	std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(HnswFileHeader) == 80, "header must stay 80 bytes");
+
+namespace detail {
+
+// Squared euclidean distance of two N long arrays, two packs at a time
+template <class T, std::size_t N>
+inline T squared_l2(const T* a, const T* b)
+{
+	using P = simd::pack<T>;
+	auto acc0 = P::zero(), acc1 = P::zero();
+	std::size_t i = 0;
+	for (; i + 2 * P::width <= N; i += 2 * P::width) {
+		auto d0 = P::sub(P::load(a + i), P::load(b + i));
+		auto d1 = P::sub(P::load(a + i + P::width), P::load(b + i + P::width));
+		acc0 = P::fmadd(d0, d0, acc0);
+		acc1 = P::fmadd(d1, d1, acc1);
+	}
+	for (; i + P::width <= N; i += P::width) {
+		auto d = P::sub(P::load(a + i), P::load(b + i));
+		acc0 = P::fmadd(d, d, acc0);
+	}
+	T sum = P::hsum(P::add(acc0, acc1));
+	for (; i < N; i++)
+		sum += (a[i] - b[i]) * (a[i] - b[i]);
+	return sum;
+}
+
+// Marks of the points one search has reached, per thread. Each search takes a new
+// epoch rather than clearing, the marks are only cleared when the epoch wraps.
+struct VisitedPoints {
+	std::vector<std::uint32_t> marks;
+	std::uint32_t epoch = 0;
+
+	void start(std::size_t count)
+	{
+		if (marks.size() < count)
+			marks.resize(count, 0);
+		if (++epoch == 0) {
+			std::fill(marks.begin(), marks.end(), 0);
+			epoch = 1;
+		}
+	}
+
+	// True the first time id is visited in this search
+	bool visit(std::uint32_t id)
+	{
+		if (marks[id] == epoch)
+			return false;
+		marks[id] = epoch;
+		return true;
+	}
+};
+
+inline VisitedPoints& visited_points()
+{
+	thread_local VisitedPoints visited;
+	return visited;
+}
+
+inline std::uint64_t mix_bits(std::uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	return x ^ (x >> 31);
+}
+
+inline void read_bytes(std::FILE* file, void* data, std::size_t bytes, const std::string& path)
+{
+	if (bytes != 0 && std::fread(data, 1, bytes, file) != bytes)
+		throw std::runtime_error(path + " is truncated");
+}
+
+}
+
+// Hierarchical navigable small world graph over float or double Vectors, for approximate
+// nearest neighbor search. Every point is linked to about m of its nearest on level 0 &
+// a geometrically shrinking subset also on higher levels, a search descends greedily from
+// the top & then keeps the ef best candidates on level 0.
+// Indices in results are the order points were inserted in. Inserts may run concurrently with
+// each other, each point's links are guarded by its own mutex, but not with searches or save.
+template <class V>
+class HnswIndex {
+public:
+	using scalar = typename V::scalar;
+	using neighbor = Neighbor<scalar>;
+	static constexpr std::size_t SIZE = V::SIZE;
+	// Index of the padding batch_nearest puts after the points a search found
+	static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+	static_assert(std::is_floating_point_v<scalar>, "HnswIndex needs floating point vectors");
+	static_assert(sizeof(V) == SIZE * sizeof(scalar), "vector components must be tightly packed");
+
+	// An empty index with room for capacity points
+	explicit HnswIndex(std::size_t capacity, const HnswParameters& parameters = HnswParameters())
+		: settings(parameters), room(capacity)
+	{
+		if (capacity >= NONE)
+			throw std::length_error("too many points for an HnswIndex");
+		settings.m = std::max<std::size_t>(settings.m, 2);
+		settings.ef_construction = std::max(settings.ef_construction, settings.m);
+		level_scale = 1 / std::log(static_cast<double>(settings.m));
+		points.resize(capacity);
+		levels.resize(capacity);
+		base_links.resize(capacity * (base_max() + 1));
+		upper_links.resize(capacity);
+		locks.reset(new std::mutex[capacity]);
+	}
+
+	// Builds an index of points, inserting in parallel
+	HnswIndex(Span<const V> points, const HnswParameters& parameters = HnswParameters(), ThreadPool& pool = default_pool())
+		: HnswIndex(points.size(), parameters)
+	{
+		insert(points, pool);
+	}
+
+	// Not safe while other threads use either index
+	HnswIndex(HnswIndex&& other) noexcept
+		: settings(other.settings), room(other.room), level_scale(other.level_scale),
+		points(std::move(other.points)), levels(std::move(other.levels)),
+		base_links(std::move(other.base_links)), upper_links(std::move(other.upper_links)),
+		locks(std::move(other.locks)), entry(other.entry), top_level(other.top_level),
+		claimed(other.claimed.load())
+	{
+		other.room = 0;
+		other.entry = NONE;
+		other.claimed = 0;
+	}
+
+	HnswIndex(const HnswIndex&) = delete;
+	HnswIndex& operator=(const HnswIndex&) = delete;
+	HnswIndex& operator=(HnswIndex&&) = delete;
+
+	// Points inserted, or being inserted
+	std::size_t size() const noexcept
+	{
+		return claimed.load(std::memory_order_relaxed);
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		return room;
+	}
+
+	const HnswParameters& parameters() const noexcept
+	{
+		return settings;
+	}
+
+	// Searches that don't pass an ef keep this many candidates
+	void set_ef_search(std::size_t ef) noexcept
+	{
+		settings.ef_search = ef;
+	}
+
+	const V& point(std::size_t i) const
+	{
+		assert(i < size());
+		return points[i];
+	}
+
+	// Adds a point & returns its index, throws std::length_error once the capacity is used up
+	std::size_t insert(const V& point)
+	{
+		std::uint32_t id = claim(1);
+		link(id, point);
+		return id;
+	}
+
+	// Adds points in parallel, points[i] gets index size() + i
+	void insert(Span<const V> batch, ThreadPool& pool = default_pool())
+	{
+		std::uint32_t first = claim(batch.size());
+		parallel_for_chunks(batch.size(), 16, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++)
+				link(static_cast<std::uint32_t>(first + i), batch[i]);
+		}, pool);
+	}
+
+	// The approximate k nearest points, closest first. ef candidates are kept, or the
+	// parameters' ef_search when it's 0, & never fewer than k. Fewer than k are returned
+	// when the search can't reach k points, as pruned links may leave some unreachable.
+	std::vector<neighbor> nearest(const V& query, std::size_t k, std::size_t ef = 0) const
+	{
+		std::vector<neighbor> result(std::min(k, size()));
+		result.resize(nearest(query, result.size(), ef, result.data()));
+		return result;
+	}
+
+	// nearest for every query, row i of min(k, size()) neighbors belongs to queries[i]. Rows the
+	// search couldn't fill are padded with index NONE & an infinite squared distance.
+	std::vector<neighbor> batch_nearest(Span<const V> queries, std::size_t k, std::size_t ef = 0,
+		ThreadPool& pool = default_pool()) const
+	{
+		std::size_t row = std::min(k, size());
+		std::vector<neighbor> result(queries.size() * row);
+		parallel_for_chunks(queries.size(), 16, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++) {
+				neighbor* out = result.data() + i * row;
+				std::fill(out + nearest(queries[i], row, ef, out), out + row,
+					neighbor{NONE, std::numeric_limits<scalar>::infinity()});
+			}
+		}, pool);
+		return result;
+	}
+
+	void save(const std::string& path) const
+	{
+		HnswFileHeader header{};
+		std::memcpy(header.magic, HnswFileHeader::MAGIC, sizeof(header.magic));
+		header.version = HnswFileHeader::VERSION;
+		header.byte_order = VectorFileHeader::ORDER_MARK;
+		header.scalar_type = scalar_type_of<scalar>();
+		header.dimension = SIZE;
+		header.count = size();
+		header.m = settings.m;
+		header.ef_construction = settings.ef_construction;
+		header.ef_search = settings.ef_search;
+		header.seed = settings.seed;
+		header.entry = entry;
+		header.top_level = top_level;
+
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			throw std::system_error(errno, std::generic_category(), "creating " + path);
+		try {
+			detail::write_bytes(file, &header, sizeof(header));
+			detail::write_bytes(file, points.data(), size() * sizeof(V));
+			detail::write_bytes(file, levels.data(), size() * sizeof(std::uint32_t));
+			detail::write_bytes(file, base_links.data(), size() * (base_max() + 1) * sizeof(std::uint32_t));
+			for (std::size_t i = 0; i < size(); i++)
+				detail::write_bytes(file, upper_links[i].get(), levels[i] * (settings.m + 1) * sizeof(std::uint32_t));
+		}
+		catch (...) {
+			std::fclose(file);
+			throw;
+		}
+		if (std::fclose(file) != 0)
+			throw std::system_error(errno, std::generic_category(), "finishing " + path);
+	}
+
+	// Reads an index written by save, with room for at least capacity points
+	static HnswIndex load(const std::string& path, std::size_t capacity = 0)
+	{
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (!file)
+			throw std::system_error(errno, std::generic_category(), "opening " + path);
+		std::unique_ptr<std::FILE, int (*)(std::FILE*)> closing(file, std::fclose);
+
+		HnswFileHeader header;
+		detail::read_bytes(file, &header, sizeof(header), path);
+		if (std::memcmp(header.magic, HnswFileHeader::MAGIC, sizeof(header.magic)) != 0)
+			throw std::runtime_error(path + " isn't an HNSW index");
+		if (header.version != HnswFileHeader::VERSION)
+			throw std::runtime_error(path + " has unsupported version " + std::to_string(header.version));
+		if (header.byte_order != VectorFileHeader::ORDER_MARK)
+			throw std::runtime_error(path + " was written with a different byte order");
+		if (header.scalar_type != scalar_type_of<scalar>() || header.dimension != SIZE)
+			throw std::runtime_error(path + " holds a different scalar type or dimension");
+		if (header.count >= NONE || header.m < 2 || header.m > MAX_M || (header.count != 0 && header.entry >= header.count))
+			throw std::runtime_error(path + " has a corrupt header");
+		// Checked before anything is allocated, every point takes at least its vector, level & level 0 links
+		std::uint64_t point_bytes = sizeof(V) + (2 * header.m + 2) * sizeof(std::uint32_t);
+		if (header.count > (file_size(file, path) - sizeof(header)) / point_bytes)
+			throw std::runtime_error(path + " is truncated");
+
+		HnswParameters parameters;
+		parameters.m = header.m;
+		parameters.ef_construction = header.ef_construction;
+		parameters.ef_search = header.ef_search;
+		parameters.seed = header.seed;
+		std::size_t count = header.count;
+		HnswIndex index(std::max<std::size_t>(capacity, count), parameters);
+		detail::read_bytes(file, index.points.data(), count * sizeof(V), path);
+		detail::read_bytes(file, index.levels.data(), count * sizeof(std::uint32_t), path);
+		detail::read_bytes(file, index.base_links.data(), count * (index.base_max() + 1) * sizeof(std::uint32_t), path);
+		for (std::size_t i = 0; i < count; i++) {
+			if (index.levels[i] > MAX_LEVEL)
+				throw std::runtime_error(path + " has a corrupt level");
+			index.upper_links[i] = index.make_upper_links(index.levels[i]);
+			detail::read_bytes(file, index.upper_links[i].get(), index.levels[i] * (parameters.m + 1) * sizeof(std::uint32_t), path);
+		}
+		index.validate_links(count, path);
+		if (count != 0 && header.top_level != index.levels[header.entry])
+			throw std::runtime_error(path + " has a corrupt header");
+		index.entry = count != 0 ? header.entry : NONE;
+		index.top_level = header.top_level;
+		index.claimed = count;
+		return index;
+	}
+
+private:
+	using Candidate = std::pair<scalar, std::uint32_t>;
+
+	static constexpr std::uint32_t MAX_LEVEL = 32;
+	static constexpr std::size_t MAX_M = 1 << 12;
+
+	static std::uint64_t file_size(std::FILE* file, const std::string& path)
+	{
+		long position = std::ftell(file);
+		if (position < 0 || std::fseek(file, 0, SEEK_END) != 0)
+			throw std::system_error(errno, std::generic_category(), "reading size of " + path);
+		long size = std::ftell(file);
+		if (size < 0 || std::fseek(file, position, SEEK_SET) != 0)
+			throw std::system_error(errno, std::generic_category(), "reading size of " + path);
+		return static_cast<std::uint64_t>(size);
+	}
+
+	std::size_t base_max() const noexcept
+	{
+		return 2 * settings.m;
+	}
+
+	std::size_t max_links(std::size_t level) const noexcept
+	{
+		return level == 0 ? base_max() : settings.m;
+	}
+
+	// The length of a point's list on a level, followed by the list
+	std::uint32_t* links(std::uint32_t id, std::size_t level)
+	{
+		return level == 0 ? base_links.data() + id * (base_max() + 1) : upper_links[id].get() + (level - 1) * (settings.m + 1);
+	}
+
+	const std::uint32_t* links(std::uint32_t id, std::size_t level) const
+	{
+		return const_cast<HnswIndex*>(this)->links(id, level);
+	}
+
+	std::unique_ptr<std::uint32_t[]> make_upper_links(std::uint32_t level) const
+	{
+		if (level == 0)
+			return nullptr;
+		return std::unique_ptr<std::uint32_t[]>(new std::uint32_t[level * (settings.m + 1)]());
+	}
+
+	scalar distance(const V& query, std::uint32_t id) const
+	{
+		return detail::squared_l2<scalar, SIZE>(query.data(), points[id].data());
+	}
+
+	std::uint32_t claim(std::size_t count)
+	{
+		std::size_t first = claimed.fetch_add(count);
+		if (first + count > room) {
+			claimed.fetch_sub(count);
+			throw std::length_error("HnswIndex is full");
+		}
+		return static_cast<std::uint32_t>(first);
+	}
+
+	std::uint32_t random_level(std::uint32_t id) const
+	{
+		double uniform = (detail::mix_bits(settings.seed ^ detail::mix_bits(id)) >> 11) * 0x1.0p-53;
+		double level = -std::log(1 - uniform) * level_scale;
+		return static_cast<std::uint32_t>(std::min<double>(level, MAX_LEVEL));
+	}
+
+	// A copy of a point's list, taken under its lock when other inserts may be changing it
+	void read_links(std::uint32_t id, std::size_t level, bool locking, std::vector<std::uint32_t>& out) const
+	{
+		std::unique_lock<std::mutex> lock;
+		if (locking)
+			lock = std::unique_lock<std::mutex>(locks[id]);
+		const std::uint32_t* list = links(id, level);
+		out.assign(list + 1, list + 1 + list[0]);
+	}
+
+	// Moves to the closest linked point until none is closer
+	Candidate greedy(const V& query, Candidate current, std::size_t level, bool locking) const
+	{
+		std::vector<std::uint32_t> list;
+		for (bool moved = true; moved;) {
+			moved = false;
+			read_links(current.second, level, locking, list);
+			for (auto next : list) {
+				scalar d = distance(query, next);
+				if (d < current.first) {
+					current = {d, next};
+					moved = true;
+				}
+			}
+		}
+		return current;
+	}
+
+	// The ef closest points found on a level starting from start, as a max heap
+	std::vector<Candidate> search_level(const V& query, Candidate start, std::size_t ef, std::size_t level, bool locking) const
+	{
+		// Sized to the capacity, concurrent inserts link points claimed after this search starts
+		auto& visited = detail::visited_points();
+		visited.start(room);
+		std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier;
+		std::vector<Candidate> best{start};
+		std::vector<std::uint32_t> list;
+		visited.visit(start.second);
+		frontier.push(start);
+		while (!frontier.empty()) {
+			Candidate current = frontier.top();
+			if (current.first > best.front().first && best.size() >= ef)
+				break;
+			frontier.pop();
+			read_links(current.second, level, locking, list);
+			for (auto next : list) {
+				if (!visited.visit(next))
+					continue;
+				scalar d = distance(query, next);
+				if (best.size() < ef || d < best.front().first) {
+					frontier.push({d, next});
+					best.push_back({d, next});
+					std::push_heap(best.begin(), best.end());
+					if (best.size() > ef) {
+						std::pop_heap(best.begin(), best.end());
+						best.pop_back();
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	// Keeps up to count candidates, closest first, skipping any closer to a kept one than to the
+	// point they're linked from, so links spread out in every direction rather than bunching
+	std::vector<Candidate> select_neighbors(std::vector<Candidate> candidates, std::size_t count) const
+	{
+		std::sort(candidates.begin(), candidates.end());
+		std::vector<Candidate> kept;
+		for (auto& candidate : candidates) {
+			if (kept.size() == count)
+				break;
+			bool diverse = std::all_of(kept.begin(), kept.end(), [&](const Candidate& other) {
+				return distance(points[candidate.second], other.second) >= candidate.first;
+			});
+			if (diverse)
+				kept.push_back(candidate);
+		}
+		return kept;
+	}
+
+	// Adds id to the list of target, reselecting the list when it's full
+	void connect(std::uint32_t target, std::uint32_t id, scalar squared_distance, std::size_t level)
+	{
+		std::lock_guard<std::mutex> lock(locks[target]);
+		std::uint32_t* list = links(target, level);
+		if (list[0] < max_links(level)) {
+			list[1 + list[0]++] = id;
+			return;
+		}
+		std::vector<Candidate> candidates{{squared_distance, id}};
+		for (std::uint32_t k = 1; k <= list[0]; k++)
+			candidates.push_back({distance(points[target], list[k]), list[k]});
+		auto kept = select_neighbors(std::move(candidates), max_links(level));
+		list[0] = static_cast<std::uint32_t>(kept.size());
+		for (std::size_t k = 0; k < kept.size(); k++)
+			list[1 + k] = kept[k].second;
+	}
+
+	void link(std::uint32_t id, const V& point)
+	{
+		points[id] = point;
+		std::uint32_t level = random_level(id);
+		levels[id] = level;
+		upper_links[id] = make_upper_links(level);
+
+		// Held to the end by a point that will be the new top, so it's only entered once linked
+		std::unique_lock<std::mutex> top(top_lock);
+		if (entry == NONE) {
+			entry = id;
+			top_level = level;
+			return;
+		}
+		std::uint32_t start = entry;
+		std::uint32_t start_level = top_level;
+		if (level <= start_level)
+			top.unlock();
+
+		Candidate current{distance(point, start), start};
+		for (std::size_t l = start_level; l > level; l--)
+			current = greedy(point, current, l, true);
+		for (std::size_t l = std::min(level, start_level) + 1; l-- > 0;) {
+			auto candidates = search_level(point, current, settings.ef_construction, l, true);
+			current = *std::min_element(candidates.begin(), candidates.end());
+			auto chosen = select_neighbors(std::move(candidates), settings.m);
+			{
+				std::lock_guard<std::mutex> lock(locks[id]);
+				std::uint32_t* list = links(id, l);
+				list[0] = static_cast<std::uint32_t>(chosen.size());
+				for (std::size_t k = 0; k < chosen.size(); k++)
+					list[1 + k] = chosen[k].second;
+			}
+			for (auto& neighbor : chosen)
+				connect(neighbor.second, id, neighbor.first, l);
+		}
+		if (level > start_level) {
+			entry = id;
+			top_level = level;
+		}
+	}
+
+	// Writes up to k of the nearest points to out & returns how many
+	std::size_t nearest(const V& query, std::size_t k, std::size_t ef, neighbor* out) const
+	{
+		if (k == 0 || entry == NONE)
+			return 0;
+		ef = std::max(ef != 0 ? ef : settings.ef_search, k);
+		Candidate current{distance(query, entry), entry};
+		for (std::size_t l = top_level; l > 0; l--)
+			current = greedy(query, current, l, false);
+		auto best = search_level(query, current, ef, 0, false);
+		std::sort_heap(best.begin(), best.end());
+		std::size_t found = std::min(k, best.size());
+		for (std::size_t i = 0; i < found; i++)
+			out[i] = neighbor{best[i].second, best[i].first};
+		return found;
+	}
+
+	void validate_links(std::size_t count, const std::string& path) const
+	{
+		for (std::uint32_t i = 0; i < count; i++) {
+			for (std::uint32_t l = 0; l <= levels[i]; l++) {
+				const std::uint32_t* list = links(i, l);
+				if (list[0] > max_links(l) || std::any_of(list + 1, list + 1 + list[0], [&](std::uint32_t j) {
+					return j >= count || levels[j] < l;
+				}))
+					throw std::runtime_error(path + " has a corrupt link");
+			}
+		}
+	}
+
+	HnswParameters settings;
+	std::size_t room;
+	double level_scale = 1;
+	std::vector<V, AlignedAllocator<V>> points;
+	std::vector<std::uint32_t> levels;
+	std::vector<std::uint32_t> base_links;
+	std::vector<std::unique_ptr<std::uint32_t[]>> upper_links;
+	std::unique_ptr<std::mutex[]> locks;
+	std::mutex top_lock;
+	std::uint32_t entry = NONE;
+	std::uint32_t top_level = 0;
+	std::atomic<std::size_t> claimed{0};
+};
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_HNSW_HPP_INCLUDED
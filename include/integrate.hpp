@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_INTEGRATE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_INTEGRATE_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#include "vector_soa.hpp"
+#include <cassert>
+
+namespace MathVector {
+
+namespace detail {
+
+// Particles per thread chunk, small systems are stepped on the calling thread
+constexpr std::size_t integrate_grain = 1 << 14;
+
+// Accelerations as packs, either one per particle from a VectorSoA or the same for all of them
+template <class V, class A>
+struct ParticleAccelerations {
+	const VectorSoA<V, A>& accelerations;
+
+	template <class P>
+	typename P::type load(std::size_t k, std::size_t i) const
+	{
+		return P::load(accelerations.lane(k) + i);
+	}
+};
+
+// Held by value so the optimizer knows the stores can't change it
+template <class V>
+struct UniformAcceleration {
+	const V acceleration;
+
+	template <class P>
+	typename P::type load(std::size_t k, std::size_t) const
+	{
+		return P::set1(acceleration[k]);
+	}
+};
+
+// Calls step(P{}, x, v, a) for every pack of every lane, x & v being pointers to the pack.
+// Each chunk of particles is read & written once per lane, across the pool.
+template <class V, class A, class Source, class F>
+void integrate_pass(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const Source& source,
+	ThreadPool& pool, F&& step)
+{
+	using T = typename V::scalar;
+	assert(positions.size() == velocities.size());
+	parallel_for_chunks(positions.size(), integrate_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto k = 0U; k < V::SIZE; k++) {
+			T* x = positions.lane(k) + begin;
+			T* v = velocities.lane(k) + begin;
+			simd::for_each_pack<T>(end - begin, [&](auto p, std::size_t i) {
+				using P = decltype(p);
+				step(p, x + i, v + i, source.template load<P>(k, begin + i));
+			});
+		}
+	}, pool);
+}
+
+template <class V, class A, class Source>
+void euler(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const Source& source,
+	typename V::scalar dt, ThreadPool& pool)
+{
+	integrate_pass(positions, velocities, source, pool, [&](auto p, auto* x, auto* v, auto a) {
+		using P = decltype(p);
+		auto step = P::set1(dt);
+		auto old_v = P::load(v);
+		P::store(v, P::fmadd(a, step, old_v));
+		P::store(x, P::fmadd(old_v, step, P::load(x)));
+	});
+}
+
+template <class V, class A, class Source>
+void semi_implicit_euler(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const Source& source,
+	typename V::scalar dt, ThreadPool& pool)
+{
+	integrate_pass(positions, velocities, source, pool, [&](auto p, auto* x, auto* v, auto a) {
+		using P = decltype(p);
+		auto step = P::set1(dt);
+		auto new_v = P::fmadd(a, step, P::load(v));
+		P::store(v, new_v);
+		P::store(x, P::fmadd(new_v, step, P::load(x)));
+	});
+}
+
+// v += a dt / 2, then x += v dt, the first half of a velocity Verlet step
+template <class V, class A, class Source>
+void kick_drift(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const Source& source,
+	typename V::scalar dt, ThreadPool& pool)
+{
+	integrate_pass(positions, velocities, source, pool, [&](auto p, auto* x, auto* v, auto a) {
+		using P = decltype(p);
+		auto new_v = P::fmadd(a, P::set1(dt / 2), P::load(v));
+		P::store(v, new_v);
+		P::store(x, P::fmadd(new_v, P::set1(dt), P::load(x)));
+	});
+}
+
+// v += a dt / 2, the second half
+template <class V, class A, class Source>
+void kick(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const Source& source,
+	typename V::scalar dt, ThreadPool& pool)
+{
+	integrate_pass(positions, velocities, source, pool, [&](auto p, auto*, auto* v, auto a) {
+		using P = decltype(p);
+		P::store(v, P::fmadd(a, P::set1(dt / 2), P::load(v)));
+	});
+}
+
+}
+
+// Explicit Euler, x += v dt & v += a dt using the velocities from the start of the step
+template <class V, class A>
+void euler_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const VectorSoA<V, A>& accelerations,
+	typename V::scalar dt, ThreadPool& pool = default_pool())
+{
+	assert(accelerations.size() == positions.size());
+	detail::euler(positions, velocities, detail::ParticleAccelerations<V, A>{accelerations}, dt, pool);
+}
+
+// Every particle has the same acceleration, e.g. gravity
+template <class V, class A>
+void euler_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const V& acceleration,
+	typename V::scalar dt, ThreadPool& pool = default_pool())
+{
+	detail::euler(positions, velocities, detail::UniformAcceleration<V>{acceleration}, dt, pool);
+}
+
+// Semi-implicit (symplectic) Euler, v += a dt then x += v dt with the new velocities
+template <class V, class A>
+void semi_implicit_euler_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities,
+	const VectorSoA<V, A>& accelerations, typename V::scalar dt, ThreadPool& pool = default_pool())
+{
+	assert(accelerations.size() == positions.size());
+	detail::semi_implicit_euler(positions, velocities, detail::ParticleAccelerations<V, A>{accelerations}, dt, pool);
+}
+
+template <class V, class A>
+void semi_implicit_euler_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const V& acceleration,
+	typename V::scalar dt, ThreadPool& pool = default_pool())
+{
+	detail::semi_implicit_euler(positions, velocities, detail::UniformAcceleration<V>{acceleration}, dt, pool);
+}
+
+// Velocity Verlet. accelerations must hold the accelerations at the current positions,
+// compute(positions, accelerations) is called once in the middle of the step to refill them
+// for the new positions, so they're ready for the next step. The half kick & drift are one pass
+// & the closing half kick a second.
+template <class V, class A, class F>
+void velocity_verlet_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, VectorSoA<V, A>& accelerations,
+	typename V::scalar dt, F&& compute, ThreadPool& pool = default_pool())
+{
+	assert(accelerations.size() == positions.size());
+	detail::kick_drift(positions, velocities, detail::ParticleAccelerations<V, A>{accelerations}, dt, pool);
+	compute(static_cast<const VectorSoA<V, A>&>(positions), accelerations);
+	detail::kick(positions, velocities, detail::ParticleAccelerations<V, A>{accelerations}, dt, pool);
+}
+
+// With a constant, uniform acceleration the two half kicks fold into a single pass
+template <class V, class A>
+void velocity_verlet_step(VectorSoA<V, A>& positions, VectorSoA<V, A>& velocities, const V& acceleration,
+	typename V::scalar dt, ThreadPool& pool = default_pool())
+{
+	using T = typename V::scalar;
+	detail::integrate_pass(positions, velocities, detail::UniformAcceleration<V>{acceleration}, pool,
+		[&](auto p, T* x, T* v, auto a) {
+			using P = decltype(p);
+			auto step = P::set1(dt);
+			auto old_v = P::load(v);
+			P::store(x, P::fmadd(P::mul(a, P::set1(dt / 2)), step, P::fmadd(old_v, step, P::load(x))));
+			P::store(v, P::fmadd(a, step, old_v));
+		});
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_INTEGRATE_HPP_INCLUDED
@@ -0,0 +1,301 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_KD_TREE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_KD_TREE_HPP_INCLUDED
+
+#include "neighbor.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "unroll.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace MathVector {
+
+// Static k-d tree over a point set, indices in results refer to the points as given.
+// Nodes live in one array in depth first order, the left child directly follows its parent.
+template <class V>
+class KdTree {
+public:
+	using scalar = typename V::scalar;
+	using neighbor = Neighbor<scalar>;
+	static constexpr std::size_t SIZE = V::SIZE;
+
+	explicit KdTree(Span<const V> points, std::size_t leaf_size = 8, ThreadPool& pool = default_pool())
+		: leaf(std::max<std::size_t>(leaf_size, 1))
+	{
+		if (points.size() > std::numeric_limits<std::uint32_t>::max())
+			throw std::length_error("too many points for a KdTree");
+		std::size_t count = points.size();
+		coords.resize(count * SIZE);
+		for (auto i = 0U; i < count; i++)
+			for (auto k = 0U; k < SIZE; k++)
+				coords[i * SIZE + k] = points[i][k];
+		order.resize(count);
+		std::iota(order.begin(), order.end(), 0U);
+		if (count == 0)
+			return;
+
+		nodes.resize(node_count(count));
+		build(pool);
+
+		// Store the points in tree order so leaves are contiguous
+		std::vector<scalar> sorted(count * SIZE);
+		for (auto i = 0U; i < count; i++)
+			for (auto k = 0U; k < SIZE; k++)
+				sorted[i * SIZE + k] = coords[order[i] * SIZE + k];
+		coords.swap(sorted);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return order.size();
+	}
+
+	// The k nearest points, closest first. Fewer when the tree holds fewer than k.
+	std::vector<neighbor> nearest(const V& query, std::size_t k) const
+	{
+		std::vector<neighbor> result(std::min(k, size()));
+		nearest(flatten(query).data(), result.size(), result.data());
+		return result;
+	}
+
+	// Every point within radius, closest first
+	std::vector<neighbor> within(const V& query, scalar radius) const
+	{
+		std::vector<neighbor> result;
+		within(flatten(query).data(), radius * radius, result);
+		return result;
+	}
+
+	// nearest for every query, row i of min(k, size()) neighbors belongs to queries[i]
+	std::vector<neighbor> batch_nearest(Span<const V> queries, std::size_t k, ThreadPool& pool = default_pool()) const
+	{
+		std::size_t row = std::min(k, size());
+		std::vector<neighbor> result(queries.size() * row);
+		parallel_for_chunks(queries.size(), 64, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++)
+				nearest(flatten(queries[i]).data(), row, result.data() + i * row);
+		}, pool);
+		return result;
+	}
+
+	std::vector<std::vector<neighbor>> batch_within(Span<const V> queries, scalar radius, ThreadPool& pool = default_pool()) const
+	{
+		std::vector<std::vector<neighbor>> result(queries.size());
+		parallel_for_chunks(queries.size(), 64, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++)
+				within(flatten(queries[i]).data(), radius * radius, result[i]);
+		}, pool);
+		return result;
+	}
+
+private:
+	struct Node {
+		scalar split;
+		std::uint32_t begin;
+		std::uint32_t end;
+		// 0 for leaves, the left child is always the next node
+		std::uint32_t right;
+		std::uint32_t axis;
+	};
+
+	struct Pending {
+		std::uint32_t node;
+		std::uint32_t begin;
+		std::uint32_t end;
+	};
+
+	// Deep enough for 2^32 points with leaves of one
+	static constexpr std::size_t MAX_DEPTH = 64;
+
+	std::size_t node_count(std::size_t count) const
+	{
+		return count <= leaf ? 1 : 1 + node_count(count / 2) + node_count(count - count / 2);
+	}
+
+	// Fills in node & partitions its points around the median of the widest axis
+	void split(const Pending& task, Pending children[2])
+	{
+		Node& node = nodes[task.node];
+		node.begin = task.begin;
+		node.end = task.end;
+		node.right = 0;
+		node.axis = 0;
+		node.split = 0;
+		if (task.end - task.begin <= leaf)
+			return;
+
+		scalar lo[SIZE], hi[SIZE];
+		for (auto k = 0U; k < SIZE; k++)
+			lo[k] = hi[k] = coords[order[task.begin] * SIZE + k];
+		for (auto i = task.begin + 1; i < task.end; i++) {
+			for (auto k = 0U; k < SIZE; k++) {
+				lo[k] = std::min(lo[k], coords[order[i] * SIZE + k]);
+				hi[k] = std::max(hi[k], coords[order[i] * SIZE + k]);
+			}
+		}
+		for (auto k = 1U; k < SIZE; k++)
+			if (hi[k] - lo[k] > hi[node.axis] - lo[node.axis])
+				node.axis = k;
+
+		std::uint32_t middle = task.begin + (task.end - task.begin) / 2;
+		auto axis = node.axis;
+		std::nth_element(order.begin() + task.begin, order.begin() + middle, order.begin() + task.end,
+			[&](std::uint32_t a, std::uint32_t b) {
+				return coords[a * SIZE + axis] < coords[b * SIZE + axis];
+			});
+		node.split = coords[order[middle] * SIZE + axis];
+		node.right = static_cast<std::uint32_t>(task.node + 1 + node_count(middle - task.begin));
+		children[0] = {task.node + 1, task.begin, middle};
+		children[1] = {node.right, middle, task.end};
+	}
+
+	void build_serial(const Pending& task)
+	{
+		Pending children[2];
+		split(task, children);
+		if (nodes[task.node].right != 0) {
+			build_serial(children[0]);
+			build_serial(children[1]);
+		}
+	}
+
+	// The top levels split one level at a time with the nodes of a level in parallel,
+	// once there's enough subtrees to go around they're finished off in parallel.
+	void build(ThreadPool& pool)
+	{
+		std::vector<Pending> frontier{{0, 0, static_cast<std::uint32_t>(size())}};
+		std::vector<Pending> next;
+		while (frontier.size() < pool.size() * 4) {
+			next.resize(frontier.size() * 2);
+			pool.parallel_for(frontier.size(), [&](std::size_t i) {
+				split(frontier[i], &next[i * 2]);
+			});
+			std::size_t kept = 0;
+			for (auto i = 0U; i < frontier.size(); i++) {
+				if (nodes[frontier[i].node].right != 0) {
+					next[kept++] = next[i * 2];
+					next[kept++] = next[i * 2 + 1];
+				}
+			}
+			next.resize(kept);
+			frontier.swap(next);
+			if (frontier.empty())
+				return;
+		}
+		pool.parallel_for(frontier.size(), [&](std::size_t i) {
+			build_serial(frontier[i]);
+		});
+	}
+
+	static std::array<scalar, SIZE> flatten(const V& vc)
+	{
+		std::array<scalar, SIZE> flat;
+		for (auto k = 0U; k < SIZE; k++)
+			flat[k] = vc[k];
+		return flat;
+	}
+
+	scalar squared_distance(const scalar* query, std::size_t i) const
+	{
+		const scalar* point = coords.data() + i * SIZE;
+		scalar sum = 0;
+		for_each_index<SIZE>([&](auto k) { sum += (point[k] - query[k]) * (point[k] - query[k]); });
+		return sum;
+	}
+
+	// Visits the leaves that may hold a point closer than bound(), nearest side first
+	template <class Bound, class Leaf>
+	void search(const scalar* query, Bound bound, Leaf visit) const
+	{
+		if (nodes.empty())
+			return;
+		struct Entry {
+			std::uint32_t node;
+			scalar squared_distance;
+		};
+		Entry stack[MAX_DEPTH];
+		std::size_t depth = 0;
+		stack[depth++] = {0, 0};
+		while (depth != 0) {
+			Entry entry = stack[--depth];
+			if (entry.squared_distance > bound())
+				continue;
+			const Node* node = &nodes[entry.node];
+			while (node->right != 0) {
+				scalar diff = query[node->axis] - node->split;
+				std::uint32_t near = diff < 0 ? entry.node + 1 : node->right;
+				std::uint32_t far = diff < 0 ? node->right : entry.node + 1;
+				stack[depth++] = {far, diff * diff};
+				entry.node = near;
+				node = &nodes[near];
+			}
+			for (auto i = node->begin; i < node->end; i++)
+				visit(i, squared_distance(query, i));
+		}
+	}
+
+	void nearest(const scalar* query, std::size_t k, neighbor* out) const
+	{
+		if (k == 0)
+			return;
+		std::size_t found = 0;
+		search(query,
+			[&] { return detail::neighbor_bound(out, found, k, std::numeric_limits<scalar>::max()); },
+			[&](std::size_t i, scalar squared) {
+				detail::offer_neighbor(out, found, k, neighbor{i, squared});
+			});
+		detail::sort_neighbors(out, k);
+		for (auto i = 0U; i < k; i++)
+			out[i].index = order[out[i].index];
+	}
+
+	void within(const scalar* query, scalar squared_radius, std::vector<neighbor>& out) const
+	{
+		out.clear();
+		search(query,
+			[&] { return squared_radius; },
+			[&](std::size_t i, scalar squared) {
+				if (squared <= squared_radius)
+					out.push_back({order[i], squared});
+			});
+		std::sort(out.begin(), out.end(), detail::closer<scalar>);
+	}
+
+	std::size_t leaf;
+	std::vector<Node> nodes;
+	// Point components in tree order & the original index of each point
+	std::vector<scalar> coords;
+	std::vector<std::uint32_t> order;
+};
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_KD_TREE_HPP_INCLUDED
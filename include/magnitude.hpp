@@ -0,0 +1,243 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_MAGNITUDE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_MAGNITUDE_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "span.hpp"
+#include "vector_functions.hpp"
+#include "vector_soa.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace MathVector {
+
+// Batch versions of the functor free magnitudes. Squared magnitudes are found per vector,
+// the square roots then run across SIMD lanes, & out of range vectors are fixed up after.
+
+namespace detail {
+
+// Vectors handled per block by the array of structures versions, so their outputs stay in L1
+constexpr std::size_t magnitude_block = 256;
+
+struct NoRoot {
+	template <class P>
+	static typename P::type apply(typename P::type squared) { return squared; }
+};
+
+struct ExactRoot {
+	template <class P>
+	static typename P::type apply(typename P::type squared) { return P::sqrt(squared); }
+};
+
+struct EstimatedRoot {
+	template <class P>
+	static typename P::type apply(typename P::type squared) { return estimate_sqrt<P>(squared); }
+};
+
+template <class V>
+void squared_magnitude_block(const V* vcs, std::size_t count, typename V::scalar* out)
+{
+	for (std::size_t i = 0; i < count; i++)
+		out[i] = squared_magnitude(vcs[i]);
+}
+
+template <class Root, class T>
+void root_block(T* out, std::size_t count)
+{
+	simd::for_each_pack<T>(count, [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		P::store(out + i, Root::template apply<P>(P::load(out + i)));
+	});
+}
+
+// out[i] holds squared magnitudes, which are replaced by their square roots
+template <class Root, class V>
+void magnitude_block_aos(const V* vcs, std::size_t count, typename V::scalar* out)
+{
+	squared_magnitude_block(vcs, count, out);
+	root_block<Root>(out, count);
+}
+
+// Magnitudes from in range squares are within these, squares outside them must be scaled
+template <class T>
+struct RootRange {
+	T low = std::sqrt(magnitude_min<T>);
+	T high = std::sqrt(std::numeric_limits<T>::max());
+
+	bool contains(T root) const { return root >= low && root <= high; }
+};
+
+// Exact square roots of a block of squares, like root_block. Also tells whether every root is in
+// range, from the smallest & largest root & their sum, which any NaN root turns to NaN.
+template <class T>
+bool checked_root_block(T* out, std::size_t count, const RootRange<T>& range)
+{
+	T smallest = std::numeric_limits<T>::max(), largest = 0, total = 0;
+	simd::for_each_pack<T>(count, [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto root = P::sqrt(P::load(out + i));
+		P::store(out + i, root);
+		smallest = std::min(smallest, P::hmin(root));
+		largest = std::max(largest, P::hmax(root));
+		total += P::hsum(root);
+	});
+	return smallest >= range.low && largest <= range.high && total == total;
+}
+
+template <class V>
+void scaled_magnitude_block_aos(const V* vcs, std::size_t count, typename V::scalar* out)
+{
+	RootRange<typename V::scalar> range;
+	squared_magnitude_block(vcs, count, out);
+	if (checked_root_block(out, count, range))
+		return;
+	for (std::size_t i = 0; i < count; i++)
+		if (!range.contains(out[i]))
+			out[i] = scaled_magnitude(vcs[i]);
+}
+
+template <class Block, class V>
+void for_each_magnitude_block(Span<const V> vcs, Span<typename V::scalar> out, Block block)
+{
+	assert(vcs.size() == out.size());
+	for (std::size_t i = 0; i < vcs.size(); i += magnitude_block)
+		block(vcs.data() + i, std::min(magnitude_block, vcs.size() - i), out.data() + i);
+}
+
+template <class V, class A>
+typename V::scalar squared_magnitude_at(const VectorSoA<V, A>& vcs, std::size_t i)
+{
+	typename V::scalar accumulated_val = 0;
+	for (auto k = 0U; k < V::SIZE; k++)
+		accumulated_val += vcs.lane(k)[i] * vcs.lane(k)[i];
+	return accumulated_val;
+}
+
+// Squared magnitudes of the structure of arrays, Root then maps them across the same lanes
+template <class Root, class V, class A>
+void magnitude_soa(const VectorSoA<V, A>& vcs, typename V::scalar* out)
+{
+	using T = typename V::scalar;
+	simd::for_each_pack<T>(vcs.size(), [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto acc = P::zero();
+		for (auto k = 0U; k < V::SIZE; k++) {
+			auto c = P::load(vcs.lane(k) + i);
+			acc = P::fmadd(c, c, acc);
+		}
+		P::store(out + i, Root::template apply<P>(acc));
+	});
+}
+
+}
+
+// out[i] = squared_magnitude(vcs[i])
+template <class V>
+void batch_squared_magnitude(Span<const V> vcs, Span<typename V::scalar> out)
+{
+	detail::for_each_magnitude_block(vcs, out, [](const V* in, std::size_t count, typename V::scalar* dst) {
+		detail::squared_magnitude_block(in, count, dst);
+	});
+}
+
+// out[i] = magnitude(vcs[i]), the square roots run across SIMD lanes
+template <class V>
+void batch_magnitude(Span<const V> vcs, Span<typename V::scalar> out)
+{
+	detail::for_each_magnitude_block(vcs, out, detail::magnitude_block_aos<detail::ExactRoot, V>);
+}
+
+// out[i] = fast_magnitude(vcs[i])
+template <class V>
+void batch_fast_magnitude(Span<const V> vcs, Span<typename V::scalar> out)
+{
+	detail::for_each_magnitude_block(vcs, out, detail::magnitude_block_aos<detail::EstimatedRoot, V>);
+}
+
+// out[i] = scaled_magnitude(vcs[i]), only out of range vectors are scaled
+template <class V>
+void batch_scaled_magnitude(Span<const V> vcs, Span<typename V::scalar> out)
+{
+	detail::for_each_magnitude_block(vcs, out, detail::scaled_magnitude_block_aos<V>);
+}
+
+template <class V, class A1, class A2>
+void batch_squared_magnitude(const std::vector<V, A1>& vcs, std::vector<typename V::scalar, A2>& out)
+{
+	batch_squared_magnitude(Span<const V>(vcs), Span<typename V::scalar>(out));
+}
+
+template <class V, class A1, class A2>
+void batch_magnitude(const std::vector<V, A1>& vcs, std::vector<typename V::scalar, A2>& out)
+{
+	batch_magnitude(Span<const V>(vcs), Span<typename V::scalar>(out));
+}
+
+template <class V, class A1, class A2>
+void batch_fast_magnitude(const std::vector<V, A1>& vcs, std::vector<typename V::scalar, A2>& out)
+{
+	batch_fast_magnitude(Span<const V>(vcs), Span<typename V::scalar>(out));
+}
+
+template <class V, class A1, class A2>
+void batch_scaled_magnitude(const std::vector<V, A1>& vcs, std::vector<typename V::scalar, A2>& out)
+{
+	batch_scaled_magnitude(Span<const V>(vcs), Span<typename V::scalar>(out));
+}
+
+// Structure of arrays versions, every step runs across SIMD lanes. batch_magnitude is in vector_soa.hpp.
+template <class V, class A>
+void batch_squared_magnitude(const VectorSoA<V, A>& vcs, typename V::scalar* out)
+{
+	detail::magnitude_soa<detail::NoRoot>(vcs, out);
+}
+
+template <class V, class A>
+void batch_fast_magnitude(const VectorSoA<V, A>& vcs, typename V::scalar* out)
+{
+	detail::magnitude_soa<detail::EstimatedRoot>(vcs, out);
+}
+
+template <class V, class A>
+void batch_scaled_magnitude(const VectorSoA<V, A>& vcs, typename V::scalar* out)
+{
+	detail::magnitude_soa<detail::ExactRoot>(vcs, out);
+	detail::RootRange<typename V::scalar> range;
+	for (std::size_t i = 0; i < vcs.size(); i++) {
+		if (range.contains(out[i]))
+			continue;
+		out[i] = detail::rescaled_magnitude(detail::squared_magnitude_at(vcs, i), [&](auto f) {
+			for (auto k = 0U; k < V::SIZE; k++)
+				f(vcs.lane(k)[i]);
+		});
+	}
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_MAGNITUDE_HPP_INCLUDED
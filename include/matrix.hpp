@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_MATRIX_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_MATRIX_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "vector_soa.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+namespace MathVector {
+
+// Row major R x C matrix, m[r][c] is the element in row r & column c.
+// Every operation but the rotations is constexpr, so transforms can be composed at compile time.
+template <class T, std::size_t R, std::size_t C = R>
+struct Matrix {
+	static constexpr std::size_t ROWS = R;
+	static constexpr std::size_t COLUMNS = C;
+	using scalar = T;
+
+	std::array<std::array<T, C>, R> rows{};
+
+	static constexpr Matrix identity()
+	{
+		static_assert(R == C, "only square matrices have an identity");
+		Matrix m;
+		for (auto k = 0U; k < R; k++)
+			m.rows[k][k] = T(1);
+		return m;
+	}
+
+	constexpr std::array<T, C>& operator[](std::size_t r)
+	{
+		assert(r < R);
+		return rows[r];
+	}
+
+	constexpr const std::array<T, C>& operator[](std::size_t r) const
+	{
+		assert(r < R);
+		return rows[r];
+	}
+};
+
+template <class T>
+using Matrix2 = Matrix<T, 2>;
+
+template <class T>
+using Matrix3 = Matrix<T, 3>;
+
+template <class T>
+using Matrix4 = Matrix<T, 4>;
+
+template <class T, std::size_t R, std::size_t C>
+constexpr bool operator==(const Matrix<T, R, C>& lhs, const Matrix<T, R, C>& rhs)
+{
+	for (auto r = 0U; r < R; r++)
+		for (auto c = 0U; c < C; c++)
+			if (lhs[r][c] != rhs[r][c])
+				return false;
+	return true;
+}
+
+template <class T, std::size_t R, std::size_t C>
+constexpr bool operator!=(const Matrix<T, R, C>& lhs, const Matrix<T, R, C>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+template <class T, std::size_t R, std::size_t K, std::size_t C>
+constexpr Matrix<T, R, C> operator*(const Matrix<T, R, K>& lhs, const Matrix<T, K, C>& rhs)
+{
+	Matrix<T, R, C> m;
+	for (auto r = 0U; r < R; r++)
+		for (auto k = 0U; k < K; k++)
+			for (auto c = 0U; c < C; c++)
+				m[r][c] += lhs[r][k] * rhs[k][c];
+	return m;
+}
+
+// Matrix times a column vector, V may be Vector2, Vector3 or Vector of the same length
+template <class T, std::size_t N, class V, typename std::enable_if_t<V::SIZE == N, int> = 0>
+constexpr V operator*(const Matrix<T, N>& lhs, const V& rhs)
+{
+	V vc{};
+	for (auto r = 0U; r < N; r++) {
+		T accumulated_val = 0;
+		for (auto c = 0U; c < N; c++)
+			accumulated_val += lhs[r][c] * rhs[c];
+		vc[r] = accumulated_val;
+	}
+	return vc;
+}
+
+template <class T, std::size_t R, std::size_t C>
+constexpr Matrix<T, C, R> transpose(const Matrix<T, R, C>& m)
+{
+	Matrix<T, C, R> t;
+	for (auto r = 0U; r < R; r++)
+		for (auto c = 0U; c < C; c++)
+			t[c][r] = m[r][c];
+	return t;
+}
+
+// Counter clockwise rotation of the plane by angle radians
+template <class T>
+Matrix2<T> rotation(T angle)
+{
+	T c = std::cos(angle), s = std::sin(angle);
+	Matrix2<T> m;
+	m[0] = {c, -s};
+	m[1] = {s, c};
+	return m;
+}
+
+// Right handed rotation by angle radians about axis, which must have length 1
+template <class V, typename std::enable_if_t<V::SIZE == 3, int> = 0>
+Matrix3<typename V::scalar> rotation(const V& axis, typename V::scalar angle)
+{
+	using T = typename V::scalar;
+	T c = std::cos(angle), s = std::sin(angle), t = 1 - c;
+	T x = axis[0], y = axis[1], z = axis[2];
+	Matrix3<T> m;
+	m[0] = {t * x * x + c, t * x * y - s * z, t * x * z + s * y};
+	m[1] = {t * x * y + s * z, t * y * y + c, t * y * z - s * x};
+	m[2] = {t * x * z - s * y, t * y * z + s * x, t * z * z + c};
+	return m;
+}
+
+// Affine transform of N space, p -> linear * p + offset.
+// Equivalent to an N + 1 square matrix with a last row of 0, ..., 0, 1, but half the work to apply.
+template <class T, std::size_t N>
+struct Affine {
+	using scalar = T;
+
+	Matrix<T, N> linear = Matrix<T, N>::identity();
+	std::array<T, N> offset{};
+
+	static constexpr Affine identity()
+	{
+		return Affine();
+	}
+
+	template <class V>
+	static constexpr Affine translation(const V& vc)
+	{
+		static_assert(V::SIZE == N, "translation has the wrong length");
+		Affine a;
+		for (auto k = 0U; k < N; k++)
+			a.offset[k] = vc[k];
+		return a;
+	}
+
+	static constexpr Affine scaling(const T& factor)
+	{
+		Affine a;
+		for (auto k = 0U; k < N; k++)
+			a.linear[k][k] = factor;
+		return a;
+	}
+
+	// Scales each axis by the matching component of factors
+	template <class V>
+	static constexpr Affine scaling(const V& factors)
+	{
+		static_assert(V::SIZE == N, "scaling has the wrong length");
+		Affine a;
+		for (auto k = 0U; k < N; k++)
+			a.linear[k][k] = factors[k];
+		return a;
+	}
+
+	// Takes the top N rows of a homogeneous matrix, the last row is assumed to be 0, ..., 0, 1
+	static constexpr Affine from_matrix(const Matrix<T, N + 1>& m)
+	{
+		Affine a;
+		for (auto r = 0U; r < N; r++) {
+			for (auto c = 0U; c < N; c++)
+				a.linear[r][c] = m[r][c];
+			a.offset[r] = m[r][N];
+		}
+		return a;
+	}
+
+	constexpr Matrix<T, N + 1> matrix() const
+	{
+		auto m = Matrix<T, N + 1>::identity();
+		for (auto r = 0U; r < N; r++) {
+			for (auto c = 0U; c < N; c++)
+				m[r][c] = linear[r][c];
+			m[r][N] = offset[r];
+		}
+		return m;
+	}
+
+	// Transforms a point, directions should be multiplied by linear alone
+	template <class V>
+	constexpr V operator()(const V& point) const
+	{
+		static_assert(V::SIZE == N, "point has the wrong length");
+		V vc = linear * point;
+		for (auto k = 0U; k < N; k++)
+			vc[k] += offset[k];
+		return vc;
+	}
+};
+
+template <class T, std::size_t N>
+constexpr bool operator==(const Affine<T, N>& lhs, const Affine<T, N>& rhs)
+{
+	for (auto k = 0U; k < N; k++)
+		if (lhs.offset[k] != rhs.offset[k])
+			return false;
+	return lhs.linear == rhs.linear;
+}
+
+template <class T, std::size_t N>
+constexpr bool operator!=(const Affine<T, N>& lhs, const Affine<T, N>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+// Composition, (lhs * rhs)(p) == lhs(rhs(p))
+template <class T, std::size_t N>
+constexpr Affine<T, N> operator*(const Affine<T, N>& lhs, const Affine<T, N>& rhs)
+{
+	Affine<T, N> a;
+	a.linear = lhs.linear * rhs.linear;
+	for (auto r = 0U; r < N; r++) {
+		T accumulated_val = lhs.offset[r];
+		for (auto c = 0U; c < N; c++)
+			accumulated_val += lhs.linear[r][c] * rhs.offset[c];
+		a.offset[r] = accumulated_val;
+	}
+	return a;
+}
+
+namespace detail {
+
+// Points per thread chunk, small batches are done on the calling thread
+constexpr std::size_t transform_grain = 1 << 14;
+
+// Roughly 16 KiB of points gathered into lanes at a time by the array of structures version
+template <class V>
+constexpr std::size_t transform_block = std::max<std::size_t>(1, (16 << 10) / sizeof(V));
+
+// Calls f(k) for k in [0, N), unrolled for the small dimensions so the packs stay in registers
+template <std::size_t N, class F>
+inline void transform_each(F&& f)
+{
+	if constexpr (N <= 8)
+		simd::unroll<N>(f);
+	else
+		for (std::size_t k = 0; k < N; k++)
+			f(k);
+}
+
+// Applies a to count points stored as N lanes, in & out may be the same lanes
+template <class T, std::size_t N>
+void transform_lanes(const Affine<T, N>& transform, const T* const* in, T* const* out, std::size_t count)
+{
+	// Copied so the optimizer knows the stores can't change it & keeps it in registers
+	const Affine<T, N> a = transform;
+	simd::for_each_pack<T>(count, [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		typename P::type c[N], r[N];
+		transform_each<N>([&](auto k) { c[k] = P::load(in[k] + i); });
+		transform_each<N>([&](auto row) {
+			auto acc = P::set1(a.offset[row]);
+			transform_each<N>([&](auto col) { acc = P::fmadd(P::set1(a.linear[row][col]), c[col], acc); });
+			r[row] = acc;
+		});
+		transform_each<N>([&](auto k) { P::store(out[k] + i, r[k]); });
+	});
+}
+
+}
+
+// out[i] = a(in[i]). Blocks of points are gathered into lanes, transformed with SIMD & scattered back,
+// large batches are split across the pool. in & out may be the same array.
+template <class T, std::size_t N, class V>
+void transform_points(const Affine<T, N>& a, Span<const V> in, Span<V> out, ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == N && std::is_same_v<typename V::scalar, T>, "points don't match the transform");
+	assert(in.size() == out.size());
+	constexpr std::size_t block = detail::transform_block<V>;
+	static_assert(std::is_standard_layout_v<V> && sizeof(V) == N * sizeof(T),
+		"vector components must be tightly packed");
+	const T* flat_in = reinterpret_cast<const T*>(in.data());
+	T* flat_out = reinterpret_cast<T*>(out.data());
+	parallel_for_chunks(in.size(), detail::transform_grain, [&](std::size_t begin, std::size_t end) {
+		T lanes[N * block];
+		T* lane_ptrs[N];
+		for (auto k = 0U; k < N; k++)
+			lane_ptrs[k] = lanes + k * block;
+
+		for (auto i = begin; i < end; i += block) {
+			auto count = std::min(block, end - i);
+			const T* src = flat_in + i * N;
+			for (auto j = 0U; j < count; j++)
+				detail::transform_each<N>([&](auto k) { lanes[k * block + j] = src[j * N + k]; });
+			detail::transform_lanes(a, lane_ptrs, lane_ptrs, count);
+			T* dst = flat_out + i * N;
+			for (auto j = 0U; j < count; j++)
+				detail::transform_each<N>([&](auto k) { dst[j * N + k] = lanes[k * block + j]; });
+		}
+	}, pool);
+}
+
+// Transforms every point in place
+template <class T, std::size_t N, class V>
+void transform_points(const Affine<T, N>& a, Span<V> vcs, ThreadPool& pool = default_pool())
+{
+	transform_points(a, Span<const V>(vcs), vcs, pool);
+}
+
+template <class T, std::size_t N, class V, class A>
+void transform_points(const Affine<T, N>& a, std::vector<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	transform_points(a, Span<V>(vcs), pool);
+}
+
+// Structure of arrays version, the lanes are used directly. in & out may be the same batch.
+template <class T, std::size_t N, class V, class A>
+void transform_points(const Affine<T, N>& a, const VectorSoA<V, A>& in, VectorSoA<V, A>& out,
+	ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == N && std::is_same_v<typename V::scalar, T>, "points don't match the transform");
+	assert(in.size() == out.size());
+	parallel_for_chunks(in.size(), detail::transform_grain, [&](std::size_t begin, std::size_t end) {
+		const T* in_lanes[N];
+		T* out_lanes[N];
+		for (auto k = 0U; k < N; k++) {
+			in_lanes[k] = in.lane(k) + begin;
+			out_lanes[k] = out.lane(k) + begin;
+		}
+		detail::transform_lanes(a, in_lanes, out_lanes, end - begin);
+	}, pool);
+}
+
+template <class T, std::size_t N, class V, class A>
+void transform_points(const Affine<T, N>& a, VectorSoA<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	transform_points(a, vcs, vcs, pool);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_MATRIX_HPP_INCLUDED
@@ -0,0 +1,220 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_MESH_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_MESH_HPP_INCLUDED
+
+#include "normalize.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "vector_functions.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace MathVector {
+
+// Three indices into a vertex array, counter clockwise when seen from the front
+template <class I>
+using Triangle = std::array<I, 3>;
+
+// The triangles touching each vertex, stored contiguously per vertex & in increasing order.
+// Build it once for a mesh's topology & reuse it while the vertices move.
+class VertexTriangles {
+public:
+	VertexTriangles() = default;
+
+	template <class I>
+	VertexTriangles(std::size_t vertex_count, Span<const Triangle<I>> triangles, ThreadPool& pool = default_pool())
+	{
+		build(vertex_count, triangles, pool);
+	}
+
+	// Replaces the adjacency, buffers are kept between builds
+	template <class I>
+	void build(std::size_t vertex_count, Span<const Triangle<I>> triangles, ThreadPool& pool = default_pool())
+	{
+		if (triangles.size() > std::numeric_limits<std::uint32_t>::max() / 3)
+			throw std::length_error("too many triangles for VertexTriangles");
+		if (vertex_count > counter_capacity) {
+			counters.reset(new std::atomic<std::uint32_t>[vertex_count]);
+			counter_capacity = vertex_count;
+		}
+		starts.resize(vertex_count + 1);
+		ids.resize(triangles.size() * 3);
+
+		std::size_t grain = 4096;
+		parallel_for_chunks(vertex_count, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto v = begin; v < end; v++)
+				counters[v].store(0, std::memory_order_relaxed);
+		}, pool);
+		std::atomic<bool> out_of_range(false);
+		parallel_for_chunks(triangles.size(), grain, [&](std::size_t begin, std::size_t end) {
+			for (auto t = begin; t < end; t++) {
+				for (auto corner : triangles[t]) {
+					if (static_cast<std::size_t>(corner) >= vertex_count) {
+						out_of_range.store(true, std::memory_order_relaxed);
+						continue;
+					}
+					counters[corner].fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		}, pool);
+		if (out_of_range.load())
+			throw std::out_of_range("triangle refers to a vertex past the end");
+
+		std::uint32_t total = 0;
+		for (auto v = 0U; v < vertex_count; v++) {
+			starts[v] = total;
+			total += counters[v].load(std::memory_order_relaxed);
+			counters[v].store(starts[v], std::memory_order_relaxed);
+		}
+		starts[vertex_count] = total;
+
+		parallel_for_chunks(triangles.size(), grain, [&](std::size_t begin, std::size_t end) {
+			for (auto t = begin; t < end; t++)
+				for (auto corner : triangles[t])
+					ids[counters[corner].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(t);
+		}, pool);
+
+		// The scatter above races within a vertex, sorting makes the order, & so float sums, repeatable
+		parallel_for_chunks(vertex_count, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto v = begin; v < end; v++)
+				if (starts[v + 1] - starts[v] > 1)
+					std::sort(ids.begin() + starts[v], ids.begin() + starts[v + 1]);
+		}, pool);
+	}
+
+	std::size_t vertex_count() const noexcept
+	{
+		return starts.empty() ? 0 : starts.size() - 1;
+	}
+
+	Span<const std::uint32_t> operator[](std::size_t vertex) const
+	{
+		assert(vertex < vertex_count());
+		return Span<const std::uint32_t>(ids.data() + starts[vertex], starts[vertex + 1] - starts[vertex]);
+	}
+
+private:
+	std::vector<std::uint32_t> starts;
+	std::vector<std::uint32_t> ids;
+	std::unique_ptr<std::atomic<std::uint32_t>[]> counters;
+	std::size_t counter_capacity = 0;
+};
+
+namespace detail {
+
+// Triangles per thread chunk
+constexpr std::size_t mesh_grain = 1 << 13;
+
+// Normal of a triangle with length twice its area
+template <class V, class I>
+inline V face_cross(const V* vertices, const Triangle<I>& triangle)
+{
+	const V& a = vertices[triangle[0]];
+	return cross_product(vertices[triangle[1]] - a, vertices[triangle[2]] - a);
+}
+
+}
+
+// out[t] = the unit normal of triangles[t], or zero for a degenerate triangle
+template <class V, class I>
+void face_normals(Span<const V> vertices, Span<const Triangle<I>> triangles, Span<V> out,
+	ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == 3, "face normals need three space vectors");
+	assert(out.size() == triangles.size());
+	parallel_for_chunks(triangles.size(), detail::mesh_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto t = begin; t < end; t++)
+			out.data()[t] = detail::face_cross(vertices.data(), triangles.data()[t]);
+		Span<V> chunk = out.subspan(begin, end - begin);
+		normalize_batch(Span<const V>(chunk), chunk);
+	}, pool);
+}
+
+// out[t] = the area of triangles[t]
+template <class V, class I>
+void face_areas(Span<const V> vertices, Span<const Triangle<I>> triangles, Span<typename V::scalar> out,
+	ThreadPool& pool = default_pool())
+{
+	using T = typename V::scalar;
+	static_assert(V::SIZE == 3, "face areas need three space vectors");
+	assert(out.size() == triangles.size());
+	parallel_for_chunks(triangles.size(), detail::mesh_grain, [&](std::size_t begin, std::size_t end) {
+		T* areas = out.data() + begin;
+		for (auto t = begin; t < end; t++) {
+			V cross = detail::face_cross(vertices.data(), triangles.data()[t]);
+			areas[t - begin] = dot_product(cross, cross);
+		}
+		simd::for_each_pack<T>(end - begin, [&](auto p, std::size_t i) {
+			using P = decltype(p);
+			P::store(areas + i, P::mul(P::set1(T(0.5)), P::sqrt(P::load(areas + i))));
+		});
+	}, pool);
+}
+
+// out[v] = the unit sum of the normals of the triangles around vertex v, weighted by their areas,
+// or zero where they cancel or there are none. Each thread sums over its own vertices using the
+// adjacency, so no two threads write the same vertex & nothing needs atomics.
+template <class V, class I>
+void vertex_normals(Span<const V> vertices, Span<const Triangle<I>> triangles, const VertexTriangles& adjacency,
+	Span<V> out, ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == 3, "vertex normals need three space vectors");
+	assert(adjacency.vertex_count() == vertices.size() && out.size() == vertices.size());
+	std::vector<V> crosses(triangles.size());
+	parallel_for_chunks(triangles.size(), detail::mesh_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto t = begin; t < end; t++)
+			crosses[t] = detail::face_cross(vertices.data(), triangles.data()[t]);
+	}, pool);
+
+	parallel_for_chunks(vertices.size(), detail::mesh_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto v = begin; v < end; v++) {
+			V sum{};
+			for (auto t : adjacency[v])
+				sum += crosses[t];
+			out.data()[v] = sum;
+		}
+		Span<V> chunk = out.subspan(begin, end - begin);
+		normalize_batch(Span<const V>(chunk), chunk);
+	}, pool);
+}
+
+// Builds the adjacency for a single use, keep a VertexTriangles when the topology doesn't change
+template <class V, class I>
+void vertex_normals(Span<const V> vertices, Span<const Triangle<I>> triangles, Span<V> out,
+	ThreadPool& pool = default_pool())
+{
+	vertex_normals(vertices, triangles, VertexTriangles(vertices.size(), triangles, pool), out, pool);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_MESH_HPP_INCLUDED
@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_NEIGHBOR_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_NEIGHBOR_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+
+namespace MathVector {
+
+// A point found by a search, index into the searched set & its squared distance from the query
+template <class T>
+struct Neighbor {
+	std::size_t index;
+	T squared_distance;
+};
+
+namespace detail {
+
+template <class T>
+inline bool closer(const Neighbor<T>& a, const Neighbor<T>& b)
+{
+	return a.squared_distance < b.squared_distance;
+}
+
+// Keeps the k closest candidates offered so far in out[0, found) as a max heap
+template <class T>
+inline void offer_neighbor(Neighbor<T>* out, std::size_t& found, std::size_t k, const Neighbor<T>& candidate)
+{
+	if (found < k) {
+		out[found++] = candidate;
+		std::push_heap(out, out + found, closer<T>);
+	}
+	else if (candidate.squared_distance < out[0].squared_distance) {
+		std::pop_heap(out, out + k, closer<T>);
+		out[k - 1] = candidate;
+		std::push_heap(out, out + k, closer<T>);
+	}
+}
+
+// Squared distance a candidate must beat to be kept
+template <class T>
+inline T neighbor_bound(const Neighbor<T>* out, std::size_t found, std::size_t k, T none)
+{
+	return found < k ? none : out[0].squared_distance;
+}
+
+// Turns the heap into a list sorted closest first
+template <class T>
+inline void sort_neighbors(Neighbor<T>* out, std::size_t found)
+{
+	std::sort_heap(out, out + found, closer<T>);
+}
+
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_NEIGHBOR_HPP_INCLUDED
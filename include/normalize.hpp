@@ -0,0 +1,142 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_NORMALIZE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_NORMALIZE_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "span.hpp"
+#include "vector_soa.hpp"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace MathVector {
+
+// Precision policies for the batch normalization, each maps squared lengths to 1 / length.
+
+// 1 / sqrt, correctly rounded
+struct ExactNormalization {
+	template <class P>
+	static typename P::type inverse_length(typename P::type squared)
+	{
+		return P::div(P::set1(1), P::sqrt(squared));
+	}
+};
+
+// Hardware reciprocal square root estimate refined by one Newton-Raphson step,
+// about 22 bits for float. Types without an estimate get the exact value.
+struct FastNormalization {
+	template <class P>
+	static typename P::type inverse_length(typename P::type squared)
+	{
+		auto y = P::rsqrt(squared);
+		auto half = P::mul(P::set1(0.5), squared);
+		return P::mul(y, P::sub(P::set1(1.5), P::mul(half, P::mul(y, y))));
+	}
+};
+
+namespace detail {
+
+// Vectors handled per block by the array of structures versions
+constexpr std::size_t normalize_block = 64;
+
+template <class Policy, class V>
+void normalize_block_aos(const V* in, V* out, std::size_t count, const V& fallback)
+{
+	using T = typename V::scalar;
+	T inverse[normalize_block];
+
+	for (auto i = 0U; i < count; i++) {
+		T squared = 0;
+		for (auto k = 0U; k < V::SIZE; k++)
+			squared += in[i][k] * in[i][k];
+		inverse[i] = squared;
+	}
+
+	// Zero vectors get an inverse of zero here & the fallback below, without a branch
+	simd::for_each_pack<T>(count, [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto squared = P::load(inverse + i);
+		auto valid = P::greater(squared, P::zero());
+		P::store(inverse + i, P::select(valid, Policy::template inverse_length<P>(squared), P::zero()));
+	});
+
+	for (auto i = 0U; i < count; i++) {
+		bool valid = inverse[i] != 0;
+		for (auto k = 0U; k < V::SIZE; k++)
+			out[i][k] = valid ? in[i][k] * inverse[i] : fallback[k];
+	}
+}
+
+}
+
+// out[i] = in[i] scaled to length 1, or fallback where in[i] is trivial.
+// in & out may be the same array.
+template <class Policy = ExactNormalization, class V>
+void normalize_batch(Span<const V> in, Span<V> out, const V& fallback = V{})
+{
+	assert(in.size() == out.size());
+	for (std::size_t i = 0; i < in.size(); i += detail::normalize_block) {
+		auto count = std::min(detail::normalize_block, in.size() - i);
+		detail::normalize_block_aos<Policy>(in.data() + i, out.data() + i, count, fallback);
+	}
+}
+
+// Normalizes every vector in place
+template <class Policy = ExactNormalization, class V>
+void normalize_batch(Span<V> vcs, const V& fallback = V{})
+{
+	normalize_batch<Policy>(Span<const V>(vcs), vcs, fallback);
+}
+
+template <class Policy = ExactNormalization, class V, class A>
+void normalize_batch(std::vector<V, A>& vcs, const V& fallback = V{})
+{
+	normalize_batch<Policy>(Span<V>(vcs), fallback);
+}
+
+// Structure of arrays version, every step runs across SIMD lanes
+template <class Policy = ExactNormalization, class V, class A>
+void normalize_batch(VectorSoA<V, A>& vcs, const V& fallback = V{})
+{
+	using T = typename V::scalar;
+	simd::for_each_pack<T>(vcs.size(), [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto squared = P::zero();
+		for (auto k = 0U; k < V::SIZE; k++) {
+			auto c = P::load(vcs.lane(k) + i);
+			squared = P::add(squared, P::mul(c, c));
+		}
+		auto valid = P::greater(squared, P::zero());
+		auto inverse = Policy::template inverse_length<P>(squared);
+		for (auto k = 0U; k < V::SIZE; k++) {
+			auto c = P::load(vcs.lane(k) + i);
+			P::store(vcs.lane(k) + i, P::select(valid, P::mul(c, inverse), P::set1(fallback[k])));
+		}
+	});
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_NORMALIZE_HPP_INCLUDED
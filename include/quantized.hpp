@@ -0,0 +1,351 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_QUANTIZED_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_QUANTIZED_HPP_INCLUDED
+
+#include "simd_dispatch.hpp"
+#include "vector_array.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace MathVector {
+
+// Vector stored as one signed byte per component & a shared scale, component k is scale * codes[k].
+// The scale maps the largest magnitude component to 127, a quarter of the size of float.
+template <std::size_t N>
+struct Int8Vector {
+	static constexpr std::size_t SIZE = N;
+	std::array<std::int8_t, N> codes;
+	float scale;
+};
+
+// Vector of IEEE 754 half precision floats, kept as their bit patterns
+template <std::size_t N>
+struct HalfVector {
+	static constexpr std::size_t SIZE = N;
+	std::array<std::uint16_t, N> bits;
+};
+
+// Rounds to nearest even, too large values become infinity & NaN stays NaN
+inline std::uint16_t float_to_half(float value)
+{
+	std::uint32_t f;
+	std::memcpy(&f, &value, sizeof(f));
+	std::uint32_t sign = f & 0x80000000U;
+	f ^= sign;
+
+	std::uint16_t half;
+	if (f >= (127U + 16U) << 23) {
+		half = f > 0x7f800000U ? 0x7e00 : 0x7c00;
+	}
+	else if (f < 113U << 23) {
+		// Subnormal result, let float addition do the rounding
+		const std::uint32_t magic_bits = ((127U - 15U) + (23U - 10U) + 1U) << 23;
+		float magic, shifted;
+		std::memcpy(&magic, &magic_bits, sizeof(magic));
+		std::memcpy(&shifted, &f, sizeof(shifted));
+		shifted += magic;
+		std::memcpy(&f, &shifted, sizeof(f));
+		half = static_cast<std::uint16_t>(f - magic_bits);
+	}
+	else {
+		std::uint32_t odd = (f >> 13) & 1;
+		f += ((15U - 127U) << 23) + 0xfff + odd;
+		half = static_cast<std::uint16_t>(f >> 13);
+	}
+	return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+inline float half_to_float(std::uint16_t half)
+{
+	// Shifting lines up the fields, the multiply fixes the exponent bias & normalizes subnormals
+	std::uint32_t bits = static_cast<std::uint32_t>(half & 0x7fff) << 13;
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	value *= 0x1p112f;
+	std::memcpy(&bits, &value, sizeof(bits));
+	if ((half & 0x7c00) == 0x7c00)
+		bits = 0x7f800000U | static_cast<std::uint32_t>(half & 0x3ff) << 13;
+	bits |= static_cast<std::uint32_t>(half & 0x8000) << 16;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Integer components are scaled in float, so the scale isn't truncated by integer division
+template <class T, std::size_t N>
+Int8Vector<N> quantize_int8(const Vector<T, N>& vc)
+{
+	using S = std::conditional_t<std::is_floating_point_v<T>, T, float>;
+	S largest = 0;
+	for (auto k = 0U; k < N; k++)
+		largest = std::max(largest, std::abs(static_cast<S>(vc[k])));
+	Int8Vector<N> result;
+	result.scale = static_cast<float>(largest / 127);
+	S inverse = largest == 0 ? S(0) : 127 / largest;
+	for (auto k = 0U; k < N; k++)
+		result.codes[k] = static_cast<std::int8_t>(std::lround(static_cast<S>(vc[k]) * inverse));
+	return result;
+}
+
+template <class T, std::size_t N>
+HalfVector<N> quantize_half(const Vector<T, N>& vc)
+{
+	HalfVector<N> result;
+	for (auto k = 0U; k < N; k++)
+		result.bits[k] = float_to_half(static_cast<float>(vc[k]));
+	return result;
+}
+
+template <class T = float, std::size_t N>
+Vector<T, N> dequantize(const Int8Vector<N>& q)
+{
+	Vector<T, N> result;
+	for (auto k = 0U; k < N; k++)
+		result[k] = static_cast<T>(q.scale * q.codes[k]);
+	return result;
+}
+
+template <class T = float, std::size_t N>
+Vector<T, N> dequantize(const HalfVector<N>& q)
+{
+	Vector<T, N> result;
+	for (auto k = 0U; k < N; k++)
+		result[k] = static_cast<T>(half_to_float(q.bits[k]));
+	return result;
+}
+
+namespace detail {
+
+// Integer sums of a.b, a.a & b.b over the codes, products are summed in 16 bit pairs & then 32 bits
+struct Int8Sums {
+	std::int32_t ab = 0;
+	std::int32_t aa = 0;
+	std::int32_t bb = 0;
+};
+
+template <bool SQUARES>
+inline void scalar_int8_sums(const std::int8_t* a, const std::int8_t* b, std::size_t k, std::size_t n, Int8Sums& sums)
+{
+	for (; k < n; k++) {
+		sums.ab += a[k] * b[k];
+		if (SQUARES) {
+			sums.aa += a[k] * a[k];
+			sums.bb += b[k] * b[k];
+		}
+	}
+}
+
+template <bool SQUARES>
+Int8Sums scalar_int8_sums(const std::int8_t* a, const std::int8_t* b, std::size_t n)
+{
+	Int8Sums sums;
+	scalar_int8_sums<SQUARES>(a, b, 0, n, sums);
+	return sums;
+}
+
+// Half sums add up a * b over the components as floats, or (a - b)^2 when DISTANCE is set
+template <bool DISTANCE>
+inline float half_step(float a, float b, float acc)
+{
+	return DISTANCE ? acc + (a - b) * (a - b) : acc + a * b;
+}
+
+template <bool DISTANCE>
+float scalar_half_sum(const std::uint16_t* a, const std::uint16_t* b, std::size_t n)
+{
+	float sum = 0;
+	for (std::size_t k = 0; k < n; k++)
+		sum = half_step<DISTANCE>(half_to_float(a[k]), half_to_float(b[k]), sum);
+	return sum;
+}
+
+#if MATHVECTOR_SIMD_DISPATCH
+
+// Vector types only ever cross calls between functions of the same target
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+template <bool SQUARES>
+MATHVECTOR_TARGET("sse2") Int8Sums sse2_int8_sums(const std::int8_t* a, const std::int8_t* b, std::size_t n)
+{
+	__m128i ab = _mm_setzero_si128(), aa = ab, bb = ab;
+	std::size_t k = 0;
+	for (; k + 16 <= n; k += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k));
+		// Sign extend by placing each byte in the high half & shifting down
+		__m128i a_lo = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8), a_hi = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+		__m128i b_lo = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8), b_hi = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+		ab = _mm_add_epi32(ab, _mm_add_epi32(_mm_madd_epi16(a_lo, b_lo), _mm_madd_epi16(a_hi, b_hi)));
+		if (SQUARES) {
+			aa = _mm_add_epi32(aa, _mm_add_epi32(_mm_madd_epi16(a_lo, a_lo), _mm_madd_epi16(a_hi, a_hi)));
+			bb = _mm_add_epi32(bb, _mm_add_epi32(_mm_madd_epi16(b_lo, b_lo), _mm_madd_epi16(b_hi, b_hi)));
+		}
+	}
+	alignas(16) std::int32_t lanes[3][4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), ab);
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), aa);
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), bb);
+	Int8Sums sums;
+	for (auto lane = 0U; lane < 4; lane++) {
+		sums.ab += lanes[0][lane];
+		sums.aa += lanes[1][lane];
+		sums.bb += lanes[2][lane];
+	}
+	scalar_int8_sums<SQUARES>(a, b, k, n, sums);
+	return sums;
+}
+
+template <bool SQUARES>
+MATHVECTOR_TARGET("avx2") Int8Sums avx2_int8_sums(const std::int8_t* a, const std::int8_t* b, std::size_t n)
+{
+	// Codes stay within [-127, 127], so |a| as unsigned times b with a's sign fits maddubs' 16 bit pairs
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i ab = _mm256_setzero_si256(), aa = ab, bb = ab;
+	std::size_t k = 0;
+	for (; k + 32 <= n; k += 32) {
+		__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k));
+		__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k));
+		__m256i abs_a = _mm256_sign_epi8(va, va);
+		ab = _mm256_add_epi32(ab, _mm256_madd_epi16(_mm256_maddubs_epi16(abs_a, _mm256_sign_epi8(vb, va)), ones));
+		if (SQUARES) {
+			__m256i abs_b = _mm256_sign_epi8(vb, vb);
+			aa = _mm256_add_epi32(aa, _mm256_madd_epi16(_mm256_maddubs_epi16(abs_a, abs_a), ones));
+			bb = _mm256_add_epi32(bb, _mm256_madd_epi16(_mm256_maddubs_epi16(abs_b, abs_b), ones));
+		}
+	}
+	alignas(32) std::int32_t lanes[3][8];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), ab);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), aa);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), bb);
+	Int8Sums sums;
+	for (auto lane = 0U; lane < 8; lane++) {
+		sums.ab += lanes[0][lane];
+		sums.aa += lanes[1][lane];
+		sums.bb += lanes[2][lane];
+	}
+	scalar_int8_sums<SQUARES>(a, b, k, n, sums);
+	return sums;
+}
+
+template <bool DISTANCE>
+MATHVECTOR_TARGET("avx,f16c") __m256 f16c_half_step(const std::uint16_t* a, const std::uint16_t* b, __m256 acc)
+{
+	__m256 va = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+	__m256 vb = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+	__m256 product = DISTANCE ? _mm256_mul_ps(_mm256_sub_ps(va, vb), _mm256_sub_ps(va, vb)) : _mm256_mul_ps(va, vb);
+	return _mm256_add_ps(acc, product);
+}
+
+// 8 components at a time, independent accumulators hide the add latency
+template <bool DISTANCE>
+MATHVECTOR_TARGET("avx,f16c") float f16c_half_sum(const std::uint16_t* a, const std::uint16_t* b, std::size_t n)
+{
+	__m256 acc[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+	std::size_t k = 0;
+	for (; k + 32 <= n; k += 32)
+		for (auto r = 0U; r < 4; r++)
+			acc[r] = f16c_half_step<DISTANCE>(a + k + r * 8, b + k + r * 8, acc[r]);
+	for (; k + 8 <= n; k += 8)
+		acc[0] = f16c_half_step<DISTANCE>(a + k, b + k, acc[0]);
+	alignas(32) float lanes[8];
+	_mm256_store_ps(lanes, _mm256_add_ps(_mm256_add_ps(acc[0], acc[1]), _mm256_add_ps(acc[2], acc[3])));
+	float sum = 0;
+	for (auto lane : lanes)
+		sum += lane;
+	for (; k < n; k++)
+		sum = half_step<DISTANCE>(half_to_float(a[k]), half_to_float(b[k]), sum);
+	return sum;
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+// The best kernels for the running cpu, chosen on first use like simd::kernels
+template <bool SQUARES>
+inline Int8Sums int8_sums(const std::int8_t* a, const std::int8_t* b, std::size_t n)
+{
+	using Kernel = Int8Sums (*)(const std::int8_t*, const std::int8_t*, std::size_t);
+#if MATHVECTOR_SIMD_DISPATCH
+	static const Kernel kernel = simd::supported(simd::Isa::avx2) ? avx2_int8_sums<SQUARES> : sse2_int8_sums<SQUARES>;
+#else
+	static const Kernel kernel = scalar_int8_sums<SQUARES>;
+#endif
+	return kernel(a, b, n);
+}
+
+template <bool DISTANCE>
+inline float half_sum(const std::uint16_t* a, const std::uint16_t* b, std::size_t n)
+{
+	using Kernel = float (*)(const std::uint16_t*, const std::uint16_t*, std::size_t);
+#if MATHVECTOR_SIMD_DISPATCH
+	static const Kernel kernel = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c") ? f16c_half_sum<DISTANCE> : scalar_half_sum<DISTANCE>;
+	}();
+#else
+	static const Kernel kernel = scalar_half_sum<DISTANCE>;
+#endif
+	return kernel(a, b, n);
+}
+
+}
+
+// Dot products & squared distances computed straight from the compressed forms.
+// For int8 the code products are summed exactly in 32 bit integers & scaled once.
+template <std::size_t N>
+float dot_product(const Int8Vector<N>& lhs, const Int8Vector<N>& rhs)
+{
+	auto sums = detail::int8_sums<false>(lhs.codes.data(), rhs.codes.data(), N);
+	return lhs.scale * rhs.scale * static_cast<float>(sums.ab);
+}
+
+template <std::size_t N>
+float squared_distance(const Int8Vector<N>& lhs, const Int8Vector<N>& rhs)
+{
+	auto sums = detail::int8_sums<true>(lhs.codes.data(), rhs.codes.data(), N);
+	float a = lhs.scale, b = rhs.scale;
+	return std::max(0.0f, a * a * sums.aa + b * b * sums.bb - 2 * a * b * sums.ab);
+}
+
+template <std::size_t N>
+float dot_product(const HalfVector<N>& lhs, const HalfVector<N>& rhs)
+{
+	return detail::half_sum<false>(lhs.bits.data(), rhs.bits.data(), N);
+}
+
+template <std::size_t N>
+float squared_distance(const HalfVector<N>& lhs, const HalfVector<N>& rhs)
+{
+	return detail::half_sum<true>(lhs.bits.data(), rhs.bits.data(), N);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_QUANTIZED_HPP_INCLUDED
@@ -0,0 +1,282 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_QUATERNION_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_QUATERNION_HPP_INCLUDED
+
+#include "matrix.hpp"
+#include <cmath>
+#include <optional>
+
+namespace MathVector {
+
+// w + xi + yj + zk. Unit quaternions represent rotations of three space.
+// SIZE, scalar & operator[] let it be stored in a VectorSoA, in the order w, x, y, z.
+template <class T>
+struct Quaternion {
+	T w, x, y, z;
+
+	static constexpr std::size_t SIZE = 4;
+	using scalar = T;
+
+	constexpr Quaternion() noexcept(std::is_nothrow_default_constructible<T>()) = default;
+	constexpr Quaternion(const T& val_w, const T& val_x, const T& val_y, const T& val_z) noexcept
+		: w(val_w), x(val_x), y(val_y), z(val_z) {}
+
+	static constexpr Quaternion identity()
+	{
+		return Quaternion(1, 0, 0, 0);
+	}
+
+	// Right handed rotation by angle radians about axis, which must have length 1
+	template <class V>
+	static Quaternion from_axis_angle(const V& axis, T angle)
+	{
+		static_assert(V::SIZE == 3, "the axis must be three space");
+		T s = std::sin(angle / 2);
+		return Quaternion(std::cos(angle / 2), axis[0] * s, axis[1] * s, axis[2] * s);
+	}
+
+	constexpr const T& operator[](std::size_t i) const
+	{
+		assert(i < SIZE);
+
+		if (i == 0)
+			return w;
+		if (i == 1)
+			return x;
+		if (i == 2)
+			return y;
+
+		return z;
+	}
+
+	constexpr T& operator[](std::size_t i)
+	{
+		return const_cast<T&>(const_cast<const Quaternion<T>*>(this)->operator[](i));
+	}
+
+	constexpr Quaternion<T> operator-() const
+	{
+		return Quaternion(-w, -x, -y, -z);
+	}
+
+	// Hamilton product, rotating by *this * rhs rotates by rhs first
+	constexpr Quaternion<T>& operator*=(const Quaternion<T>& rhs)
+	{
+		*this = Quaternion(
+			w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z,
+			w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y,
+			w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x,
+			w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w);
+		return *this;
+	}
+
+	// Rotation matrix of a unit quaternion
+	constexpr Matrix3<T> matrix() const
+	{
+		Matrix3<T> m;
+		m[0] = {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)};
+		m[1] = {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)};
+		m[2] = {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)};
+		return m;
+	}
+};
+
+template <class T>
+constexpr bool operator==(const Quaternion<T>& lhs, const Quaternion<T>& rhs)
+{
+	return lhs.w == rhs.w && lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+}
+
+template <class T>
+constexpr bool operator!=(const Quaternion<T>& lhs, const Quaternion<T>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+template <class T>
+constexpr Quaternion<T> operator*(Quaternion<T> lhs, const Quaternion<T>& rhs)
+{
+	return lhs *= rhs;
+}
+
+// The inverse of a unit quaternion
+template <class T>
+constexpr Quaternion<T> conjugate(const Quaternion<T>& q)
+{
+	return Quaternion<T>(q.w, -q.x, -q.y, -q.z);
+}
+
+template <class T>
+constexpr T squared_norm(const Quaternion<T>& q)
+{
+	return q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+}
+
+// q scaled to norm 1, or no value if q is zero
+template <class T>
+std::optional<Quaternion<T>> normalize(const Quaternion<T>& q)
+{
+	T squared = squared_norm(q);
+	if (squared == 0)
+		return {};
+	T inverse = 1 / std::sqrt(squared);
+	return Quaternion<T>(q.w * inverse, q.x * inverse, q.y * inverse, q.z * inverse);
+}
+
+// Rotates vc by the unit quaternion q without building a matrix,
+// as vc + w t + u x t where u is the vector part of q & t = 2 u x vc.
+template <class T, class V>
+constexpr V rotate(const Quaternion<T>& q, const V& vc)
+{
+	static_assert(V::SIZE == 3, "quaternions rotate three space");
+	T tx = 2 * (q.y * vc[2] - q.z * vc[1]);
+	T ty = 2 * (q.z * vc[0] - q.x * vc[2]);
+	T tz = 2 * (q.x * vc[1] - q.y * vc[0]);
+	V result = vc;
+	result[0] += q.w * tx + q.y * tz - q.z * ty;
+	result[1] += q.w * ty + q.z * tx - q.x * tz;
+	result[2] += q.w * tz + q.x * ty - q.y * tx;
+	return result;
+}
+
+// Spherical linear interpolation between unit quaternions along the shorter arc,
+// t = 0 gives a & t = 1 gives b or -b
+template <class T>
+Quaternion<T> slerp(const Quaternion<T>& a, Quaternion<T> b, T t)
+{
+	T cos_angle = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	if (cos_angle < 0) {
+		b = -b;
+		cos_angle = -cos_angle;
+	}
+
+	// Nearly equal rotations would divide by a tiny sine, interpolate linearly & renormalize instead
+	T wa = 1 - t, wb = t;
+	if (cos_angle < T(0.9995)) {
+		T angle = std::acos(cos_angle);
+		T inverse_sin = 1 / std::sin(angle);
+		wa = std::sin(wa * angle) * inverse_sin;
+		wb = std::sin(wb * angle) * inverse_sin;
+	}
+	Quaternion<T> q(wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z);
+	return normalize(q).value_or(a);
+}
+
+namespace detail {
+
+// Rotates count vectors held in 3 lanes by quaternions held in 4 lanes, in & out may be the same lanes
+template <class T>
+void rotate_lanes(const T* const* q, const T* const* in, T* const* out, std::size_t count)
+{
+	simd::for_each_pack<T>(count, [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto w = P::load(q[0] + i), x = P::load(q[1] + i), y = P::load(q[2] + i), z = P::load(q[3] + i);
+		auto vx = P::load(in[0] + i), vy = P::load(in[1] + i), vz = P::load(in[2] + i);
+		auto two = P::set1(2);
+		auto tx = P::mul(two, P::sub(P::mul(y, vz), P::mul(z, vy)));
+		auto ty = P::mul(two, P::sub(P::mul(z, vx), P::mul(x, vz)));
+		auto tz = P::mul(two, P::sub(P::mul(x, vy), P::mul(y, vx)));
+		P::store(out[0] + i, P::add(P::fmadd(w, tx, vx), P::sub(P::mul(y, tz), P::mul(z, ty))));
+		P::store(out[1] + i, P::add(P::fmadd(w, ty, vy), P::sub(P::mul(z, tx), P::mul(x, tz))));
+		P::store(out[2] + i, P::add(P::fmadd(w, tz, vz), P::sub(P::mul(x, ty), P::mul(y, tx))));
+	});
+}
+
+}
+
+// out[i] = rotate(q, in[i]). With a single rotation the quaternion is turned into a matrix once,
+// which is cheaper per vector, & the batch goes through transform_points.
+template <class T, class V>
+void rotate_batch(const Quaternion<T>& q, Span<const V> in, Span<V> out, ThreadPool& pool = default_pool())
+{
+	transform_points(Affine<T, 3>{q.matrix()}, in, out, pool);
+}
+
+template <class T, class V, class A>
+void rotate_batch(const Quaternion<T>& q, const VectorSoA<V, A>& in, VectorSoA<V, A>& out,
+	ThreadPool& pool = default_pool())
+{
+	transform_points(Affine<T, 3>{q.matrix()}, in, out, pool);
+}
+
+// out[i] = rotate(qs[i], in[i]), large batches are split across the pool. in & out may be the same array.
+// Gathering interleaved quaternions into lanes costs more than the rotation saves, so this stays a plain
+// loop the compiler can vectorize, store both as VectorSoA to rotate across SIMD lanes.
+template <class T, class V>
+void rotate_batch(Span<const Quaternion<T>> qs, Span<const V> in, Span<V> out, ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == 3 && std::is_same_v<typename V::scalar, T>, "vectors don't match the quaternions");
+	assert(qs.size() == in.size() && in.size() == out.size());
+	parallel_for_chunks(in.size(), detail::transform_grain, [&](std::size_t begin, std::size_t end) {
+		const Quaternion<T>* q = qs.data();
+		const V* src = in.data();
+		V* dst = out.data();
+		for (auto i = begin; i < end; i++)
+			dst[i] = rotate(q[i], src[i]);
+	}, pool);
+}
+
+template <class T, class V, class A>
+void rotate_batch(const VectorSoA<Quaternion<T>, A>& qs, const VectorSoA<V, A>& in, VectorSoA<V, A>& out,
+	ThreadPool& pool = default_pool())
+{
+	static_assert(V::SIZE == 3 && std::is_same_v<typename V::scalar, T>, "vectors don't match the quaternions");
+	assert(qs.size() == in.size() && in.size() == out.size());
+	parallel_for_chunks(in.size(), detail::transform_grain, [&](std::size_t begin, std::size_t end) {
+		const T* q_lanes[4] = {qs.lane(0) + begin, qs.lane(1) + begin, qs.lane(2) + begin, qs.lane(3) + begin};
+		const T* in_lanes[3] = {in.lane(0) + begin, in.lane(1) + begin, in.lane(2) + begin};
+		T* out_lanes[3] = {out.lane(0) + begin, out.lane(1) + begin, out.lane(2) + begin};
+		detail::rotate_lanes(q_lanes, in_lanes, out_lanes, end - begin);
+	}, pool);
+}
+
+// In place versions of the above
+template <class T, class V, class A>
+void rotate_batch(const Quaternion<T>& q, std::vector<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	rotate_batch(q, Span<const V>(vcs), Span<V>(vcs), pool);
+}
+
+template <class T, class V, class A>
+void rotate_batch(const Quaternion<T>& q, VectorSoA<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	rotate_batch(q, vcs, vcs, pool);
+}
+
+template <class T, class V, class A>
+void rotate_batch(Span<const Quaternion<T>> qs, std::vector<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	rotate_batch(qs, Span<const V>(vcs), Span<V>(vcs), pool);
+}
+
+template <class T, class V, class A>
+void rotate_batch(const VectorSoA<Quaternion<T>, A>& qs, VectorSoA<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	rotate_batch(qs, vcs, vcs, pool);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_QUATERNION_HPP_INCLUDED
@@ -0,0 +1,259 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_REDUCTION_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_REDUCTION_HPP_INCLUDED
+
+#include "simd.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "vector_functions.hpp"
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+// Everything the reductions compute, gathered in a single pass over the data.
+// For no vectors the bounds are left at the numeric limits & the magnitudes at zero.
+template <class V>
+struct VectorSummary {
+	using scalar = typename V::scalar;
+
+	std::size_t count = 0;
+	V sum;
+	V min;
+	V max;
+	scalar min_squared_magnitude = std::numeric_limits<scalar>::max();
+	scalar max_squared_magnitude = 0;
+
+	VectorSummary()
+	{
+		for (auto k = 0U; k < V::SIZE; k++) {
+			sum[k] = 0;
+			min[k] = std::numeric_limits<scalar>::max();
+			max[k] = std::numeric_limits<scalar>::lowest();
+		}
+	}
+
+	V centroid() const
+	{
+		V vc = sum;
+		if (count != 0)
+			for (auto k = 0U; k < V::SIZE; k++)
+				vc[k] /= static_cast<scalar>(count);
+		return vc;
+	}
+
+	auto min_magnitude() const
+	{
+		return count == 0 ? 0 : std::sqrt(min_squared_magnitude);
+	}
+
+	auto max_magnitude() const
+	{
+		return std::sqrt(max_squared_magnitude);
+	}
+
+	void merge(const VectorSummary& other)
+	{
+		count += other.count;
+		for (auto k = 0U; k < V::SIZE; k++) {
+			sum[k] += other.sum[k];
+			min[k] = std::min(min[k], other.min[k]);
+			max[k] = std::max(max[k], other.max[k]);
+		}
+		min_squared_magnitude = std::min(min_squared_magnitude, other.min_squared_magnitude);
+		max_squared_magnitude = std::max(max_squared_magnitude, other.max_squared_magnitude);
+	}
+};
+
+namespace detail {
+
+// The components of an array of vectors as one flat array of scalars
+template <class V>
+const typename V::scalar* flat_data(const V* vcs) noexcept
+{
+	using T = typename V::scalar;
+	static_assert(std::is_standard_layout_v<V> && sizeof(V) == V::SIZE * sizeof(T),
+		"vector components must be tightly packed");
+	return reinterpret_cast<const T*>(vcs);
+}
+
+// Roughly 32 KiB of vectors per block. Blocks are reduced on their own & then combined
+// in a fixed order, which keeps the float sums identical for any number of threads.
+template <class V>
+constexpr std::size_t reduction_block = std::max<std::size_t>(1, (32 << 10) / sizeof(V));
+
+// Packs are loaded from the flat components, so one lane always sees the same component
+// the loop steps over whole multiples of the vector & pack lengths at once.
+template <class T, std::size_t SIZE>
+using reduction_pack = std::conditional_t<
+	std::lcm(simd::pack<T>::width, SIZE) / simd::pack<T>::width <= 16,
+	simd::pack<T>, simd::scalar_pack<T>>;
+
+template <class V>
+VectorSummary<V> summarize_block(const V* vcs, std::size_t count)
+{
+	using T = typename V::scalar;
+	using P = reduction_pack<T, V::SIZE>;
+	constexpr std::size_t WIDTH = P::width;
+	constexpr std::size_t PACKS = std::lcm(WIDTH, V::SIZE) / WIDTH;
+	constexpr std::size_t STEP = std::lcm(WIDTH, V::SIZE) / V::SIZE;
+
+	typename P::type sum[PACKS], lo[PACKS], hi[PACKS];
+	for (auto q = 0U; q < PACKS; q++) {
+		sum[q] = P::zero();
+		lo[q] = P::set1(std::numeric_limits<T>::max());
+		hi[q] = P::set1(std::numeric_limits<T>::lowest());
+	}
+
+	const T* flat = flat_data(vcs);
+	std::size_t i = 0;
+	for (; i + STEP <= count; i += STEP) {
+		simd::unroll<PACKS>([&](auto q) {
+			auto v = P::load(flat + i * V::SIZE + q * WIDTH);
+			sum[q] = P::add(sum[q], v);
+			lo[q] = P::min(lo[q], v);
+			hi[q] = P::max(hi[q], v);
+		});
+	}
+
+	VectorSummary<V> summary;
+	summary.count = count;
+	T lanes[WIDTH];
+	for (auto q = 0U; q < PACKS; q++) {
+		P::store(lanes, sum[q]);
+		for (auto l = 0U; l < WIDTH; l++)
+			summary.sum[(q * WIDTH + l) % V::SIZE] += lanes[l];
+		P::store(lanes, lo[q]);
+		for (auto l = 0U; l < WIDTH; l++) {
+			auto& c = summary.min[(q * WIDTH + l) % V::SIZE];
+			c = std::min(c, lanes[l]);
+		}
+		P::store(lanes, hi[q]);
+		for (auto l = 0U; l < WIDTH; l++) {
+			auto& c = summary.max[(q * WIDTH + l) % V::SIZE];
+			c = std::max(c, lanes[l]);
+		}
+	}
+	for (; i < count; i++) {
+		for (auto k = 0U; k < V::SIZE; k++) {
+			summary.sum[k] += vcs[i][k];
+			summary.min[k] = std::min(summary.min[k], vcs[i][k]);
+			summary.max[k] = std::max(summary.max[k], vcs[i][k]);
+		}
+	}
+
+	// The block is still in cache, so this doesn't cost a second trip to memory.
+	// Squared magnitudes are written out first so their minimum & maximum can use packs too.
+	T squared[reduction_block<V>];
+	for (i = 0; i < count; i++) {
+		const T* c = flat + i * V::SIZE;
+		T accumulated_val = 0;
+		if constexpr (V::SIZE <= 16)
+			simd::unroll<V::SIZE>([&](auto k) { accumulated_val += c[k] * c[k]; });
+		else
+			for (auto k = 0U; k < V::SIZE; k++)
+				accumulated_val += c[k] * c[k];
+		squared[i] = accumulated_val;
+	}
+
+	using Q = simd::pack<T>;
+	auto sq_lo = Q::set1(std::numeric_limits<T>::max());
+	auto sq_hi = Q::zero();
+	for (i = 0; i + Q::width <= count; i += Q::width) {
+		auto v = Q::load(squared + i);
+		sq_lo = Q::min(sq_lo, v);
+		sq_hi = Q::max(sq_hi, v);
+	}
+	summary.min_squared_magnitude = Q::hmin(sq_lo);
+	summary.max_squared_magnitude = Q::hmax(sq_hi);
+	for (; i < count; i++) {
+		summary.min_squared_magnitude = std::min(summary.min_squared_magnitude, squared[i]);
+		summary.max_squared_magnitude = std::max(summary.max_squared_magnitude, squared[i]);
+	}
+	return summary;
+}
+
+}
+
+// Sum, bounds & extreme magnitudes of vcs in one pass. Blocks are reduced with SIMD across the pool
+// & combined pairwise in a fixed tree, so results don't depend on the number of threads.
+template <class V>
+VectorSummary<V> summarize(Span<const V> vcs, ThreadPool& pool = default_pool())
+{
+	constexpr std::size_t block = detail::reduction_block<V>;
+	std::vector<VectorSummary<V>> partials((vcs.size() + block - 1) / block);
+	if (partials.empty())
+		return {};
+
+	pool.parallel_for(partials.size(), [&](std::size_t b) {
+		std::size_t begin = b * block;
+		partials[b] = detail::summarize_block(vcs.data() + begin, std::min(block, vcs.size() - begin));
+	});
+
+	for (std::size_t stride = 1; stride < partials.size(); stride *= 2)
+		for (std::size_t b = 0; b + stride < partials.size(); b += 2 * stride)
+			partials[b].merge(partials[b + stride]);
+	return partials[0];
+}
+
+template <class V, class A>
+VectorSummary<V> summarize(const std::vector<V, A>& vcs, ThreadPool& pool = default_pool())
+{
+	return summarize(Span<const V>(vcs), pool);
+}
+
+template <class V>
+V vector_sum(Span<const V> vcs, ThreadPool& pool = default_pool())
+{
+	return summarize(vcs, pool).sum;
+}
+
+template <class V>
+V centroid(Span<const V> vcs, ThreadPool& pool = default_pool())
+{
+	return summarize(vcs, pool).centroid();
+}
+
+// Axis aligned bounding box, as the minimum & maximum corners
+template <class V>
+std::pair<V, V> bounds(Span<const V> vcs, ThreadPool& pool = default_pool())
+{
+	auto summary = summarize(vcs, pool);
+	return {summary.min, summary.max};
+}
+
+template <class V>
+auto max_magnitude(Span<const V> vcs, ThreadPool& pool = default_pool())
+{
+	return summarize(vcs, pool).max_magnitude();
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_REDUCTION_HPP_INCLUDED
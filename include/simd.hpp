@@ -0,0 +1,271 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_HPP_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "unroll.hpp"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace MathVector {
+namespace simd {
+
+// One lane wide pack, used for every scalar type & for loop tails.
+template <class T>
+struct scalar_pack {
+	using type = T;
+	static constexpr std::size_t width = 1;
+
+	static type load(const T* p) { return *p; }
+	// Loads a narrower type, converting each lane
+	template <class U>
+	static type load(const U* p) { return static_cast<T>(*p); }
+	static void store(T* p, type v) { *p = v; }
+	static type set1(T s) { return s; }
+	static type zero() { return T(0); }
+	static type add(type a, type b) { return a + b; }
+	static type sub(type a, type b) { return a - b; }
+	static type mul(type a, type b) { return a * b; }
+	static type div(type a, type b) { return a / b; }
+	static type fmadd(type a, type b, type c) { return a * b + c; }
+	static type min(type a, type b) { return std::min(a, b); }
+	static type max(type a, type b) { return std::max(a, b); }
+	static type sqrt(type a) { return static_cast<T>(std::sqrt(a)); }
+	// Estimate of 1 / sqrt(a), exact for types without a fast approximation
+	static type rsqrt(type a) { return static_cast<T>(1 / std::sqrt(a)); }
+	using mask_type = bool;
+	static mask_type greater(type a, type b) { return a > b; }
+	// Lanes of a where m is set, otherwise b
+	static type select(mask_type m, type a, type b) { return m ? a : b; }
+	static T hsum(type a) { return a; }
+	static T hmin(type a) { return a; }
+	static T hmax(type a) { return a; }
+};
+
+// Widest pack the target was compiled for, types without one fall back to scalar.
+template <class T>
+struct pack : scalar_pack<T> {};
+
+#if defined(__AVX__)
+
+template <>
+struct pack<float> {
+	using type = __m256;
+	static constexpr std::size_t width = 8;
+
+	static type load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+	static type set1(float s) { return _mm256_set1_ps(s); }
+	static type zero() { return _mm256_setzero_ps(); }
+	static type add(type a, type b) { return _mm256_add_ps(a, b); }
+	static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+	static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+	static type div(type a, type b) { return _mm256_div_ps(a, b); }
+#if defined(__FMA__)
+	static type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+	static type fmadd(type a, type b, type c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+	static type min(type a, type b) { return _mm256_min_ps(a, b); }
+	static type max(type a, type b) { return _mm256_max_ps(a, b); }
+	static type sqrt(type a) { return _mm256_sqrt_ps(a); }
+	static type rsqrt(type a) { return _mm256_rsqrt_ps(a); }
+	using mask_type = __m256;
+	static mask_type greater(type a, type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static type select(mask_type m, type a, type b) { return _mm256_blendv_ps(b, a, m); }
+
+	static float hsum(type a)
+	{
+		__m128 v = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+
+	static float hmin(type a)
+	{
+		__m128 v = _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+		v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+
+	static float hmax(type a)
+	{
+		__m128 v = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+		v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+};
+
+template <>
+struct pack<double> {
+	using type = __m256d;
+	static constexpr std::size_t width = 4;
+
+	static type load(const double* p) { return _mm256_loadu_pd(p); }
+	static type load(const float* p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+	static void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+	static type set1(double s) { return _mm256_set1_pd(s); }
+	static type zero() { return _mm256_setzero_pd(); }
+	static type add(type a, type b) { return _mm256_add_pd(a, b); }
+	static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+	static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+	static type div(type a, type b) { return _mm256_div_pd(a, b); }
+#if defined(__FMA__)
+	static type fmadd(type a, type b, type c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+	static type fmadd(type a, type b, type c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+	static type min(type a, type b) { return _mm256_min_pd(a, b); }
+	static type max(type a, type b) { return _mm256_max_pd(a, b); }
+	static type sqrt(type a) { return _mm256_sqrt_pd(a); }
+	static type rsqrt(type a) { return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(a)); }
+	using mask_type = __m256d;
+	static mask_type greater(type a, type b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static type select(mask_type m, type a, type b) { return _mm256_blendv_pd(b, a, m); }
+
+	static double hsum(type a)
+	{
+		__m128d v = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+		return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+
+	static double hmin(type a)
+	{
+		__m128d v = _mm_min_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+		return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+
+	static double hmax(type a)
+	{
+		__m128d v = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+		return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+};
+
+#elif defined(__SSE2__)
+
+template <>
+struct pack<float> {
+	using type = __m128;
+	static constexpr std::size_t width = 4;
+
+	static type load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, type v) { _mm_storeu_ps(p, v); }
+	static type set1(float s) { return _mm_set1_ps(s); }
+	static type zero() { return _mm_setzero_ps(); }
+	static type add(type a, type b) { return _mm_add_ps(a, b); }
+	static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+	static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+	static type div(type a, type b) { return _mm_div_ps(a, b); }
+	static type fmadd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static type min(type a, type b) { return _mm_min_ps(a, b); }
+	static type max(type a, type b) { return _mm_max_ps(a, b); }
+	static type sqrt(type a) { return _mm_sqrt_ps(a); }
+	static type rsqrt(type a) { return _mm_rsqrt_ps(a); }
+	using mask_type = __m128;
+	static mask_type greater(type a, type b) { return _mm_cmpgt_ps(a, b); }
+	static type select(mask_type m, type a, type b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+	static float hsum(type v)
+	{
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+
+	static float hmin(type v)
+	{
+		v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+
+	static float hmax(type v)
+	{
+		v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+};
+
+template <>
+struct pack<double> {
+	using type = __m128d;
+	static constexpr std::size_t width = 2;
+
+	static type load(const double* p) { return _mm_loadu_pd(p); }
+	static type load(const float* p) { return _mm_cvtps_pd(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p))); }
+	static void store(double* p, type v) { _mm_storeu_pd(p, v); }
+	static type set1(double s) { return _mm_set1_pd(s); }
+	static type zero() { return _mm_setzero_pd(); }
+	static type add(type a, type b) { return _mm_add_pd(a, b); }
+	static type sub(type a, type b) { return _mm_sub_pd(a, b); }
+	static type mul(type a, type b) { return _mm_mul_pd(a, b); }
+	static type div(type a, type b) { return _mm_div_pd(a, b); }
+	static type fmadd(type a, type b, type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	static type min(type a, type b) { return _mm_min_pd(a, b); }
+	static type max(type a, type b) { return _mm_max_pd(a, b); }
+	static type sqrt(type a) { return _mm_sqrt_pd(a); }
+	static type rsqrt(type a) { return _mm_div_pd(_mm_set1_pd(1.0), _mm_sqrt_pd(a)); }
+	using mask_type = __m128d;
+	static mask_type greater(type a, type b) { return _mm_cmpgt_pd(a, b); }
+	static type select(mask_type m, type a, type b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+
+	static double hsum(type v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+	static double hmin(type v) { return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v))); }
+	static double hmax(type v) { return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v))); }
+};
+
+#endif
+
+// The compile time unrolling of unroll.hpp, available here for the pack kernels
+using MathVector::unroll;
+
+// Calls f(P{}, i) with the full pack for every whole block of lanes,
+// then with scalar_pack for what remains.
+template <class T, class F>
+inline void for_each_pack(std::size_t n, F&& f)
+{
+	std::size_t i = 0;
+	for (; i + pack<T>::width <= n; i += pack<T>::width)
+		f(pack<T>{}, i);
+	for (; i < n; i++)
+		f(scalar_pack<T>{}, i);
+}
+
+}
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_HPP_INCLUDED
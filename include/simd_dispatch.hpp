@@ -0,0 +1,434 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_DISPATCH_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_DISPATCH_HPP_INCLUDED
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Runtime selected SSE2, AVX2 & AVX-512 kernels for float & double arrays.
+// Only gcc & clang on x86 are supported, define MATHVECTOR_NO_SIMD to always use the scalar code.
+#if !defined(MATHVECTOR_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) \
+	&& (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MATHVECTOR_SIMD_DISPATCH 1
+#include <immintrin.h>
+#define MATHVECTOR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MATHVECTOR_SIMD_DISPATCH 0
+#endif
+
+// Kernels can't run during constant evaluation, without a way to tell the scalar code is always used.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define MATHVECTOR_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#ifndef MATHVECTOR_CONSTANT_EVALUATED
+#define MATHVECTOR_CONSTANT_EVALUATED() true
+#endif
+
+namespace MathVector {
+namespace simd {
+
+enum class Isa { scalar, sse2, avx2, avx512 };
+
+template <class T>
+struct KernelTable {
+	void (*add)(T* dst, const T* src, std::size_t n);
+	void (*sub)(T* dst, const T* src, std::size_t n);
+	void (*scale)(T* dst, T factor, std::size_t n);
+	T (*dot)(const T* lhs, const T* rhs, std::size_t n);
+};
+
+// Below this length the call through the table costs more than it saves.
+constexpr std::size_t dispatch_min_size = 32;
+
+template <class T, std::size_t N>
+constexpr bool dispatches = MATHVECTOR_SIMD_DISPATCH
+	&& (std::is_same_v<T, float> || std::is_same_v<T, double>)
+	&& N >= dispatch_min_size;
+
+// Vectors with contiguous storage, i.e. a data() member, which dispatch on their scalar & SIZE
+template <class V, class = void>
+constexpr bool dispatches_vector = false;
+
+template <class V>
+constexpr bool dispatches_vector<V, std::void_t<decltype(std::declval<const V&>().data())>>
+	= dispatches<typename V::scalar, V::SIZE>;
+
+namespace detail {
+
+// The scalar kernels, also the reference the vector ones are tested against.
+template <class T>
+void scalar_add(T* dst, const T* src, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] += src[i];
+}
+
+template <class T>
+void scalar_sub(T* dst, const T* src, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] -= src[i];
+}
+
+template <class T>
+void scalar_scale(T* dst, T factor, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; i++)
+		dst[i] *= factor;
+}
+
+template <class T>
+T scalar_dot(const T* lhs, const T* rhs, std::size_t n)
+{
+	T accumulated_val = 0;
+	for (std::size_t i = 0; i < n; i++)
+		accumulated_val += lhs[i] * rhs[i];
+	return accumulated_val;
+}
+
+#if MATHVECTOR_SIMD_DISPATCH
+
+// Vector types only ever cross calls between functions of the same target
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#define MATHVECTOR_PACK_MEMBER(isa) __attribute__((target(isa))) static inline
+
+template <class T>
+struct sse2_pack;
+
+template <>
+struct sse2_pack<float> {
+	using type = __m128;
+	static constexpr std::size_t width = 4;
+	static constexpr bool masked = false;
+	MATHVECTOR_PACK_MEMBER("sse2") type load(const float* p) { return _mm_loadu_ps(p); }
+	MATHVECTOR_PACK_MEMBER("sse2") void store(float* p, type v) { _mm_storeu_ps(p, v); }
+	MATHVECTOR_PACK_MEMBER("sse2") type set1(float s) { return _mm_set1_ps(s); }
+	MATHVECTOR_PACK_MEMBER("sse2") type zero() { return _mm_setzero_ps(); }
+	MATHVECTOR_PACK_MEMBER("sse2") type add(type a, type b) { return _mm_add_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type sub(type a, type b) { return _mm_sub_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type mul(type a, type b) { return _mm_mul_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type fmadd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	MATHVECTOR_PACK_MEMBER("sse2") float hsum(type v)
+	{
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+};
+
+template <>
+struct sse2_pack<double> {
+	using type = __m128d;
+	static constexpr std::size_t width = 2;
+	static constexpr bool masked = false;
+	MATHVECTOR_PACK_MEMBER("sse2") type load(const double* p) { return _mm_loadu_pd(p); }
+	MATHVECTOR_PACK_MEMBER("sse2") void store(double* p, type v) { _mm_storeu_pd(p, v); }
+	MATHVECTOR_PACK_MEMBER("sse2") type set1(double s) { return _mm_set1_pd(s); }
+	MATHVECTOR_PACK_MEMBER("sse2") type zero() { return _mm_setzero_pd(); }
+	MATHVECTOR_PACK_MEMBER("sse2") type add(type a, type b) { return _mm_add_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type sub(type a, type b) { return _mm_sub_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type mul(type a, type b) { return _mm_mul_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("sse2") type fmadd(type a, type b, type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	MATHVECTOR_PACK_MEMBER("sse2") double hsum(type v)
+	{
+		return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+};
+
+template <class T>
+struct avx2_pack;
+
+template <>
+struct avx2_pack<float> {
+	using type = __m256;
+	static constexpr std::size_t width = 8;
+	static constexpr bool masked = false;
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type load(const float* p) { return _mm256_loadu_ps(p); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type set1(float s) { return _mm256_set1_ps(s); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type zero() { return _mm256_setzero_ps(); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type add(type a, type b) { return _mm256_add_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") float hsum(type a)
+	{
+		__m128 v = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+};
+
+template <>
+struct avx2_pack<double> {
+	using type = __m256d;
+	static constexpr std::size_t width = 4;
+	static constexpr bool masked = false;
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type load(const double* p) { return _mm256_loadu_pd(p); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type set1(double s) { return _mm256_set1_pd(s); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type zero() { return _mm256_setzero_pd(); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type add(type a, type b) { return _mm256_add_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") type fmadd(type a, type b, type c) { return _mm256_fmadd_pd(a, b, c); }
+	MATHVECTOR_PACK_MEMBER("avx2,fma") double hsum(type a)
+	{
+		__m128d v = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+		return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+};
+
+// AVX-512 finishes the tail with masked loads & stores instead of a scalar loop
+template <class T>
+struct avx512_pack;
+
+template <>
+struct avx512_pack<float> {
+	using type = __m512;
+	using mask_type = __mmask16;
+	static constexpr std::size_t width = 16;
+	static constexpr bool masked = true;
+	MATHVECTOR_PACK_MEMBER("avx512f") type load(const float* p) { return _mm512_loadu_ps(p); }
+	MATHVECTOR_PACK_MEMBER("avx512f") void store(float* p, type v) { _mm512_storeu_ps(p, v); }
+	MATHVECTOR_PACK_MEMBER("avx512f") mask_type mask(std::size_t n) { return static_cast<mask_type>((1U << n) - 1); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type load(const float* p, mask_type m) { return _mm512_maskz_loadu_ps(m, p); }
+	MATHVECTOR_PACK_MEMBER("avx512f") void store(float* p, type v, mask_type m) { _mm512_mask_storeu_ps(p, m, v); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type set1(float s) { return _mm512_set1_ps(s); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type zero() { return _mm512_setzero_ps(); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type add(type a, type b) { return _mm512_add_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type fmadd(type a, type b, type c) { return _mm512_fmadd_ps(a, b, c); }
+	MATHVECTOR_PACK_MEMBER("avx512f") float hsum(type v)
+	{
+		alignas(64) float lanes[width];
+		_mm512_store_ps(lanes, v);
+		float sum = 0;
+		for (auto lane : lanes)
+			sum += lane;
+		return sum;
+	}
+};
+
+template <>
+struct avx512_pack<double> {
+	using type = __m512d;
+	using mask_type = __mmask8;
+	static constexpr std::size_t width = 8;
+	static constexpr bool masked = true;
+	MATHVECTOR_PACK_MEMBER("avx512f") type load(const double* p) { return _mm512_loadu_pd(p); }
+	MATHVECTOR_PACK_MEMBER("avx512f") void store(double* p, type v) { _mm512_storeu_pd(p, v); }
+	MATHVECTOR_PACK_MEMBER("avx512f") mask_type mask(std::size_t n) { return static_cast<mask_type>((1U << n) - 1); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type load(const double* p, mask_type m) { return _mm512_maskz_loadu_pd(m, p); }
+	MATHVECTOR_PACK_MEMBER("avx512f") void store(double* p, type v, mask_type m) { _mm512_mask_storeu_pd(p, m, v); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type set1(double s) { return _mm512_set1_pd(s); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type zero() { return _mm512_setzero_pd(); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type add(type a, type b) { return _mm512_add_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+	MATHVECTOR_PACK_MEMBER("avx512f") type fmadd(type a, type b, type c) { return _mm512_fmadd_pd(a, b, c); }
+	MATHVECTOR_PACK_MEMBER("avx512f") double hsum(type v)
+	{
+		alignas(64) double lanes[width];
+		_mm512_store_pd(lanes, v);
+		double sum = 0;
+		for (auto lane : lanes)
+			sum += lane;
+		return sum;
+	}
+};
+
+#undef MATHVECTOR_PACK_MEMBER
+
+// Kernels written once against a pack. They are always inlined into an entry point
+// compiled for the pack's ISA, so vectors never cross a call without that target.
+template <class P, class T>
+__attribute__((always_inline)) inline void packed_add(T* dst, const T* src, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + P::width <= n; i += P::width)
+		P::store(dst + i, P::add(P::load(dst + i), P::load(src + i)));
+	if constexpr (P::masked) {
+		if (i < n) {
+			auto m = P::mask(n - i);
+			P::store(dst + i, P::add(P::load(dst + i, m), P::load(src + i, m)), m);
+		}
+	} else {
+		for (; i < n; i++)
+			dst[i] += src[i];
+	}
+}
+
+template <class P, class T>
+__attribute__((always_inline)) inline void packed_sub(T* dst, const T* src, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + P::width <= n; i += P::width)
+		P::store(dst + i, P::sub(P::load(dst + i), P::load(src + i)));
+	if constexpr (P::masked) {
+		if (i < n) {
+			auto m = P::mask(n - i);
+			P::store(dst + i, P::sub(P::load(dst + i, m), P::load(src + i, m)), m);
+		}
+	} else {
+		for (; i < n; i++)
+			dst[i] -= src[i];
+	}
+}
+
+template <class P, class T>
+__attribute__((always_inline)) inline void packed_scale(T* dst, T factor, std::size_t n)
+{
+	auto f = P::set1(factor);
+	std::size_t i = 0;
+	for (; i + P::width <= n; i += P::width)
+		P::store(dst + i, P::mul(P::load(dst + i), f));
+	if constexpr (P::masked) {
+		if (i < n) {
+			auto m = P::mask(n - i);
+			P::store(dst + i, P::mul(P::load(dst + i, m), f), m);
+		}
+	} else {
+		for (; i < n; i++)
+			dst[i] *= factor;
+	}
+}
+
+// Two accumulators to hide the add latency
+template <class P, class T>
+__attribute__((always_inline)) inline T packed_dot(const T* lhs, const T* rhs, std::size_t n)
+{
+	auto acc0 = P::zero();
+	auto acc1 = P::zero();
+	std::size_t i = 0;
+	for (; i + 2 * P::width <= n; i += 2 * P::width) {
+		acc0 = P::fmadd(P::load(lhs + i), P::load(rhs + i), acc0);
+		acc1 = P::fmadd(P::load(lhs + i + P::width), P::load(rhs + i + P::width), acc1);
+	}
+	for (; i + P::width <= n; i += P::width)
+		acc0 = P::fmadd(P::load(lhs + i), P::load(rhs + i), acc0);
+	if constexpr (P::masked) {
+		if (i < n) {
+			auto m = P::mask(n - i);
+			acc1 = P::fmadd(P::load(lhs + i, m), P::load(rhs + i, m), acc1);
+		}
+		return P::hsum(P::add(acc0, acc1));
+	} else {
+		T accumulated_val = P::hsum(P::add(acc0, acc1));
+		for (; i < n; i++)
+			accumulated_val += lhs[i] * rhs[i];
+		return accumulated_val;
+	}
+}
+
+template <class T> MATHVECTOR_TARGET("sse2") void sse2_add(T* d, const T* s, std::size_t n) { packed_add<sse2_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("sse2") void sse2_sub(T* d, const T* s, std::size_t n) { packed_sub<sse2_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("sse2") void sse2_scale(T* d, T f, std::size_t n) { packed_scale<sse2_pack<T>>(d, f, n); }
+template <class T> MATHVECTOR_TARGET("sse2") T sse2_dot(const T* l, const T* r, std::size_t n) { return packed_dot<sse2_pack<T>>(l, r, n); }
+
+template <class T> MATHVECTOR_TARGET("avx2,fma") void avx2_add(T* d, const T* s, std::size_t n) { packed_add<avx2_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("avx2,fma") void avx2_sub(T* d, const T* s, std::size_t n) { packed_sub<avx2_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("avx2,fma") void avx2_scale(T* d, T f, std::size_t n) { packed_scale<avx2_pack<T>>(d, f, n); }
+template <class T> MATHVECTOR_TARGET("avx2,fma") T avx2_dot(const T* l, const T* r, std::size_t n) { return packed_dot<avx2_pack<T>>(l, r, n); }
+
+template <class T> MATHVECTOR_TARGET("avx512f") void avx512_add(T* d, const T* s, std::size_t n) { packed_add<avx512_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("avx512f") void avx512_sub(T* d, const T* s, std::size_t n) { packed_sub<avx512_pack<T>>(d, s, n); }
+template <class T> MATHVECTOR_TARGET("avx512f") void avx512_scale(T* d, T f, std::size_t n) { packed_scale<avx512_pack<T>>(d, f, n); }
+template <class T> MATHVECTOR_TARGET("avx512f") T avx512_dot(const T* l, const T* r, std::size_t n) { return packed_dot<avx512_pack<T>>(l, r, n); }
+
+#pragma GCC diagnostic pop
+
+#endif
+
+}
+
+// Whether the running cpu can execute the kernels for isa
+inline bool supported(Isa isa)
+{
+#if MATHVECTOR_SIMD_DISPATCH
+	__builtin_cpu_init();
+	switch (isa) {
+	case Isa::scalar:
+	case Isa::sse2:
+		return true;
+	case Isa::avx2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case Isa::avx512:
+		return __builtin_cpu_supports("avx512f");
+	}
+	return false;
+#else
+	return isa == Isa::scalar;
+#endif
+}
+
+inline Isa best_isa()
+{
+	static const Isa isa = supported(Isa::avx512) ? Isa::avx512
+		: supported(Isa::avx2) ? Isa::avx2
+		: supported(Isa::sse2) ? Isa::sse2
+		: Isa::scalar;
+	return isa;
+}
+
+// Kernels for a specific isa, which must be supported
+template <class T>
+KernelTable<T> kernel_table(Isa isa)
+{
+#if MATHVECTOR_SIMD_DISPATCH
+	switch (isa) {
+	case Isa::avx512:
+		return {detail::avx512_add<T>, detail::avx512_sub<T>, detail::avx512_scale<T>, detail::avx512_dot<T>};
+	case Isa::avx2:
+		return {detail::avx2_add<T>, detail::avx2_sub<T>, detail::avx2_scale<T>, detail::avx2_dot<T>};
+	case Isa::sse2:
+		return {detail::sse2_add<T>, detail::sse2_sub<T>, detail::sse2_scale<T>, detail::sse2_dot<T>};
+	case Isa::scalar:
+		break;
+	}
+#endif
+	(void)isa;
+	return {detail::scalar_add<T>, detail::scalar_sub<T>, detail::scalar_scale<T>, detail::scalar_dot<T>};
+}
+
+// Kernels for the best isa of the running cpu, chosen on first use
+template <class T>
+const KernelTable<T>& kernels()
+{
+	static const KernelTable<T> table = kernel_table<T>(best_isa());
+	return table;
+}
+
+}
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_SIMD_DISPATCH_HPP_INCLUDED
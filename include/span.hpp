@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_SPAN_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_SPAN_HPP_INCLUDED
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace MathVector {
+
+// Non owning view of contiguous elements, a stand in for c++20's std::span.
+template <class T>
+class Span {
+public:
+	using element_type = T;
+	using value_type = std::remove_cv_t<T>;
+	using iterator = T*;
+
+	constexpr Span() noexcept : ptr(nullptr), count(0) {}
+	constexpr Span(T* data, std::size_t size) noexcept : ptr(data), count(size) {}
+
+	template <class U, class A, typename std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>, int> = 0>
+	constexpr Span(std::vector<U, A>& vc) noexcept : ptr(vc.data()), count(vc.size()) {}
+
+	template <class U, class A, typename std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>, int> = 0>
+	constexpr Span(const std::vector<U, A>& vc) noexcept : ptr(vc.data()), count(vc.size()) {}
+
+	template <class U, std::size_t N, typename std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>, int> = 0>
+	constexpr Span(std::array<U, N>& arr) noexcept : ptr(arr.data()), count(N) {}
+
+	template <class U, typename std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>, int> = 0>
+	constexpr Span(const Span<U>& other) noexcept : ptr(other.data()), count(other.size()) {}
+
+	constexpr T* data() const noexcept { return ptr; }
+	constexpr std::size_t size() const noexcept { return count; }
+	constexpr bool empty() const noexcept { return count == 0; }
+	constexpr T* begin() const noexcept { return ptr; }
+	constexpr T* end() const noexcept { return ptr + count; }
+
+	constexpr T& operator[](std::size_t i) const
+	{
+		assert(i < count);
+		return ptr[i];
+	}
+
+	constexpr Span subspan(std::size_t offset, std::size_t length) const
+	{
+		assert(offset + length <= count);
+		return Span(ptr + offset, length);
+	}
+
+private:
+	T* ptr;
+	std::size_t count;
+};
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_SPAN_HPP_INCLUDED
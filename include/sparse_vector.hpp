@@ -0,0 +1,437 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_SPARSE_VECTOR_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_SPARSE_VECTOR_HPP_INCLUDED
+
+#include "dynamic_vector.hpp"
+#include "span.hpp"
+#include "vector_array.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace MathVector {
+
+// Vector of dimension components where most are zero, only the others are stored,
+// as strictly increasing indices & their values, so the work is proportional to them.
+// Zeros are never stored, operations that cancel a component remove it.
+template <class T, class I = std::uint32_t>
+class SparseVector {
+public:
+	static_assert(std::is_unsigned_v<I>, "SparseVector indices must be unsigned");
+
+	using scalar = T;
+	using index_type = I;
+
+	SparseVector() = default;
+
+	// The largest index value is kept free as a sentinel
+	explicit SparseVector(std::size_t dimension)
+		: length(dimension)
+	{
+		if (dimension > std::numeric_limits<I>::max())
+			throw std::length_error("dimension too large for the SparseVector index type");
+	}
+
+	// The pairs may come in any order, values of repeated indices are added together
+	SparseVector(std::size_t dimension, Span<const I> indices, Span<const T> values)
+		: SparseVector(dimension)
+	{
+		if (indices.size() != values.size())
+			throw std::length_error("SparseVector needs a value for every index");
+
+		std::vector<std::size_t> order(indices.size());
+		std::iota(order.begin(), order.end(), std::size_t(0));
+		if (!std::is_sorted(indices.begin(), indices.end()))
+			std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) { return indices[a] < indices[b]; });
+
+		for (auto k : order) {
+			if (indices[k] >= dimension)
+				throw std::out_of_range("SparseVector index past the dimension");
+			if (!index_list.empty() && index_list.back() == indices[k])
+				value_list.back() += values[k];
+			else
+				push_back(indices[k], values[k]);
+		}
+		drop_zeros();
+	}
+
+	template <std::size_t N>
+	explicit SparseVector(const Vector<T, N>& dense)
+		: SparseVector(N)
+	{
+		gather(dense.data());
+	}
+
+	template <class D, typename std::enable_if_t<is_dynamic_vector<D> && std::is_same_v<typename D::scalar, T>, int> = 0>
+	explicit SparseVector(const D& dense)
+		: SparseVector(dense.size())
+	{
+		gather(dense.data());
+	}
+
+	// The number of components, zero or not
+	std::size_t size() const noexcept { return length; }
+	std::size_t nonzeros() const noexcept { return index_list.size(); }
+	Span<const I> indices() const noexcept { return Span<const I>(index_list); }
+	Span<const T> values() const noexcept { return Span<const T>(value_list); }
+
+	void reserve(std::size_t count)
+	{
+		index_list.reserve(count);
+		value_list.reserve(count);
+	}
+
+	// Appends a component past the last stored one, for building from sorted data, zeros are skipped
+	void push_back(I index, const T& value)
+	{
+		assert(index < length && (index_list.empty() || index_list.back() < index));
+		if (value == 0)
+			return;
+		index_list.push_back(index);
+		value_list.push_back(value);
+	}
+
+	// Component i, found with a binary search
+	T operator[](std::size_t i) const
+	{
+		assert(i < length);
+		auto it = std::lower_bound(index_list.begin(), index_list.end(), i);
+		return it != index_list.end() && *it == i ? value_list[it - index_list.begin()] : T(0);
+	}
+
+	// Writes every component, zeros included, to out which must have dimension elements
+	void scatter(Span<T> out) const
+	{
+		detail::check_dimensions(length, out.size());
+		std::fill(out.begin(), out.end(), T(0));
+		for (std::size_t k = 0; k < index_list.size(); k++)
+			out[index_list[k]] = value_list[k];
+	}
+
+	template <std::size_t N>
+	Vector<T, N> to_vector() const
+	{
+		Vector<T, N> dense;
+		scatter(Span<T>(dense.data(), N));
+		return dense;
+	}
+
+	DynamicVector<T> to_dynamic() const
+	{
+		DynamicVector<T> dense(length);
+		scatter(Span<T>(dense.data(), length));
+		return dense;
+	}
+
+	SparseVector& operator+=(const SparseVector& rhs)
+	{
+		return *this = merge(*this, rhs, [](const T& a, const T& b) { return a + b; });
+	}
+
+	SparseVector& operator-=(const SparseVector& rhs)
+	{
+		return *this = merge(*this, rhs, [](const T& a, const T& b) { return a - b; });
+	}
+
+	SparseVector& operator*=(const T& rhs)
+	{
+		for (auto& x : value_list)
+			x *= rhs;
+		drop_zeros();
+		return *this;
+	}
+
+	const SparseVector& operator+() const
+	{
+		return *this;
+	}
+
+	SparseVector operator-() const
+	{
+		SparseVector result(*this);
+		for (auto& x : result.value_list)
+			x = -x;
+		return result;
+	}
+
+	friend bool operator==(const SparseVector& lhs, const SparseVector& rhs)
+	{
+		return lhs.length == rhs.length && lhs.index_list == rhs.index_list && lhs.value_list == rhs.value_list;
+	}
+
+	friend bool operator!=(const SparseVector& lhs, const SparseVector& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+private:
+	void gather(const T* dense)
+	{
+		for (std::size_t i = 0; i < length; i++)
+			if (dense[i] != 0)
+				push_back(static_cast<I>(i), dense[i]);
+	}
+
+	void drop_zeros()
+	{
+		std::size_t kept = 0;
+		for (std::size_t k = 0; k < value_list.size(); k++) {
+			index_list[kept] = index_list[k];
+			value_list[kept] = value_list[k];
+			kept += value_list[k] != 0;
+		}
+		index_list.resize(kept);
+		value_list.resize(kept);
+	}
+
+	// The union of the stored components, op(a, 0) or op(0, b) where only one side has one
+	template <class F>
+	static SparseVector merge(const SparseVector& lhs, const SparseVector& rhs, F op)
+	{
+		detail::check_dimensions(lhs.length, rhs.length);
+		SparseVector result(lhs.length);
+		result.reserve(lhs.nonzeros() + rhs.nonzeros());
+		std::size_t i = 0, j = 0;
+		while (i < lhs.nonzeros() || j < rhs.nonzeros()) {
+			I a = i < lhs.nonzeros() ? lhs.index_list[i] : std::numeric_limits<I>::max();
+			I b = j < rhs.nonzeros() ? rhs.index_list[j] : std::numeric_limits<I>::max();
+			result.push_back(std::min(a, b), op(a <= b ? lhs.value_list[i] : T(0), b <= a ? rhs.value_list[j] : T(0)));
+			i += a <= b;
+			j += b <= a;
+		}
+		return result;
+	}
+
+	std::size_t length = 0;
+	std::vector<I> index_list;
+	std::vector<T> value_list;
+};
+
+namespace detail {
+
+// Past this ratio of stored components the shorter vector is galloped through the longer
+constexpr std::size_t gallop_ratio = 8;
+
+// Sum of values[k] * dense[indices[k]], four accumulators to overlap the loads
+template <class T, class I>
+T sparse_dense_dot(const SparseVector<T, I>& sparse, const T* dense)
+{
+	const I* indices = sparse.indices().data();
+	const T* values = sparse.values().data();
+	std::size_t count = sparse.nonzeros();
+	T acc[4] = {0, 0, 0, 0};
+	std::size_t k = 0;
+	for (; k + 4 <= count; k += 4)
+		for (std::size_t u = 0; u < 4; u++)
+			acc[u] += values[k + u] * dense[indices[k + u]];
+	for (; k < count; k++)
+		acc[0] += values[k] * dense[indices[k]];
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// Walks both index lists in step, advancing past the smaller index without a branch,
+// the indices match about as often as not so a branch would be mispredicted
+template <class T, class I>
+T merge_dot(const SparseVector<T, I>& lhs, const SparseVector<T, I>& rhs)
+{
+	const I* a = lhs.indices().data();
+	const I* b = rhs.indices().data();
+	const T* x = lhs.values().data();
+	const T* y = rhs.values().data();
+	std::size_t na = lhs.nonzeros(), nb = rhs.nonzeros();
+	T accumulated_val = 0;
+	std::size_t i = 0, j = 0;
+	while (i < na && j < nb) {
+		I ai = a[i], bj = b[j];
+		accumulated_val += ai == bj ? x[i] * y[j] : T(0);
+		i += ai <= bj;
+		j += bj <= ai;
+	}
+	return accumulated_val;
+}
+
+// For every index of the shorter vector, doubles a step through the longer one until it's
+// passed, then binary searches that last step, O(short log(long / short)) comparisons
+template <class T, class I>
+T gallop_dot(const SparseVector<T, I>& shorter, const SparseVector<T, I>& longer)
+{
+	const I* a = shorter.indices().data();
+	const I* b = longer.indices().data();
+	const T* x = shorter.values().data();
+	const T* y = longer.values().data();
+	std::size_t na = shorter.nonzeros(), nb = longer.nonzeros();
+	T accumulated_val = 0;
+	std::size_t j = 0;
+	for (std::size_t i = 0; i < na && j < nb; i++) {
+		std::size_t step = 1;
+		while (j + step < nb && b[j + step] < a[i])
+			step *= 2;
+		j = std::lower_bound(b + j + step / 2, b + std::min(j + step, nb), a[i]) - b;
+		if (j < nb && b[j] == a[i])
+			accumulated_val += x[i] * y[j];
+	}
+	return accumulated_val;
+}
+
+}
+
+template <class T, class I>
+T dot_product(const SparseVector<T, I>& lhs, const SparseVector<T, I>& rhs)
+{
+	detail::check_dimensions(lhs.size(), rhs.size());
+	if (lhs.nonzeros() * detail::gallop_ratio < rhs.nonzeros())
+		return detail::gallop_dot(lhs, rhs);
+	if (rhs.nonzeros() * detail::gallop_ratio < lhs.nonzeros())
+		return detail::gallop_dot(rhs, lhs);
+	return detail::merge_dot(lhs, rhs);
+}
+
+template <class T, class I, std::size_t N>
+T dot_product(const SparseVector<T, I>& lhs, const Vector<T, N>& rhs)
+{
+	detail::check_dimensions(lhs.size(), N);
+	return detail::sparse_dense_dot(lhs, rhs.data());
+}
+
+template <class T, class I, std::size_t N>
+T dot_product(const Vector<T, N>& lhs, const SparseVector<T, I>& rhs)
+{
+	return dot_product(rhs, lhs);
+}
+
+template <class T, class I, class D, typename std::enable_if_t<is_dynamic_vector<D> && std::is_same_v<typename D::scalar, T>, int> = 0>
+T dot_product(const SparseVector<T, I>& lhs, const D& rhs)
+{
+	detail::check_dimensions(lhs.size(), rhs.size());
+	return detail::sparse_dense_dot(lhs, rhs.data());
+}
+
+template <class T, class I, class D, typename std::enable_if_t<is_dynamic_vector<D> && std::is_same_v<typename D::scalar, T>, int> = 0>
+T dot_product(const D& lhs, const SparseVector<T, I>& rhs)
+{
+	return dot_product(rhs, lhs);
+}
+
+template <class T, class I>
+SparseVector<T, I> operator+(SparseVector<T, I> lhs, const SparseVector<T, I>& rhs)
+{
+	return lhs += rhs;
+}
+
+template <class T, class I>
+SparseVector<T, I> operator-(SparseVector<T, I> lhs, const SparseVector<T, I>& rhs)
+{
+	return lhs -= rhs;
+}
+
+template <class T, class I>
+SparseVector<T, I> operator*(SparseVector<T, I> lhs, const T& rhs)
+{
+	return lhs *= rhs;
+}
+
+template <class T, class I>
+SparseVector<T, I> operator*(const T& lhs, SparseVector<T, I> rhs)
+{
+	return rhs *= lhs;
+}
+
+template <class T, class I>
+T squared_magnitude(const SparseVector<T, I>& vc)
+{
+	T accumulated_val = 0;
+	for (const auto& x : vc.values())
+		accumulated_val += x * x;
+	return accumulated_val;
+}
+
+// F is a square root, like the magnitude of the other run time length vectors
+template <class T, class I, class F>
+auto magnitude(const SparseVector<T, I>& vc, F func)
+{
+	return func(squared_magnitude(vc));
+}
+
+// The functor free magnitudes of vector_functions.hpp
+template <class T, class I>
+auto magnitude(const SparseVector<T, I>& vc)
+{
+	return std::sqrt(squared_magnitude(vc));
+}
+
+template <class T, class I>
+T fast_magnitude(const SparseVector<T, I>& vc)
+{
+	static_assert(std::is_floating_point_v<T>, "fast_magnitude needs floating point vectors");
+	return detail::estimate_sqrt(squared_magnitude(vc));
+}
+
+template <class T, class I>
+T scaled_magnitude(const SparseVector<T, I>& vc)
+{
+	static_assert(std::is_floating_point_v<T>, "scaled_magnitude needs floating point vectors");
+	T squared = squared_magnitude(vc);
+	if (detail::magnitude_in_range(squared))
+		return std::sqrt(squared);
+	return detail::rescaled_magnitude(squared, [&](auto f) {
+		for (const auto& x : vc.values())
+			f(x);
+	});
+}
+
+template <class T, class I>
+bool is_trivial(const SparseVector<T, I>& vc)
+{
+	return vc.nonzeros() == 0;
+}
+
+template <class T, class I, class F>
+std::optional<SparseVector<T, I>> unit_vector(const SparseVector<T, I>& vc, F func)
+{
+	if (is_trivial(vc))
+		return {};
+
+	return vc * (1 / magnitude(vc, func));
+}
+
+template <class T, class I>
+std::optional<SparseVector<T, I>> unit_vector(const SparseVector<T, I>& vc)
+{
+	if (is_trivial(vc))
+		return {};
+
+	return vc * (1 / magnitude(vc));
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_SPARSE_VECTOR_HPP_INCLUDED
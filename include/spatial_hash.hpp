@@ -0,0 +1,268 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_SPATIAL_HASH_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_SPATIAL_HASH_HPP_INCLUDED
+
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+// Fixed radius neighbor search for points that move every frame.
+// Space is cut into cubes of side radius, each cube hashes to a bucket & the points are
+// counting sorted by bucket, so a build is O(n) & a bucket's points are contiguous.
+// Different cells may share a bucket, queries check distances so that only costs time.
+template <class V>
+class SpatialHash {
+public:
+	using scalar = typename V::scalar;
+	static constexpr std::size_t SIZE = V::SIZE;
+	static_assert(std::is_floating_point_v<scalar>, "SpatialHash needs floating point vectors");
+	static_assert(SIZE <= 4, "SpatialHash visits 3^SIZE cells per query, use a KdTree instead");
+
+	explicit SpatialHash(scalar radius) : cell_size(radius)
+	{
+		if (!(radius > 0))
+			throw std::invalid_argument("SpatialHash radius must be positive");
+	}
+
+	scalar radius() const noexcept
+	{
+		return cell_size;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return order.size();
+	}
+
+	// Replaces the points, buffers are kept between builds
+	void build(Span<const V> points, ThreadPool& pool = default_pool())
+	{
+		if (points.size() > std::numeric_limits<std::uint32_t>::max())
+			throw std::length_error("too many points for a SpatialHash");
+		std::size_t count = points.size();
+		std::size_t buckets = 1;
+		while (buckets < count)
+			buckets *= 2;
+		if (buckets > bucket_capacity) {
+			counters.reset(new std::atomic<std::uint32_t>[buckets]);
+			bucket_capacity = buckets;
+		}
+		mask = buckets - 1;
+		keys.resize(count);
+		order.resize(count);
+		starts.resize(buckets + 1);
+		coords.resize(count * SIZE);
+
+		std::size_t grain = 4096;
+		parallel_for_chunks(buckets, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto b = begin; b < end; b++)
+				counters[b].store(0, std::memory_order_relaxed);
+		}, pool);
+		parallel_for_chunks(count, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++) {
+				scalar flat[SIZE];
+				for (auto k = 0U; k < SIZE; k++)
+					flat[k] = points[i][k];
+				keys[i] = bucket(cell(flat));
+				counters[keys[i]].fetch_add(1, std::memory_order_relaxed);
+			}
+		}, pool);
+
+		std::uint32_t total = 0;
+		for (auto b = 0U; b < buckets; b++) {
+			starts[b] = total;
+			total += counters[b].load(std::memory_order_relaxed);
+			counters[b].store(starts[b], std::memory_order_relaxed);
+		}
+		starts[buckets] = total;
+
+		parallel_for_chunks(count, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++)
+				order[counters[keys[i]].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(i);
+		}, pool);
+
+		// The scatter above races within a bucket, sorting each one makes the layout repeatable
+		parallel_for_chunks(buckets, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto b = begin; b < end; b++)
+				if (starts[b + 1] - starts[b] > 1)
+					std::sort(order.begin() + starts[b], order.begin() + starts[b + 1]);
+		}, pool);
+		parallel_for_chunks(count, grain, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; i++)
+				for (auto k = 0U; k < SIZE; k++)
+					coords[i * SIZE + k] = points[order[i]][k];
+		}, pool);
+	}
+
+	// Calls f(index, squared_distance) for every point within radius() of query
+	template <class F>
+	void for_each_neighbor(const V& query, F&& f) const
+	{
+		scalar flat[SIZE];
+		for (auto k = 0U; k < SIZE; k++)
+			flat[k] = query[k];
+		visit_near(flat, [&](std::size_t j, scalar squared) {
+			f(std::size_t(order[j]), squared);
+		});
+	}
+
+	// Calls f(i, j, squared_distance) once for every pair of points within radius() of each other.
+	// Points are visited bucket by bucket so neighboring points are read from the same few buckets.
+	template <class F>
+	void for_each_pair(F&& f) const
+	{
+		for_each_pair(0, size(), f);
+	}
+
+	// Every pair within radius() as (i, j) with i < j, found in parallel. The order doesn't
+	// depend on the number of threads.
+	std::vector<std::pair<std::size_t, std::size_t>> pairs(ThreadPool& pool = default_pool()) const
+	{
+		std::size_t chunks = std::min<std::size_t>(pool.size() * 4, std::max<std::size_t>(size() / 1024, 1));
+		std::vector<std::vector<std::pair<std::size_t, std::size_t>>> found(chunks);
+		pool.parallel_for(chunks, [&](std::size_t chunk) {
+			for_each_pair(size() * chunk / chunks, size() * (chunk + 1) / chunks, [&](std::size_t i, std::size_t j, scalar) {
+				found[chunk].emplace_back(std::min(i, j), std::max(i, j));
+			});
+		});
+
+		std::vector<std::pair<std::size_t, std::size_t>> result;
+		for (auto& part : found)
+			result.insert(result.end(), part.begin(), part.end());
+		return result;
+	}
+
+private:
+	using Cell = std::array<std::int64_t, SIZE>;
+
+	Cell cell(const scalar* point) const
+	{
+		Cell c;
+		for (auto k = 0U; k < SIZE; k++)
+			c[k] = static_cast<std::int64_t>(std::floor(point[k] / cell_size));
+		return c;
+	}
+
+	std::uint32_t bucket(const Cell& c) const
+	{
+		static constexpr std::uint64_t PRIMES[4] = {73856093, 19349663, 83492791, 50331653};
+		std::uint64_t hash = 0;
+		for (auto k = 0U; k < SIZE; k++)
+			hash ^= static_cast<std::uint64_t>(c[k]) * PRIMES[k];
+		return static_cast<std::uint32_t>(hash & mask);
+	}
+
+	// The distinct buckets of the 3^SIZE cells around center
+	std::size_t near_buckets(const Cell& center, std::uint32_t* out) const
+	{
+		std::size_t found = 0;
+		std::size_t cells = 1;
+		for (auto k = 0U; k < SIZE; k++)
+			cells *= 3;
+		for (auto n = 0U; n < cells; n++) {
+			Cell c = center;
+			for (std::size_t k = 0, rest = n; k < SIZE; k++, rest /= 3)
+				c[k] += static_cast<std::int64_t>(rest % 3) - 1;
+			std::uint32_t b = bucket(c);
+			if (std::find(out, out + found, b) == out + found)
+				out[found++] = b;
+		}
+		return found;
+	}
+
+	// Calls f(j, squared_distance) with sorted positions j for the points in the given buckets
+	template <class F>
+	void visit_buckets(const scalar* point, const std::uint32_t* near, std::size_t found, F&& f) const
+	{
+		scalar squared_radius = cell_size * cell_size;
+		for (auto n = 0U; n < found; n++) {
+			for (auto j = starts[near[n]]; j < starts[near[n] + 1]; j++) {
+				const scalar* other = coords.data() + j * SIZE;
+				scalar squared = 0;
+				for (auto k = 0U; k < SIZE; k++)
+					squared += (other[k] - point[k]) * (other[k] - point[k]);
+				if (squared <= squared_radius)
+					f(std::size_t(j), squared);
+			}
+		}
+	}
+
+	template <class F>
+	void visit_near(const scalar* point, F&& f) const
+	{
+		if (order.empty())
+			return;
+		std::uint32_t near[81];
+		visit_buckets(point, near, near_buckets(cell(point), near), f);
+	}
+
+	// Pairs whose lower sorted position is in [begin, end). Points of a cell are mostly
+	// next to each other, so the neighboring buckets are only found again when the cell changes.
+	template <class F>
+	void for_each_pair(std::size_t begin, std::size_t end, F&& f) const
+	{
+		std::uint32_t near[81];
+		std::size_t found = 0;
+		Cell last;
+		for (auto i = begin; i < end; i++) {
+			const scalar* point = coords.data() + i * SIZE;
+			Cell c = cell(point);
+			if (i == begin || c != last) {
+				found = near_buckets(c, near);
+				last = c;
+			}
+			visit_buckets(point, near, found, [&](std::size_t j, scalar squared) {
+				if (j > i)
+					f(std::size_t(order[i]), std::size_t(order[j]), squared);
+			});
+		}
+	}
+
+	scalar cell_size;
+	std::size_t mask = 0;
+	std::size_t bucket_capacity = 0;
+	std::unique_ptr<std::atomic<std::uint32_t>[]> counters;
+	// Bucket of each input point, then the points bucket by bucket
+	std::vector<std::uint32_t> keys;
+	std::vector<std::uint32_t> order;
+	std::vector<std::uint32_t> starts;
+	std::vector<scalar> coords;
+};
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_SPATIAL_HASH_HPP_INCLUDED
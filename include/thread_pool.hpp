@@ -0,0 +1,190 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_THREAD_POOL_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_THREAD_POOL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+// Fixed set of worker threads which run the iterations of one parallel_for at a time.
+// The calling thread works too, so a pool of n threads starts n - 1 workers.
+class ThreadPool {
+public:
+	explicit ThreadPool(std::size_t threads = std::max(1U, std::thread::hardware_concurrency()))
+	{
+		for (std::size_t i = 1; i < threads; i++)
+			workers.emplace_back([this] { work(); });
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	std::size_t size() const noexcept
+	{
+		return workers.size() + 1;
+	}
+
+	// Calls body(i) for every i in [0, count) & returns once all have finished.
+	// Iterations are handed out one at a time, so make each one a decent chunk of work.
+	// Called from inside an iteration it runs serially on that thread.
+	template <class F>
+	void parallel_for(std::size_t count, F&& body)
+	{
+		if (count == 0)
+			return;
+		if (workers.empty() || count == 1 || inside_pool()) {
+			for (std::size_t i = 0; i < count; i++)
+				body(i);
+			return;
+		}
+
+		std::lock_guard<std::mutex> submitting(submit_mutex);
+		std::function<void(std::size_t)> task(std::ref(body));
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &task;
+			job_count = count;
+			next = 0;
+			error = nullptr;
+			generation++;
+		}
+		wake.notify_all();
+
+		inside_pool() = true;
+		run(task, count);
+		inside_pool() = false;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		job = nullptr;
+		if (error)
+			std::rethrow_exception(std::exchange(error, nullptr));
+	}
+
+private:
+	static bool& inside_pool() noexcept
+	{
+		thread_local bool inside = false;
+		return inside;
+	}
+
+	void run(const std::function<void(std::size_t)>& task, std::size_t count)
+	{
+		try {
+			for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+				task(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+				error = std::current_exception();
+			next = count;
+		}
+	}
+
+	void work()
+	{
+		inside_pool() = true;
+		std::size_t seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			// The job may already be finished if this thread woke late
+			if (!job)
+				continue;
+
+			auto task = job;
+			auto count = job_count;
+			busy++;
+			lock.unlock();
+			run(*task, count);
+			lock.lock();
+			if (--busy == 0)
+				done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex submit_mutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(std::size_t)>* job = nullptr;
+	std::size_t job_count = 0;
+	std::atomic<std::size_t> next{0};
+	std::size_t generation = 0;
+	std::size_t busy = 0;
+	std::exception_ptr error;
+	bool stopping = false;
+};
+
+// Pool shared by the library's parallel kernels, sized to the hardware
+inline ThreadPool& default_pool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+// Splits [0, count) into chunks of at least grain elements & calls body(begin, end) for each
+template <class F>
+void parallel_for_chunks(std::size_t count, std::size_t grain, F&& body, ThreadPool& pool = default_pool())
+{
+	grain = std::max<std::size_t>(grain, 1);
+	std::size_t chunks = std::min((count + grain - 1) / grain, pool.size() * 4);
+	if (chunks == 0)
+		return;
+	std::size_t chunk_size = (count + chunks - 1) / chunks;
+	pool.parallel_for((count + chunk_size - 1) / chunk_size, [&](std::size_t chunk) {
+		std::size_t begin = chunk * chunk_size;
+		body(begin, std::min(begin + chunk_size, count));
+	});
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_THREAD_POOL_HPP_INCLUDED
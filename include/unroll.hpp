@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_UNROLL_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_UNROLL_HPP_INCLUDED
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace MathVector {
+
+// Vectors up to this length are expanded into straight line code, longer ones keep a loop
+constexpr std::size_t max_unroll = 16;
+
+template <std::size_t I>
+using index_constant = std::integral_constant<std::size_t, I>;
+
+namespace detail {
+
+template <class F, std::size_t... I>
+constexpr void unroll(F& f, std::index_sequence<I...>)
+{
+	(f(index_constant<I>()), ...);
+}
+
+template <class F, std::size_t... I>
+constexpr bool any_of(F& pred, std::index_sequence<I...>)
+{
+	return (false || ... || pred(index_constant<I>()));
+}
+
+}
+
+// Calls f(index_constant<i>()) for i in [0, N), fully unrolled so the index is a constant
+// in every call & arrays indexed by it can live in registers
+template <std::size_t N, class F>
+constexpr void unroll(F&& f)
+{
+	detail::unroll(f, std::make_index_sequence<N>());
+}
+
+// Calls f(i) for i in [0, N), unrolled with index_constant for N up to max_unroll & with
+// a std::size_t loop beyond, so f must accept either
+template <std::size_t N, class F>
+constexpr void for_each_index(F&& f)
+{
+	if constexpr (N <= max_unroll) {
+		detail::unroll(f, std::make_index_sequence<N>());
+	}
+	else {
+		for (std::size_t i = 0; i < N; i++)
+			f(i);
+	}
+}
+
+// True when pred(i) holds for some i in [0, N), testing in order & stopping at the first
+// match, the short circuit of a fold for N up to max_unroll & a loop beyond
+template <std::size_t N, class F>
+constexpr bool any_of_index(F&& pred)
+{
+	if constexpr (N <= max_unroll) {
+		return detail::any_of(pred, std::make_index_sequence<N>());
+	}
+	else {
+		for (std::size_t i = 0; i < N; i++)
+			if (pred(i))
+				return true;
+		return false;
+	}
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_UNROLL_HPP_INCLUDED
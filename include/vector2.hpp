@@ -33,6 +33,8 @@ struct Vector2 {
 	T x, y;
 
 	static constexpr std::size_t SIZE = 2;
+	// operator[] looks the member up here, a single load instead of a chain of branches
+	static constexpr T Vector2::* MEMBERS[SIZE] = {&Vector2::x, &Vector2::y};
 	using scalar = T;
 
 	constexpr Vector2() noexcept(std::is_nothrow_default_constructible<T>()) = default;
@@ -81,21 +83,39 @@ struct Vector2 {
 	{
 		assert(i < SIZE);
 
-		if (i == 0)
-			return x;
-		if (i == 1)
-			return y;
-
-		return x; // This should never be reached.
+		return this->*MEMBERS[i];
 	}
 
 	constexpr T& operator[](std::size_t i)
 	{
-		return const_cast<T&>(const_cast<const Vector2<T>*>(this)->operator[](i));
+		assert(i < SIZE);
+
+		return this->*MEMBERS[i];
 	}
 
 };
 
+// Compile time element access, resolves to the member without any index arithmetic
+template <std::size_t I, class T>
+constexpr T& get(Vector2<T>& vc) noexcept
+{
+	static_assert(I < Vector2<T>::SIZE, "Vector2 index out of range");
+	if constexpr (I == 0)
+		return vc.x;
+	else
+		return vc.y;
+}
+
+template <std::size_t I, class T>
+constexpr const T& get(const Vector2<T>& vc) noexcept
+{
+	static_assert(I < Vector2<T>::SIZE, "Vector2 index out of range");
+	if constexpr (I == 0)
+		return vc.x;
+	else
+		return vc.y;
+}
+
 template <class T>
 constexpr bool operator==(const Vector2<T>& lhs, const Vector2<T>& rhs)
 {
@@ -33,6 +33,8 @@ struct Vector3 {
 	T x, y, z;
 
 	static constexpr std::size_t SIZE = 3;
+	// operator[] looks the member up here, a single load instead of a chain of branches
+	static constexpr T Vector3::* MEMBERS[SIZE] = {&Vector3::x, &Vector3::y, &Vector3::z};
 	using scalar = T;
 
 	constexpr Vector3() noexcept(std::is_nothrow_default_constructible<T>()) = default;
@@ -72,19 +74,14 @@ struct Vector3 {
 	{
 		assert(i < SIZE);
 
-		if (i == 0)
-			return x;
-		if (i == 1)
-			return y;
-		if (i == 2)
-			return z;
-
-		return x; // This should never be reached.
+		return this->*MEMBERS[i];
 	}
 
 	constexpr T& operator[](std::size_t i)
 	{
-		return const_cast<T&>(const_cast<const Vector3<T>*>(this)->operator[](i));
+		assert(i < SIZE);
+
+		return this->*MEMBERS[i];
 	}
 
 	constexpr const Vector3<T>& operator+() const
@@ -98,6 +95,31 @@ struct Vector3 {
 	}
 };
 
+// Compile time element access, resolves to the member without any index arithmetic
+template <std::size_t I, class T>
+constexpr T& get(Vector3<T>& vc) noexcept
+{
+	static_assert(I < Vector3<T>::SIZE, "Vector3 index out of range");
+	if constexpr (I == 0)
+		return vc.x;
+	else if constexpr (I == 1)
+		return vc.y;
+	else
+		return vc.z;
+}
+
+template <std::size_t I, class T>
+constexpr const T& get(const Vector3<T>& vc) noexcept
+{
+	static_assert(I < Vector3<T>::SIZE, "Vector3 index out of range");
+	if constexpr (I == 0)
+		return vc.x;
+	else if constexpr (I == 1)
+		return vc.y;
+	else
+		return vc.z;
+}
+
 template <class T>
 constexpr bool operator==(const Vector3<T>& lhs, const Vector3<T>& rhs)
 {
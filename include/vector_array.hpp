@@ -24,11 +24,16 @@ SOFTWARE.
 #ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_HPP_INCLUDED
 #define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_HPP_INCLUDED
 
+#include "simd_dispatch.hpp"
+#include "unroll.hpp"
 #include <array>
 #include <type_traits>
 
 namespace MathVector {
 
+template <class E>
+struct VectorExpression;
+
 template <class T, std::size_t N>
 struct Vector : public std::array<T, N> {
 
@@ -44,22 +49,66 @@ struct Vector : public std::array<T, N> {
 
 	constexpr Vector<T, N> operator+=(const Vector<T, N>& rhs)
 	{
-		for (auto i = 0U; i < SIZE; i++)
-			this->operator[](i) += rhs[i];
+		if constexpr (simd::dispatches<T, N>) {
+			if (!MATHVECTOR_CONSTANT_EVALUATED()) {
+				simd::kernels<T>().add(this->data(), rhs.data(), N);
+				return *this;
+			}
+		}
+		for_each_index<N>([&](auto i) { (*this)[i] += rhs[i]; });
 		return *this;
 	}
 
 	constexpr Vector<T, N> operator-=(const Vector<T, N>& rhs)
 	{
-		for (auto i = 0U; i < SIZE; i++)
-			this->operator[](i) -= rhs[i];
+		if constexpr (simd::dispatches<T, N>) {
+			if (!MATHVECTOR_CONSTANT_EVALUATED()) {
+				simd::kernels<T>().sub(this->data(), rhs.data(), N);
+				return *this;
+			}
+		}
+		for_each_index<N>([&](auto i) { (*this)[i] -= rhs[i]; });
 		return *this;
 	}
 
 	constexpr Vector<T, N> operator*=(const T& rhs)
 	{
-		for (auto i = 0U; i < SIZE; i++)
-			this->operator[](i) *= rhs;
+		if constexpr (simd::dispatches<T, N>) {
+			if (!MATHVECTOR_CONSTANT_EVALUATED()) {
+				simd::kernels<T>().scale(this->data(), rhs, N);
+				return *this;
+			}
+		}
+		for_each_index<N>([&](auto i) { (*this)[i] *= rhs; });
+		return *this;
+	}
+
+	// Evaluates a lazy expression from vector_expression.hpp in a single pass.
+	// The nodes are copied first so the optimizer knows the loop can't change them.
+	template <class E>
+	constexpr Vector<T, N>& operator=(const VectorExpression<E>& expr)
+	{
+		static_assert(E::SIZE == N, "expression & vector lengths differ");
+		const E nodes = static_cast<const E&>(expr);
+		for_each_index<N>([&](auto i) { (*this)[i] = nodes[i]; });
+		return *this;
+	}
+
+	template <class E>
+	constexpr Vector<T, N>& operator+=(const VectorExpression<E>& expr)
+	{
+		static_assert(E::SIZE == N, "expression & vector lengths differ");
+		const E nodes = static_cast<const E&>(expr);
+		for_each_index<N>([&](auto i) { (*this)[i] += nodes[i]; });
+		return *this;
+	}
+
+	template <class E>
+	constexpr Vector<T, N>& operator-=(const VectorExpression<E>& expr)
+	{
+		static_assert(E::SIZE == N, "expression & vector lengths differ");
+		const E nodes = static_cast<const E&>(expr);
+		for_each_index<N>([&](auto i) { (*this)[i] -= nodes[i]; });
 		return *this;
 	}
 
@@ -70,11 +119,28 @@ struct Vector : public std::array<T, N> {
 
 	constexpr Vector<T, N> operator-() const
 	{
-		return *this * -1;
+		Vector<T, N> result{};
+		for_each_index<N>([&](auto i) { result[i] = -(*this)[i]; });
+		return result;
 	}
 
 };
 
+// Compile time element access, the index is checked when the program is built
+template <std::size_t I, class T, std::size_t N>
+constexpr T& get(Vector<T, N>& vc) noexcept
+{
+	static_assert(I < N, "Vector index out of range");
+	return vc[I];
+}
+
+template <std::size_t I, class T, std::size_t N>
+constexpr const T& get(const Vector<T, N>& vc) noexcept
+{
+	static_assert(I < N, "Vector index out of range");
+	return vc[I];
+}
+
 template <class T, std::size_t N>
 constexpr Vector<T, N> operator+(Vector<T, N> lhs, const Vector<T, N>& rhs)
 {
@@ -0,0 +1,223 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_EXPRESSION_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_EXPRESSION_HPP_INCLUDED
+
+#include "vector_array.hpp"
+#include "vector_functions.hpp"
+#include <type_traits>
+
+namespace MathVector {
+
+// Base of every lazy expression, E is the derived node.
+// Nodes are evaluated element by element, in a single loop, when assigned to a Vector.
+template <class E>
+struct VectorExpression {
+	constexpr const E& derived() const noexcept
+	{
+		return static_cast<const E&>(*this);
+	}
+
+	template <class T, std::size_t N>
+	constexpr operator Vector<T, N>() const
+	{
+		static_assert(N == E::SIZE, "expression & vector lengths differ");
+		const E nodes = derived();
+		Vector<T, N> vc{};
+		for (auto i = 0U; i < N; i++)
+			vc[i] = nodes[i];
+		return vc;
+	}
+};
+
+template <class E>
+constexpr bool is_vector_expression = std::is_base_of_v<VectorExpression<E>, E>;
+
+template <class T>
+constexpr bool is_vector_array = false;
+
+template <class T, std::size_t N>
+constexpr bool is_vector_array<Vector<T, N>> = true;
+
+// True when at least one operand is lazy & the other is lazy or a Vector
+template <class L, class R>
+constexpr bool is_lazy_operands = (is_vector_expression<L> || is_vector_expression<R>)
+	&& (is_vector_expression<L> || is_vector_array<L>)
+	&& (is_vector_expression<R> || is_vector_array<R>);
+
+// Refers to a Vector, the vector must outlive the expression.
+template <class T, std::size_t N>
+struct VectorLeaf : VectorExpression<VectorLeaf<T, N>> {
+	static constexpr std::size_t SIZE = N;
+	using scalar = T;
+
+	constexpr explicit VectorLeaf(const Vector<T, N>& vc) noexcept : vc(vc) {}
+
+	constexpr const T& operator[](std::size_t i) const
+	{
+		return vc[i];
+	}
+
+	const Vector<T, N>& vc;
+};
+
+template <class L, class R>
+struct VectorSum : VectorExpression<VectorSum<L, R>> {
+	static_assert(L::SIZE == R::SIZE, "expression lengths differ");
+	static constexpr std::size_t SIZE = L::SIZE;
+	using scalar = typename L::scalar;
+
+	constexpr VectorSum(const L& lhs, const R& rhs) : lhs(lhs), rhs(rhs) {}
+
+	constexpr scalar operator[](std::size_t i) const
+	{
+		return lhs[i] + rhs[i];
+	}
+
+	L lhs;
+	R rhs;
+};
+
+template <class L, class R>
+struct VectorDifference : VectorExpression<VectorDifference<L, R>> {
+	static_assert(L::SIZE == R::SIZE, "expression lengths differ");
+	static constexpr std::size_t SIZE = L::SIZE;
+	using scalar = typename L::scalar;
+
+	constexpr VectorDifference(const L& lhs, const R& rhs) : lhs(lhs), rhs(rhs) {}
+
+	constexpr scalar operator[](std::size_t i) const
+	{
+		return lhs[i] - rhs[i];
+	}
+
+	L lhs;
+	R rhs;
+};
+
+template <class E>
+struct VectorScaled : VectorExpression<VectorScaled<E>> {
+	static constexpr std::size_t SIZE = E::SIZE;
+	using scalar = typename E::scalar;
+
+	constexpr VectorScaled(const E& expr, const scalar& factor) : expr(expr), factor(factor) {}
+
+	constexpr scalar operator[](std::size_t i) const
+	{
+		return expr[i] * factor;
+	}
+
+	E expr;
+	scalar factor;
+};
+
+template <class E>
+struct VectorNegation : VectorExpression<VectorNegation<E>> {
+	static constexpr std::size_t SIZE = E::SIZE;
+	using scalar = typename E::scalar;
+
+	constexpr explicit VectorNegation(const E& expr) : expr(expr) {}
+
+	constexpr scalar operator[](std::size_t i) const
+	{
+		return -expr[i];
+	}
+
+	E expr;
+};
+
+// Starts a lazy expression, e.g. lazy(a) + b * s - c
+template <class T, std::size_t N>
+constexpr VectorLeaf<T, N> lazy(const Vector<T, N>& vc) noexcept
+{
+	return VectorLeaf<T, N>(vc);
+}
+
+template <class E>
+constexpr const E& as_expression(const VectorExpression<E>& expr) noexcept
+{
+	return expr.derived();
+}
+
+template <class T, std::size_t N>
+constexpr VectorLeaf<T, N> as_expression(const Vector<T, N>& vc) noexcept
+{
+	return VectorLeaf<T, N>(vc);
+}
+
+// Materializes an expression into a Vector
+template <class E>
+constexpr Vector<typename E::scalar, E::SIZE> evaluate(const VectorExpression<E>& expr)
+{
+	return expr;
+}
+
+template <class L, class R, typename std::enable_if_t<is_lazy_operands<L, R>, int> = 0>
+constexpr auto operator+(const L& lhs, const R& rhs)
+{
+	using LE = std::decay_t<decltype(as_expression(lhs))>;
+	using RE = std::decay_t<decltype(as_expression(rhs))>;
+	return VectorSum<LE, RE>(as_expression(lhs), as_expression(rhs));
+}
+
+template <class L, class R, typename std::enable_if_t<is_lazy_operands<L, R>, int> = 0>
+constexpr auto operator-(const L& lhs, const R& rhs)
+{
+	using LE = std::decay_t<decltype(as_expression(lhs))>;
+	using RE = std::decay_t<decltype(as_expression(rhs))>;
+	return VectorDifference<LE, RE>(as_expression(lhs), as_expression(rhs));
+}
+
+template <class E, typename std::enable_if_t<is_vector_expression<E>, int> = 0>
+constexpr VectorScaled<E> operator*(const E& lhs, const typename E::scalar& rhs)
+{
+	return VectorScaled<E>(lhs, rhs);
+}
+
+template <class E, typename std::enable_if_t<is_vector_expression<E>, int> = 0>
+constexpr VectorScaled<E> operator*(const typename E::scalar& lhs, const E& rhs)
+{
+	return VectorScaled<E>(rhs, lhs);
+}
+
+template <class E, typename std::enable_if_t<is_vector_expression<E>, int> = 0>
+constexpr VectorNegation<E> operator-(const E& expr)
+{
+	return VectorNegation<E>(expr);
+}
+
+// Dot product of expressions, evaluated in the same loop as the accumulation
+template <class L, class R, typename std::enable_if_t<is_lazy_operands<L, R>, int> = 0>
+constexpr auto dot_product(const L& lhs, const R& rhs)
+{
+	static_assert(L::SIZE == R::SIZE, "expression lengths differ");
+	typename L::scalar accumulated_val = 0;
+	for (auto i = 0U; i < L::SIZE; i++)
+		accumulated_val += lhs[i] * rhs[i];
+	return accumulated_val;
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_EXPRESSION_HPP_INCLUDED
@@ -0,0 +1,417 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FILE_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FILE_HPP_INCLUDED
+
+#include "span.hpp"
+#include "vector_soa.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MathVector {
+
+// File layout, all in native byte order:
+//   VectorFileHeader, padded with zeros to payload_offset (a multiple of the page size)
+//   AoS: count vectors of dimension scalars each
+//   SoA: dimension lanes of count scalars, each starting lane_stride bytes after the last
+enum class ScalarType : std::uint32_t {
+	int8 = 1, int16, int32, int64,
+	uint8, uint16, uint32, uint64,
+	float32, float64,
+};
+
+enum class VectorLayout : std::uint32_t {
+	aos = 0,
+	soa = 1,
+};
+
+struct VectorFileHeader {
+	static constexpr char MAGIC[4] = {'M', 'V', 'E', 'C'};
+	static constexpr std::uint32_t VERSION = 1;
+	static constexpr std::uint32_t ORDER_MARK = 0x01020304;
+	static constexpr std::uint64_t PAYLOAD_ALIGNMENT = 4096;
+	static constexpr std::uint64_t LANE_ALIGNMENT = 64;
+
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	ScalarType scalar_type;
+	std::uint32_t scalar_size;
+	VectorLayout layout;
+	std::uint64_t dimension;
+	std::uint64_t count;
+	std::uint64_t payload_offset;
+	std::uint64_t lane_stride;
+	std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(VectorFileHeader) == 64, "header must stay 64 bytes");
+
+template <class T>
+constexpr ScalarType scalar_type_of()
+{
+	static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "no file scalar type for T");
+	if constexpr (std::is_floating_point_v<T>) {
+		static_assert(sizeof(T) == 4 || sizeof(T) == 8, "only 32 & 64 bit floats are stored");
+		return sizeof(T) == 4 ? ScalarType::float32 : ScalarType::float64;
+	} else if constexpr (std::is_signed_v<T>) {
+		return sizeof(T) == 1 ? ScalarType::int8 : sizeof(T) == 2 ? ScalarType::int16
+			: sizeof(T) == 4 ? ScalarType::int32 : ScalarType::int64;
+	} else {
+		return sizeof(T) == 1 ? ScalarType::uint8 : sizeof(T) == 2 ? ScalarType::uint16
+			: sizeof(T) == 4 ? ScalarType::uint32 : ScalarType::uint64;
+	}
+}
+
+namespace detail {
+
+// Bytes per scalar of a stored type, 0 if the type isn't known
+constexpr std::uint32_t scalar_size_of(ScalarType type)
+{
+	switch (type) {
+	case ScalarType::int8: case ScalarType::uint8: return 1;
+	case ScalarType::int16: case ScalarType::uint16: return 2;
+	case ScalarType::int32: case ScalarType::uint32: case ScalarType::float32: return 4;
+	case ScalarType::int64: case ScalarType::uint64: case ScalarType::float64: return 8;
+	}
+	return 0;
+}
+
+// Header sizes come from the file, so these report overflow rather than wrap around
+inline bool checked_multiply(std::uint64_t lhs, std::uint64_t rhs, std::uint64_t& out)
+{
+	if (rhs != 0 && lhs > UINT64_MAX / rhs)
+		return false;
+	out = lhs * rhs;
+	return true;
+}
+
+inline bool checked_add(std::uint64_t lhs, std::uint64_t rhs, std::uint64_t& out)
+{
+	if (lhs > UINT64_MAX - rhs)
+		return false;
+	out = lhs + rhs;
+	return true;
+}
+
+constexpr std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+template <class V>
+VectorFileHeader make_header(VectorLayout layout, std::uint64_t count)
+{
+	using T = typename V::scalar;
+	VectorFileHeader header{};
+	std::memcpy(header.magic, VectorFileHeader::MAGIC, sizeof(header.magic));
+	header.version = VectorFileHeader::VERSION;
+	header.byte_order = VectorFileHeader::ORDER_MARK;
+	header.scalar_type = scalar_type_of<T>();
+	header.scalar_size = sizeof(T);
+	header.layout = layout;
+	header.dimension = V::SIZE;
+	header.count = count;
+	header.payload_offset = VectorFileHeader::PAYLOAD_ALIGNMENT;
+	header.lane_stride = layout == VectorLayout::soa ? align_up(count * sizeof(T), VectorFileHeader::LANE_ALIGNMENT) : 0;
+	return header;
+}
+
+inline void write_bytes(std::FILE* file, const void* data, std::size_t bytes)
+{
+	if (bytes != 0 && std::fwrite(data, 1, bytes, file) != bytes)
+		throw std::system_error(errno, std::generic_category(), "writing vector file");
+}
+
+inline void write_zeros(std::FILE* file, std::size_t bytes)
+{
+	static const char zeros[4096] = {};
+	for (; bytes > sizeof(zeros); bytes -= sizeof(zeros))
+		write_bytes(file, zeros, sizeof(zeros));
+	write_bytes(file, zeros, bytes);
+}
+
+}
+
+// Maps a vector file read only. Nothing is copied, pages are read in as they're touched.
+class MappedVectorFile {
+public:
+	explicit MappedVectorFile(const std::string& path)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "opening " + path);
+
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "reading size of " + path);
+		}
+		length = static_cast<std::size_t>(info.st_size);
+
+		if (length >= sizeof(VectorFileHeader))
+			address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		int error = errno;
+		::close(fd);
+		if (length < sizeof(VectorFileHeader))
+			throw std::runtime_error(path + " is too short to be a vector file");
+		if (address == MAP_FAILED) {
+			address = nullptr;
+			throw std::system_error(error, std::generic_category(), "mapping " + path);
+		}
+
+		try {
+			validate(path);
+		}
+		catch (...) {
+			unmap();
+			throw;
+		}
+	}
+
+	MappedVectorFile(MappedVectorFile&& other) noexcept
+		: address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) {}
+
+	MappedVectorFile& operator=(MappedVectorFile&& other) noexcept
+	{
+		if (this != &other) {
+			unmap();
+			address = std::exchange(other.address, nullptr);
+			length = std::exchange(other.length, 0);
+		}
+		return *this;
+	}
+
+	MappedVectorFile(const MappedVectorFile&) = delete;
+	MappedVectorFile& operator=(const MappedVectorFile&) = delete;
+
+	~MappedVectorFile()
+	{
+		unmap();
+	}
+
+	const VectorFileHeader& header() const noexcept
+	{
+		return *static_cast<const VectorFileHeader*>(address);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return header().count;
+	}
+
+	// The payload of an AoS file as vectors, V must match the stored scalar type & dimension
+	template <class V>
+	Span<const V> vectors() const
+	{
+		using T = typename V::scalar;
+		static_assert(std::is_standard_layout_v<V> && sizeof(V) == V::SIZE * sizeof(T),
+			"vector components must be tightly packed");
+		check_type<T>(V::SIZE);
+		if (header().layout != VectorLayout::aos)
+			throw std::runtime_error("vector file isn't in AoS layout");
+		return Span<const V>(reinterpret_cast<const V*>(payload()), size());
+	}
+
+	// Component k of every vector in an SoA file
+	template <class T>
+	Span<const T> lane(std::size_t k) const
+	{
+		check_type<T>(header().dimension);
+		if (header().layout != VectorLayout::soa)
+			throw std::runtime_error("vector file isn't in SoA layout");
+		if (k >= header().dimension)
+			throw std::out_of_range("vector file lane out of range");
+		return Span<const T>(reinterpret_cast<const T*>(payload() + k * header().lane_stride), size());
+	}
+
+	// Hints that the payload will be read front to back
+	void advise_sequential() const noexcept
+	{
+		::madvise(address, length, MADV_SEQUENTIAL);
+	}
+
+private:
+	const char* payload() const noexcept
+	{
+		return static_cast<const char*>(address) + header().payload_offset;
+	}
+
+	template <class T>
+	void check_type(std::uint64_t dimension) const
+	{
+		if (header().scalar_type != scalar_type_of<T>() || header().dimension != dimension)
+			throw std::runtime_error("vector file holds a different scalar type or dimension");
+	}
+
+	void validate(const std::string& path) const
+	{
+		auto& h = header();
+		if (std::memcmp(h.magic, VectorFileHeader::MAGIC, sizeof(h.magic)) != 0)
+			throw std::runtime_error(path + " isn't a vector file");
+		if (h.version != VectorFileHeader::VERSION)
+			throw std::runtime_error(path + " has unsupported version " + std::to_string(h.version));
+		if (h.byte_order != VectorFileHeader::ORDER_MARK)
+			throw std::runtime_error(path + " was written with a different byte order");
+		if (h.payload_offset % VectorFileHeader::LANE_ALIGNMENT != 0 || h.payload_offset < sizeof(VectorFileHeader))
+			throw std::runtime_error(path + " has a misaligned payload");
+
+		if (h.layout != VectorLayout::aos && h.layout != VectorLayout::soa)
+			throw std::runtime_error(path + " has unknown layout " + std::to_string(static_cast<std::uint32_t>(h.layout)));
+		if (h.scalar_size == 0 || h.scalar_size != detail::scalar_size_of(h.scalar_type))
+			throw std::runtime_error(path + " has a scalar size that doesn't match its scalar type");
+
+		std::uint64_t lane_bytes = 0, payload_bytes = 0, end = 0;
+		if (!detail::checked_multiply(h.count, h.scalar_size, lane_bytes))
+			throw std::runtime_error(path + " has too many vectors");
+		if (h.layout == VectorLayout::soa && h.lane_stride < lane_bytes)
+			throw std::runtime_error(path + " has overlapping lanes");
+		if (h.layout == VectorLayout::soa && h.lane_stride % VectorFileHeader::LANE_ALIGNMENT != 0)
+			throw std::runtime_error(path + " has misaligned lanes");
+		std::uint64_t stride = h.layout == VectorLayout::soa ? h.lane_stride : lane_bytes;
+		if (!detail::checked_multiply(stride, h.dimension, payload_bytes) || !detail::checked_add(h.payload_offset, payload_bytes, end))
+			throw std::runtime_error(path + " has too many vectors");
+		if (end > length)
+			throw std::runtime_error(path + " is truncated");
+	}
+
+	void unmap() noexcept
+	{
+		if (address)
+			::munmap(address, length);
+		address = nullptr;
+	}
+
+	void* address = nullptr;
+	std::size_t length = 0;
+};
+
+// Streams vectors to an AoS file, the count in the header is filled in by close()
+template <class V>
+class VectorFileWriter {
+public:
+	explicit VectorFileWriter(const std::string& path) : file(std::fopen(path.c_str(), "wb"))
+	{
+		if (!file)
+			throw std::system_error(errno, std::generic_category(), "creating " + path);
+		auto header = detail::make_header<V>(VectorLayout::aos, 0);
+		try {
+			detail::write_bytes(file, &header, sizeof(header));
+			detail::write_zeros(file, header.payload_offset - sizeof(header));
+		}
+		catch (...) {
+			std::fclose(file);
+			throw;
+		}
+	}
+
+	VectorFileWriter(const VectorFileWriter&) = delete;
+	VectorFileWriter& operator=(const VectorFileWriter&) = delete;
+
+	// Closes the file, errors are lost here so call close() to see them
+	~VectorFileWriter()
+	{
+		try {
+			close();
+		}
+		catch (...) {
+		}
+	}
+
+	void write(Span<const V> vcs)
+	{
+		for (auto& vc : vcs)
+			write(vc);
+	}
+
+	void write(const V& vc)
+	{
+		typename V::scalar components[V::SIZE];
+		for (auto k = 0U; k < V::SIZE; k++)
+			components[k] = vc[k];
+		detail::write_bytes(file, components, sizeof(components));
+		count++;
+	}
+
+	void close()
+	{
+		if (!file)
+			return;
+		std::FILE* closing = std::exchange(file, nullptr);
+		auto header = detail::make_header<V>(VectorLayout::aos, count);
+		bool ok = std::fseek(closing, 0, SEEK_SET) == 0
+			&& std::fwrite(&header, sizeof(header), 1, closing) == 1;
+		int error = errno;
+		ok = std::fclose(closing) == 0 && ok;
+		if (!ok)
+			throw std::system_error(error, std::generic_category(), "finishing vector file");
+	}
+
+private:
+	std::FILE* file;
+	std::uint64_t count = 0;
+};
+
+// Writes a whole batch as an SoA file, one lane after another
+template <class V, class A>
+void write_vector_file(const std::string& path, const VectorSoA<V, A>& vcs)
+{
+	using T = typename V::scalar;
+	auto header = detail::make_header<V>(VectorLayout::soa, vcs.size());
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file)
+		throw std::system_error(errno, std::generic_category(), "creating " + path);
+	try {
+		detail::write_bytes(file, &header, sizeof(header));
+		detail::write_zeros(file, header.payload_offset - sizeof(header));
+		for (auto k = 0U; k < V::SIZE; k++) {
+			detail::write_bytes(file, vcs.lane(k), vcs.size() * sizeof(T));
+			detail::write_zeros(file, header.lane_stride - vcs.size() * sizeof(T));
+		}
+	}
+	catch (...) {
+		std::fclose(file);
+		throw;
+	}
+	if (std::fclose(file) != 0)
+		throw std::system_error(errno, std::generic_category(), "finishing " + path);
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FILE_HPP_INCLUDED
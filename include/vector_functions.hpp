@@ -24,21 +24,48 @@ SOFTWARE.
 #ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FUNCTIONS_HPP_INCLUDED
 #define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FUNCTIONS_HPP_INCLUDED
 
+#include "simd.hpp"
+#include "simd_dispatch.hpp"
+#include "unroll.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
 #include <optional>
 #include <type_traits>
 
 namespace MathVector {
 
+// Vectors whose length is part of the type, the run time length ones are in dynamic_vector.hpp
+template <class T, class = void>
+constexpr bool has_static_size = false;
+
 template <class T>
+constexpr bool has_static_size<T, std::void_t<decltype(T::SIZE)>> = true;
+
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
 constexpr auto dot_product(const T& lhs, const T& rhs)
 {
+	if constexpr (simd::dispatches_vector<T>) {
+		if (!MATHVECTOR_CONSTANT_EVALUATED())
+			return simd::kernels<typename T::scalar>().dot(lhs.data(), rhs.data(), T::SIZE);
+	}
 	typename T::scalar accumulated_val = 0;
-	for (auto i = 0U; i < T::SIZE; i++)
-		accumulated_val += lhs[i] * rhs[i];
+	for_each_index<T::SIZE>([&](auto i) { accumulated_val += lhs[i] * rhs[i]; });
 	return accumulated_val;
 }
 
+// Cross product of three space vectors, perpendicular to both with length |lhs| |rhs| sin(angle)
+template <class T, typename std::enable_if_t<T::SIZE == 3, int> = 0>
+constexpr T cross_product(const T& lhs, const T& rhs)
+{
+	T result{};
+	result[0] = lhs[1] * rhs[2] - lhs[2] * rhs[1];
+	result[1] = lhs[2] * rhs[0] - lhs[0] * rhs[2];
+	result[2] = lhs[0] * rhs[1] - lhs[1] * rhs[0];
+	return result;
+}
+
 // Vector 2 magnitude using hypot fn
 template <class T, class F, typename std::enable_if_t<T::SIZE == 2, int> = 0>
 constexpr auto magnitude(const T& vc, F func)
@@ -60,16 +87,129 @@ constexpr auto magnitude(const T& vc, F func)
 	return func(dot_product(vc, vc));
 }
 
+// The dot product of vc with itself, enough to compare lengths without a square root
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+constexpr auto squared_magnitude(const T& vc)
+{
+	return dot_product(vc, vc);
+}
+
+namespace detail {
+
+// Below this the squares of the components lose precision to underflow
 template <class T>
-constexpr bool is_trivial(const T& vc)
+constexpr T magnitude_min = std::numeric_limits<T>::min() / std::numeric_limits<T>::epsilon();
+
+// Whether a squared magnitude is safe to take the square root of, false when it overflowed,
+// underflowed or holds a NaN. Rare enough that checking costs less than always scaling.
+template <class T>
+constexpr bool magnitude_in_range(T squared)
 {
-	for (int i = 0; i < T::SIZE; i++)
-		if (vc[i] != 0)
-			return false;
-	return true;
+	return squared >= magnitude_min<T> && squared <= std::numeric_limits<T>::max();
 }
 
+// The magnitude with every component scaled by the power of 2 nearest the largest,
+// which is exact, so the squares can neither overflow nor underflow.
+// for_each_component(f) calls f on every component.
 template <class T, class F>
+T rescaled_magnitude(T squared, F for_each_component)
+{
+	if (squared != squared)
+		return squared;
+	T largest = 0;
+	for_each_component([&](T x) { largest = std::max(largest, std::fabs(x)); });
+	if (largest == 0 || largest > std::numeric_limits<T>::max())
+		return largest;
+	int exponent = std::ilogb(largest);
+	T sum = 0;
+	for_each_component([&](T x) {
+		T scaled = std::scalbn(x, -exponent);
+		sum += scaled * scaled;
+	});
+	return std::scalbn(std::sqrt(sum), exponent);
+}
+
+// Whether the reciprocal square root estimate of squared is finite & nonzero, so it can be refined
+template <class T>
+bool estimate_in_range(T smallest, T largest)
+{
+	return smallest >= std::numeric_limits<T>::min() && largest <= std::numeric_limits<T>::max();
+}
+
+// Square roots of a pack of squared magnitudes from the reciprocal square root estimate & one
+// Newton-Raphson step, about 22 bits for float. Packs holding a zero, subnormal, infinite or NaN
+// square, where the estimate is infinite or zero, use the exact square root, as do types without an
+// estimate, as it's faster than refining 1 / sqrt.
+template <class P>
+typename P::type estimate_sqrt(typename P::type squared)
+{
+	using T = decltype(P::hsum(P::zero()));
+	if constexpr (std::is_same_v<T, float> && P::width > 1) {
+		if (!estimate_in_range(P::hmin(squared), P::hmax(squared)))
+			return P::sqrt(squared);
+		auto y = P::rsqrt(squared);
+		auto half = P::mul(P::set1(0.5f), squared);
+		y = P::mul(y, P::sub(P::set1(1.5f), P::mul(half, P::mul(y, y))));
+		return P::mul(squared, y);
+	} else {
+		return P::sqrt(squared);
+	}
+}
+
+template <class T>
+T estimate_sqrt(T squared)
+{
+	using P = simd::pack<T>;
+	if constexpr (std::is_same_v<T, float> && P::width > 1) {
+		if (!estimate_in_range(squared, squared))
+			return std::sqrt(squared);
+		T lanes[P::width];
+		P::store(lanes, estimate_sqrt<P>(P::set1(squared)));
+		return lanes[0];
+	} else {
+		return std::sqrt(squared);
+	}
+}
+
+}
+
+// The square root of the squared magnitude, a double for integer vectors
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+auto magnitude(const T& vc)
+{
+	return std::sqrt(squared_magnitude(vc));
+}
+
+// The magnitude from the reciprocal square root estimate, to about 22 bits for float,
+// other types get the exact magnitude. Squares the estimate can't refine, zero, subnormal or
+// past the float range, get the exact square root of the square, so they can still overflow.
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+auto fast_magnitude(const T& vc)
+{
+	static_assert(std::is_floating_point_v<typename T::scalar>, "fast_magnitude needs floating point vectors");
+	return detail::estimate_sqrt(squared_magnitude(vc));
+}
+
+// The magnitude like hypot, correct even where the squared magnitude over or underflows.
+// Only vectors whose squared magnitude is out of range pay for the scaling.
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+auto scaled_magnitude(const T& vc)
+{
+	using S = typename T::scalar;
+	static_assert(std::is_floating_point_v<S>, "scaled_magnitude needs floating point vectors");
+	S squared = squared_magnitude(vc);
+	if (detail::magnitude_in_range(squared))
+		return std::sqrt(squared);
+	return detail::rescaled_magnitude(squared, [&](auto f) { for_each_index<T::SIZE>([&](auto i) { f(vc[i]); }); });
+}
+
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+constexpr bool is_trivial(const T& vc)
+{
+	return !any_of_index<T::SIZE>([&](auto i) { return vc[i] != 0; });
+}
+
+template <class T, class F, typename std::enable_if_t<has_static_size<T>, int> = 0>
 constexpr std::optional<T> unit_vector(const T& vc, F func)
 {
 	if (is_trivial(vc))
@@ -78,6 +218,16 @@ constexpr std::optional<T> unit_vector(const T& vc, F func)
 	return vc * (1 / magnitude(vc, func));
 }
 
+// Scaled by 1 / magnitude(vc), no value if vc is trivial
+template <class T, typename std::enable_if_t<has_static_size<T>, int> = 0>
+std::optional<T> unit_vector(const T& vc)
+{
+	if (is_trivial(vc))
+		return {};
+
+	return vc * (1 / magnitude(vc));
+}
+
 }
 
 #endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_FUNCTIONS_HPP_INCLUDED
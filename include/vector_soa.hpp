@@ -0,0 +1,276 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_SOA_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_SOA_HPP_INCLUDED
+
+#include "aligned_allocator.hpp"
+#include "simd.hpp"
+#include <array>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace MathVector {
+
+// Structure of arrays batch of vectors, every component is kept in its own lane.
+// V may be Vector2, Vector3 or Vector, anything with SIZE, scalar & operator[].
+template <class V, class Alloc = AlignedAllocator<typename V::scalar>>
+class VectorSoA {
+public:
+	using value_type = V;
+	using scalar = typename V::scalar;
+	using allocator_type = Alloc;
+	using lane_type = std::vector<scalar, Alloc>;
+
+	static constexpr std::size_t SIZE = V::SIZE;
+
+	// Proxy for a single element spread across the lanes.
+	class reference {
+	public:
+		constexpr reference(VectorSoA& soa, std::size_t i) noexcept : soa(soa), index(i) {}
+
+		V get() const
+		{
+			V vc;
+			for (auto k = 0U; k < SIZE; k++)
+				vc[k] = soa.lanes[k][index];
+			return vc;
+		}
+
+		operator V() const
+		{
+			return get();
+		}
+
+		reference& operator=(const V& vc)
+		{
+			for (auto k = 0U; k < SIZE; k++)
+				soa.lanes[k][index] = vc[k];
+			return *this;
+		}
+
+		reference& operator=(const reference& other)
+		{
+			return *this = other.get();
+		}
+
+		reference& operator+=(const V& vc)
+		{
+			for (auto k = 0U; k < SIZE; k++)
+				soa.lanes[k][index] += vc[k];
+			return *this;
+		}
+
+		reference& operator-=(const V& vc)
+		{
+			for (auto k = 0U; k < SIZE; k++)
+				soa.lanes[k][index] -= vc[k];
+			return *this;
+		}
+
+		reference& operator*=(const scalar& rhs)
+		{
+			for (auto k = 0U; k < SIZE; k++)
+				soa.lanes[k][index] *= rhs;
+			return *this;
+		}
+
+		scalar& operator[](std::size_t k) const
+		{
+			assert(k < SIZE);
+			return soa.lanes[k][index];
+		}
+
+	private:
+		VectorSoA& soa;
+		std::size_t index;
+	};
+
+	VectorSoA() : VectorSoA(0) {}
+
+	explicit VectorSoA(std::size_t count, const Alloc& alloc = Alloc())
+		: lanes(make_lanes(alloc, std::make_index_sequence<SIZE>()))
+	{
+		resize(count);
+	}
+
+	template <class It>
+	VectorSoA(It first, It last, const Alloc& alloc = Alloc())
+		: VectorSoA(0, alloc)
+	{
+		for (; first != last; ++first)
+			push_back(*first);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return lanes[0].size();
+	}
+
+	bool empty() const noexcept
+	{
+		return lanes[0].empty();
+	}
+
+	void resize(std::size_t count)
+	{
+		for (auto& lane : lanes)
+			lane.resize(count);
+	}
+
+	void reserve(std::size_t count)
+	{
+		for (auto& lane : lanes)
+			lane.reserve(count);
+	}
+
+	void clear() noexcept
+	{
+		for (auto& lane : lanes)
+			lane.clear();
+	}
+
+	void push_back(const V& vc)
+	{
+		for (auto k = 0U; k < SIZE; k++)
+			lanes[k].push_back(vc[k]);
+	}
+
+	reference operator[](std::size_t i)
+	{
+		assert(i < size());
+		return reference(*this, i);
+	}
+
+	V operator[](std::size_t i) const
+	{
+		assert(i < size());
+		V vc;
+		for (auto k = 0U; k < SIZE; k++)
+			vc[k] = lanes[k][i];
+		return vc;
+	}
+
+	scalar* lane(std::size_t k) noexcept
+	{
+		assert(k < SIZE);
+		return lanes[k].data();
+	}
+
+	const scalar* lane(std::size_t k) const noexcept
+	{
+		assert(k < SIZE);
+		return lanes[k].data();
+	}
+
+private:
+	template <std::size_t... I>
+	static std::array<lane_type, SIZE> make_lanes(const Alloc& alloc, std::index_sequence<I...>)
+	{
+		return {{((void)I, lane_type(alloc))...}};
+	}
+
+	std::array<lane_type, SIZE> lanes;
+};
+
+// lhs[i] += rhs[i] for every element
+template <class V, class A>
+void batch_add(VectorSoA<V, A>& lhs, const VectorSoA<V, A>& rhs)
+{
+	using T = typename V::scalar;
+	assert(lhs.size() == rhs.size());
+	for (auto k = 0U; k < V::SIZE; k++) {
+		T* dst = lhs.lane(k);
+		const T* src = rhs.lane(k);
+		simd::for_each_pack<T>(lhs.size(), [&](auto p, std::size_t i) {
+			using P = decltype(p);
+			P::store(dst + i, P::add(P::load(dst + i), P::load(src + i)));
+		});
+	}
+}
+
+// lhs[i] -= rhs[i] for every element
+template <class V, class A>
+void batch_sub(VectorSoA<V, A>& lhs, const VectorSoA<V, A>& rhs)
+{
+	using T = typename V::scalar;
+	assert(lhs.size() == rhs.size());
+	for (auto k = 0U; k < V::SIZE; k++) {
+		T* dst = lhs.lane(k);
+		const T* src = rhs.lane(k);
+		simd::for_each_pack<T>(lhs.size(), [&](auto p, std::size_t i) {
+			using P = decltype(p);
+			P::store(dst + i, P::sub(P::load(dst + i), P::load(src + i)));
+		});
+	}
+}
+
+// vc[i] *= rhs for every element
+template <class V, class A>
+void batch_scale(VectorSoA<V, A>& vc, const typename V::scalar& rhs)
+{
+	using T = typename V::scalar;
+	for (auto k = 0U; k < V::SIZE; k++) {
+		T* dst = vc.lane(k);
+		simd::for_each_pack<T>(vc.size(), [&](auto p, std::size_t i) {
+			using P = decltype(p);
+			P::store(dst + i, P::mul(P::load(dst + i), P::set1(rhs)));
+		});
+	}
+}
+
+// out[i] = dot_product(lhs[i], rhs[i]), out must hold lhs.size() scalars
+template <class V, class A>
+void batch_dot(const VectorSoA<V, A>& lhs, const VectorSoA<V, A>& rhs, typename V::scalar* out)
+{
+	using T = typename V::scalar;
+	assert(lhs.size() == rhs.size());
+	simd::for_each_pack<T>(lhs.size(), [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto acc = P::zero();
+		for (auto k = 0U; k < V::SIZE; k++)
+			acc = P::add(acc, P::mul(P::load(lhs.lane(k) + i), P::load(rhs.lane(k) + i)));
+		P::store(out + i, acc);
+	});
+}
+
+// out[i] = |vc[i]|, computed as the square root of the dot product rather than hypot
+template <class V, class A>
+void batch_magnitude(const VectorSoA<V, A>& vc, typename V::scalar* out)
+{
+	using T = typename V::scalar;
+	simd::for_each_pack<T>(vc.size(), [&](auto p, std::size_t i) {
+		using P = decltype(p);
+		auto acc = P::zero();
+		for (auto k = 0U; k < V::SIZE; k++) {
+			auto c = P::load(vc.lane(k) + i);
+			acc = P::add(acc, P::mul(c, c));
+		}
+		P::store(out + i, P::sqrt(acc));
+	});
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_SOA_HPP_INCLUDED
@@ -0,0 +1,232 @@
+/*
+MIT License
+
+Copyright (c) 2020 Josiah Baldwin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_TEXT_HPP_INCLUDED
+#define MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_TEXT_HPP_INCLUDED
+
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace MathVector {
+
+struct TextOptions {
+	// Lines starting with this character are skipped, as are blank lines
+	char comment = '#';
+	// Text handed to each parallel task
+	std::size_t chunk_bytes = 1 << 20;
+	// Text read from a file at a time
+	std::size_t read_bytes = 64 << 20;
+	// Errors kept in the result, the rest are only counted
+	std::size_t max_errors = 1000;
+};
+
+// Row & column count from 1, row is the line in the input, column the field in that line.
+struct TextError {
+	std::size_t row;
+	std::size_t column;
+	const char* message;
+};
+
+template <class Container>
+struct TextResult {
+	Container vectors;
+	std::vector<TextError> errors;
+	std::size_t error_count = 0;
+	std::size_t rows = 0;
+};
+
+namespace detail {
+
+template <class V>
+struct TextChunk {
+	std::vector<V> vectors;
+	std::vector<TextError> errors;
+	std::size_t error_count = 0;
+	std::size_t rows = 0;
+};
+
+constexpr bool is_text_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parses one line into vc, returning nullptr or the error with its column filled in
+template <class V>
+const char* parse_text_line(const char* p, const char* end, V& vc, std::size_t& column)
+{
+	using T = typename V::scalar;
+	for (column = 1; ; column++) {
+		while (p != end && is_text_space(*p))
+			p++;
+		if (column > V::SIZE)
+			return "too many fields";
+		if (p == end || *p == ',')
+			return "missing field";
+
+		// from_chars doesn't take a leading '+', one is skipped unless a sign follows it
+		if (*p == '+' && (p + 1 == end || p[1] != '-'))
+			p++;
+		T value;
+		auto [next, error] = std::from_chars(p, end, value);
+		if (error == std::errc::result_out_of_range)
+			return "number out of range";
+		if (error != std::errc() || (next != end && !is_text_space(*next) && *next != ','))
+			return "not a number";
+		vc[column - 1] = value;
+
+		p = next;
+		while (p != end && is_text_space(*p))
+			p++;
+		if (p != end && *p == ',' && ++p == end)
+			return column < V::SIZE ? "missing field" : "trailing comma";
+		if (p == end && column == V::SIZE)
+			return nullptr;
+	}
+}
+
+template <class V>
+void parse_text_chunk(const char* p, const char* end, const TextOptions& options, TextChunk<V>& chunk)
+{
+	while (p != end) {
+		const char* line_end = std::find(p, end, '\n');
+		chunk.rows++;
+
+		const char* first = p;
+		while (first != line_end && is_text_space(*first))
+			first++;
+		if (first != line_end && *first != options.comment) {
+			V vc;
+			std::size_t column;
+			if (const char* message = parse_text_line(first, line_end, vc, column)) {
+				if (chunk.errors.size() < options.max_errors)
+					chunk.errors.push_back({chunk.rows, column, message});
+				chunk.error_count++;
+			}
+			else {
+				chunk.vectors.push_back(vc);
+			}
+		}
+		p = line_end == end ? end : line_end + 1;
+	}
+}
+
+// Parses whole lines in parallel & appends them to result, rows are numbered after result.rows
+template <class V, class Container>
+void parse_text(std::string_view text, const TextOptions& options, ThreadPool& pool, TextResult<Container>& result)
+{
+	// Cut at the first line break after every chunk_bytes
+	std::vector<const char*> cuts{text.data()};
+	const char* end = text.data() + text.size();
+	std::size_t chunk_bytes = std::max<std::size_t>(options.chunk_bytes, 1);
+	while (static_cast<std::size_t>(end - cuts.back()) > chunk_bytes) {
+		const char* cut = std::find(cuts.back() + chunk_bytes, end, '\n');
+		if (cut == end)
+			break;
+		cuts.push_back(cut + 1);
+	}
+	cuts.push_back(end);
+
+	std::vector<TextChunk<V>> chunks(cuts.size() - 1);
+	pool.parallel_for(chunks.size(), [&](std::size_t i) {
+		parse_text_chunk(cuts[i], cuts[i + 1], options, chunks[i]);
+	});
+
+	std::size_t total = 0;
+	for (auto& chunk : chunks)
+		total += chunk.vectors.size();
+	result.vectors.reserve(result.vectors.size() + total);
+	for (auto& chunk : chunks) {
+		for (auto& vc : chunk.vectors)
+			result.vectors.push_back(vc);
+		for (auto& error : chunk.errors) {
+			if (result.errors.size() < options.max_errors)
+				result.errors.push_back({result.rows + error.row, error.column, error.message});
+		}
+		result.error_count += chunk.error_count;
+		result.rows += chunk.rows;
+	}
+}
+
+}
+
+// Parses one vector per line, fields separated by whitespace or commas.
+// Lines with errors are skipped & reported, the rest are still parsed.
+template <class V, class Container = std::vector<V>>
+TextResult<Container> parse_vectors(std::string_view text, const TextOptions& options = TextOptions(), ThreadPool& pool = default_pool())
+{
+	TextResult<Container> result;
+	detail::parse_text<V>(text, options, pool, result);
+	return result;
+}
+
+// Reads a file read_bytes at a time, parsing the complete lines of each read in parallel
+template <class V, class Container = std::vector<V>>
+TextResult<Container> read_vectors(const std::string& path, const TextOptions& options = TextOptions(), ThreadPool& pool = default_pool())
+{
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		throw std::system_error(errno, std::generic_category(), "opening " + path);
+
+	TextResult<Container> result;
+	std::string buffer;
+	std::size_t read_bytes = std::max<std::size_t>(options.read_bytes, 1);
+	std::size_t kept = 0;
+	try {
+		for (;;) {
+			buffer.resize(kept + read_bytes);
+			std::size_t got = std::fread(buffer.data() + kept, 1, read_bytes, file);
+			if (got < read_bytes && std::ferror(file))
+				throw std::system_error(errno, std::generic_category(), "reading " + path);
+			std::size_t length = kept + got;
+			if (got == 0) {
+				detail::parse_text<V>(std::string_view(buffer.data(), length), options, pool, result);
+				break;
+			}
+
+			// A partial last line waits for the next read
+			std::string_view text(buffer.data(), length);
+			std::size_t last_break = text.rfind('\n');
+			std::size_t complete = last_break == std::string_view::npos ? 0 : last_break + 1;
+			detail::parse_text<V>(text.substr(0, complete), options, pool, result);
+			kept = length - complete;
+			buffer.erase(0, complete);
+		}
+	}
+	catch (...) {
+		std::fclose(file);
+		throw;
+	}
+	std::fclose(file);
+	return result;
+}
+
+}
+
+#endif // MATHVECTOR_INCLUDE_MISTEREGGNOG_VECTOR_TEXT_HPP_INCLUDED
@@ -25,10 +25,36 @@ SOFTWARE.
 #include "include/vector3.hpp"
 #include "include/vector_array.hpp"
 #include "include/vector_functions.hpp"
+#include "include/vector_soa.hpp"
+#include "include/vector_expression.hpp"
+#include "include/dot_product_matrix.hpp"
+#include "include/normalize.hpp"
+#include "include/reduction.hpp"
+#include "include/arena_allocator.hpp"
+#include "include/vector_file.hpp"
+#include "include/vector_text.hpp"
+#include "include/kd_tree.hpp"
+#include "include/spatial_hash.hpp"
+#include "include/distance_matrix.hpp"
+#include "include/quantized.hpp"
+#include "include/matrix.hpp"
+#include "include/quaternion.hpp"
+#include "include/mesh.hpp"
+#include "include/integrate.hpp"
+#include "include/barnes_hut.hpp"
+#include "include/dynamic_vector.hpp"
+#include "include/sparse_vector.hpp"
+#include "include/hnsw.hpp"
+#include "include/accumulate.hpp"
+#include "include/magnitude.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <cmath>
 #include <limits>
 #include <random>
+#include <thread>
+#include <vector>
 
 typedef bool(*testfun)();
 
@@ -695,7 +721,1843 @@ bool trivial()
 	return is_trivial(triv) && !is_trivial(nontriv);
 }
 
-#define TEST_NUMBER 28
+/////////////////////////////////////////////////////////////////////
+// Runtime dispatched SIMD
+/////////////////////////////////////////////////////////////////////
+
+// Every isa the cpu supports against the scalar reference kernels
+template <class T>
+bool simd_isa_matches()
+{
+	using namespace MathVector::simd;
+	const Isa isas[] = {Isa::sse2, Isa::avx2, Isa::avx512};
+	const std::size_t lengths[] = {1, 7, 16, 33, 64, 101};
+	auto reference = kernel_table<T>(Isa::scalar);
+
+	for (auto isa : isas) {
+		if (!supported(isa))
+			continue;
+		auto table = kernel_table<T>(isa);
+		for (auto n : lengths) {
+			std::vector<T> a(n), b(n), expected, actual;
+			for (auto i = 0U; i < n; i++) {
+				a[i] = static_cast<T>(float_number_range(random_eng));
+				b[i] = static_cast<T>(float_number_range(random_eng));
+			}
+
+			expected = actual = a;
+			reference.add(expected.data(), b.data(), n);
+			table.add(actual.data(), b.data(), n);
+			if (expected != actual)
+				return false;
+
+			reference.sub(expected.data(), b.data(), n);
+			table.sub(actual.data(), b.data(), n);
+			if (expected != actual)
+				return false;
+
+			reference.scale(expected.data(), T(3), n);
+			table.scale(actual.data(), T(3), n);
+			if (expected != actual)
+				return false;
+
+			T tolerance = static_cast<T>(n) * std::numeric_limits<T>::epsilon() * 1600;
+			if (std::fabs(reference.dot(a.data(), b.data(), n) - table.dot(a.data(), b.data(), n)) > tolerance)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool simd_kernels()
+{
+	return simd_isa_matches<float>() && simd_isa_matches<double>();
+}
+
+bool simd_vector()
+{
+	MathVector::Vector<double, 37> vc1, vc2;
+	double expected_dot = 0;
+	for (auto i = 0U; i < vc1.size(); i++) {
+		vc1[i] = float_number_range(random_eng);
+		vc2[i] = float_number_range(random_eng);
+		expected_dot += vc1[i] * vc2[i];
+	}
+
+	auto sum = vc1 + vc2;
+	auto diff = vc1 - vc2;
+	auto scaled = vc1 * 0.5;
+	for (auto i = 0U; i < vc1.size(); i++)
+		if (sum[i] != vc1[i] + vc2[i] || diff[i] != vc1[i] - vc2[i] || scaled[i] != vc1[i] * 0.5)
+			return false;
+	return std::fabs(MathVector::dot_product(vc1, vc2) - expected_dot) < 1e-9;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Threads & batched dot products
+/////////////////////////////////////////////////////////////////////
+
+bool thread_pool()
+{
+	MathVector::ThreadPool pool(4);
+	std::vector<int> hits(1000);
+	pool.parallel_for(hits.size(), [&](std::size_t i) {
+		hits[i]++;
+		// nested loops run serially on the calling thread
+		pool.parallel_for(2, [&](std::size_t) {});
+	});
+
+	bool rethrown = false;
+	try {
+		pool.parallel_for(100, [](std::size_t i) {
+			if (i == 42)
+				throw i;
+		});
+	}
+	catch (std::size_t) {
+		rethrown = true;
+	}
+
+	for (auto hit : hits)
+		if (hit != 1)
+			return false;
+	return rethrown;
+}
+
+bool dot_matrix()
+{
+	typedef MathVector::Vector<float, 19> vecf19;
+	std::vector<vecf19> queries(13), corpus(150);
+	for (auto vcs : {&queries, &corpus})
+		for (auto& vc : *vcs)
+			for (auto& x : vc)
+				x = static_cast<float>(float_number_range(random_eng));
+
+	MathVector::ThreadPool pool(3);
+	auto dots = MathVector::dot_product_matrix(queries, corpus, pool);
+	for (auto i = 0U; i < queries.size(); i++)
+		for (auto j = 0U; j < corpus.size(); j++)
+			if (std::fabs(dots[i * corpus.size() + j] - MathVector::dot_product(queries[i], corpus[j])) > 1e-2f)
+				return false;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Batch normalization
+/////////////////////////////////////////////////////////////////////
+
+bool normalize_aos()
+{
+	Magn magn;
+	auto fallback = MathVector::Vector3(0.0, 0.0, 1.0);
+	std::vector<MathVector::Vector3<double>> vcs(100);
+	for (auto& vc : vcs)
+		vc = MathVector::Vector3(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+	vcs[17] = MathVector::Vector3(0.0, 0.0, 0.0);
+	auto original = vcs;
+
+	MathVector::normalize_batch(vcs, fallback);
+	for (auto i = 0U; i < vcs.size(); i++) {
+		auto expected = unit_vector(original[i], magn).value_or(fallback);
+		auto diff = vcs[i] - expected;
+		if (MathVector::dot_product(diff, diff) > 1e-24)
+			return false;
+	}
+	return true;
+}
+
+bool normalize_soa()
+{
+	auto fallback = MathVector::Vector3(1.0f, 0.0f, 0.0f);
+	std::vector<MathVector::Vector3<float>> aos(37);
+	for (auto& vc : aos)
+		vc = MathVector::Vector3<float>(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+	aos[0] = aos[20] = MathVector::Vector3(0.0f, 0.0f, 0.0f);
+
+	MathVector::VectorSoA<MathVector::Vector3<float>> soa(aos.begin(), aos.end());
+	MathVector::normalize_batch<MathVector::FastNormalization>(soa, fallback);
+	for (auto i = 0U; i < aos.size(); i++) {
+		MathVector::Vector3<float> vc = soa[i];
+		if (MathVector::is_trivial(aos[i])) {
+			if (vc != fallback)
+				return false;
+			continue;
+		}
+		auto expected = aos[i] * (1 / std::sqrt(MathVector::dot_product(aos[i], aos[i])));
+		auto diff = vc - expected;
+		if (MathVector::dot_product(diff, diff) > 1e-10f)
+			return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Reductions
+/////////////////////////////////////////////////////////////////////
+
+bool reduce_summary()
+{
+	// Several blocks plus a partial one
+	std::vector<MathVector::Vector3<float>> points(3 * MathVector::detail::reduction_block<MathVector::Vector3<float>> + 11);
+	for (auto& vc : points)
+		vc = MathVector::Vector3<float>(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+
+	MathVector::Vector3<double> sum(0, 0, 0);
+	auto lo = points[0], hi = points[0];
+	float max_sq = 0;
+	for (auto& vc : points) {
+		sum += MathVector::Vector3<double>(vc.x, vc.y, vc.z);
+		lo = MathVector::Vector3(std::min(lo.x, vc.x), std::min(lo.y, vc.y), std::min(lo.z, vc.z));
+		hi = MathVector::Vector3(std::max(hi.x, vc.x), std::max(hi.y, vc.y), std::max(hi.z, vc.z));
+		max_sq = std::max(max_sq, MathVector::dot_product(vc, vc));
+	}
+
+	auto summary = MathVector::summarize(points);
+	auto centroid = summary.centroid();
+	for (auto k = 0U; k < 3; k++)
+		if (std::fabs(centroid[k] - sum[k] / points.size()) > 1e-3)
+			return false;
+	return summary.count == points.size()
+		&& summary.min == lo && summary.max == hi
+		&& summary.max_magnitude() == std::sqrt(max_sq);
+}
+
+bool reduce_determinism()
+{
+	std::vector<MathVector::Vector<float, 5>> vcs(20000);
+	for (auto& vc : vcs)
+		for (auto& x : vc)
+			x = static_cast<float>(float_number_range(random_eng));
+
+	MathVector::ThreadPool one(1), several(4);
+	auto a = MathVector::summarize(vcs, one);
+	auto b = MathVector::summarize(vcs, several);
+	return a.sum == b.sum && a.min == b.min && a.max == b.max
+		&& a.min_squared_magnitude == b.min_squared_magnitude
+		&& a.max_squared_magnitude == b.max_squared_magnitude;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Arena allocator
+/////////////////////////////////////////////////////////////////////
+
+bool arena_frames()
+{
+	MathVector::Arena arena(4096);
+	MathVector::ArenaAllocator<MathVector::Vector3<double>> alloc(arena);
+	std::size_t after_first = 0;
+
+	for (int frame = 0; frame < 4; frame++) {
+		{
+			// Larger than the first block, so the first frame has to grow the arena
+			MathVector::ArenaVector<MathVector::Vector3<double>> vcs(alloc);
+			vcs.reserve(1000);
+			for (int i = 0; i < 1000; i++)
+				vcs.emplace_back(i, i, i);
+			MathVector::ArenaVector<MathVector::Vector3<double>> copy(vcs, alloc);
+			if (reinterpret_cast<std::uintptr_t>(vcs.data()) % 64 != 0 || copy[999].z != 999)
+				return false;
+		}
+		arena.reset();
+		if (frame == 0)
+			after_first = arena.heap_allocations();
+	}
+	return after_first == arena.heap_allocations();
+}
+
+bool arena_soa()
+{
+	MathVector::Arena arena;
+	typedef MathVector::ArenaAllocator<float> alloc_type;
+	MathVector::VectorSoA<MathVector::Vector3<float>, alloc_type> soa(100, alloc_type(arena));
+	soa[10] = MathVector::Vector3(1.0f, 2.0f, 3.0f);
+	MathVector::batch_scale(soa, 2.0f);
+
+	MathVector::ArenaVector<MathVector::Vector<int, 4>> default_arena;
+	default_arena.push_back(vec4{1, 2, 3, 4});
+	return soa[10].get() == MathVector::Vector3(2.0f, 4.0f, 6.0f)
+		&& reinterpret_cast<std::uintptr_t>(soa.lane(1)) % 64 == 0
+		&& &default_arena.get_allocator().arena() == &MathVector::thread_arena();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Vector files
+/////////////////////////////////////////////////////////////////////
+
+bool file_aos()
+{
+	const char* path = "test_aos.mvec";
+	std::vector<MathVector::Vector3<float>> vcs;
+	for (int i = 0; i < 1000; i++)
+		vcs.emplace_back(i, -i, 0.5f * i);
+	{
+		MathVector::VectorFileWriter<MathVector::Vector3<float>> writer(path);
+		writer.write(MathVector::Span<const MathVector::Vector3<float>>(vcs).subspan(0, 400));
+		writer.write(MathVector::Span<const MathVector::Vector3<float>>(vcs).subspan(400, 600));
+		writer.close();
+	}
+
+	bool equal = false, wrong_type = false;
+	{
+		MathVector::MappedVectorFile file(path);
+		auto view = file.vectors<MathVector::Vector3<float>>();
+		equal = view.size() == vcs.size()
+			&& reinterpret_cast<std::uintptr_t>(view.data()) % 64 == 0
+			&& std::equal(view.begin(), view.end(), vcs.begin());
+		try {
+			file.vectors<MathVector::Vector3<double>>();
+		}
+		catch (const std::runtime_error&) {
+			wrong_type = true;
+		}
+	}
+	std::remove(path);
+	return equal && wrong_type;
+}
+
+bool file_soa()
+{
+	const char* path = "test_soa.mvec";
+	MathVector::VectorSoA<MathVector::Vector<double, 4>> soa;
+	for (int i = 0; i < 37; i++)
+		soa.push_back(MathVector::Vector<double, 4>{1.0 * i, 2.0 * i, 3.0 * i, 4.0 * i});
+	MathVector::write_vector_file(path, soa);
+
+	bool equal = true;
+	{
+		MathVector::MappedVectorFile file(path);
+		equal = file.size() == soa.size() && file.header().layout == MathVector::VectorLayout::soa;
+		for (auto k = 0U; k < 4 && equal; k++) {
+			auto lane = file.lane<double>(k);
+			equal = reinterpret_cast<std::uintptr_t>(lane.data()) % 64 == 0
+				&& std::equal(lane.begin(), lane.end(), soa.lane(k));
+		}
+	}
+	std::remove(path);
+	return equal;
+}
+
+std::vector<char> read_file_bytes(const char* path)
+{
+	std::vector<char> bytes;
+	std::FILE* file = std::fopen(path, "rb");
+	for (int c; (c = std::fgetc(file)) != EOF;)
+		bytes.push_back(static_cast<char>(c));
+	std::fclose(file);
+	return bytes;
+}
+
+// Writes a copy of bytes with its Header edited by patch & only the first size bytes kept,
+// true if opening it with open throws
+template <class Header, class Patch, class Open>
+bool file_rejected(const std::vector<char>& bytes, std::size_t size, Patch patch, Open open)
+{
+	const char* path = "test_corrupt.bin";
+	std::vector<char> copy(bytes.begin(), bytes.begin() + size);
+	Header header;
+	std::memcpy(&header, copy.data(), sizeof(header));
+	patch(header);
+	std::memcpy(copy.data(), &header, sizeof(header));
+	std::FILE* file = std::fopen(path, "wb");
+	std::fwrite(copy.data(), 1, copy.size(), file);
+	std::fclose(file);
+
+	bool rejected = false;
+	try {
+		open(path);
+	}
+	catch (const std::runtime_error&) {
+		rejected = true;
+	}
+	std::remove(path);
+	return rejected;
+}
+
+template <class Patch>
+bool vector_file_rejected(const std::vector<char>& bytes, std::size_t size, Patch patch)
+{
+	return file_rejected<MathVector::VectorFileHeader>(bytes, size, patch, [](const char* path) {
+		MathVector::MappedVectorFile mapped(path);
+	});
+}
+
+bool file_corrupt()
+{
+	const char* path = "test_valid.mvec";
+	std::vector<MathVector::Vector3<double>> vcs(100, MathVector::Vector3<double>(1.0, 2.0, 3.0));
+	{
+		MathVector::VectorFileWriter<MathVector::Vector3<double>> writer(path);
+		writer.write(MathVector::Span<const MathVector::Vector3<double>>(vcs));
+	}
+	auto bytes = read_file_bytes(path);
+	std::remove(path);
+
+	using MathVector::VectorFileHeader;
+	auto unchanged = [](VectorFileHeader&) {};
+	return !vector_file_rejected(bytes, bytes.size(), unchanged)
+		&& vector_file_rejected(bytes, bytes.size() - 1, unchanged)
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.scalar_size = 1; h.count = 800; })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.scalar_size = 0; })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.layout = static_cast<MathVector::VectorLayout>(7); })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.count = std::uint64_t(1) << 62; })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.count = std::uint64_t(1) << 60; h.dimension = 32; })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) { h.payload_offset = UINT64_MAX - 63; })
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) {
+			h.layout = MathVector::VectorLayout::soa;
+			h.count = 1;
+			h.lane_stride = std::uint64_t(1) << 63;
+		})
+		&& vector_file_rejected(bytes, bytes.size(), [](VectorFileHeader& h) {
+			h.layout = MathVector::VectorLayout::soa;
+			h.count = 1;
+			h.lane_stride = 9;
+		});
+}
+
+/////////////////////////////////////////////////////////////////////
+// Text parsing
+/////////////////////////////////////////////////////////////////////
+
+bool text_errors()
+{
+	const char* text =
+		"# x y z\n"
+		"1 2 3\n"
+		"4,5,6\r\n"
+		"\n"
+		"  7 ,\t8, +9\n"
+		"1 2\n"
+		"1 2 3 4\n"
+		"1 x 3\n"
+		"1,,3\n"
+		"1e999 0 0\n"
+		"1 +-5 3\n"
+		"-1.5 2.5e1 .5";
+	auto result = MathVector::parse_vectors<MathVector::Vector3<double>>(text);
+	using MathVector::Vector3;
+	auto error_at = [&](std::size_t i, std::size_t row, std::size_t column) {
+		return result.errors[i].row == row && result.errors[i].column == column;
+	};
+	return result.vectors == std::vector{Vector3(1.0, 2.0, 3.0), Vector3(4.0, 5.0, 6.0), Vector3(7.0, 8.0, 9.0), Vector3(-1.5, 25.0, 0.5)}
+		&& result.rows == 12 && result.error_count == 6 && result.errors.size() == 6
+		&& error_at(0, 6, 3) && error_at(1, 7, 4) && error_at(2, 8, 2) && error_at(3, 9, 2) && error_at(4, 10, 1)
+		&& error_at(5, 11, 2);
+}
+
+bool text_chunks()
+{
+	const char* path = "test_text.txt";
+	std::vector<vec4> vcs;
+	std::string text;
+	for (int i = 0; i < 2000; i++) {
+		vcs.push_back(vec4{i, -i, i * 2, i % 7});
+		text += std::to_string(i) + "," + std::to_string(-i) + "," + std::to_string(i * 2) + "," + std::to_string(i % 7);
+		text += i == 1000 ? " 5\n" : "\n";
+	}
+	text.pop_back();
+	std::FILE* file = std::fopen(path, "wb");
+	std::fwrite(text.data(), 1, text.size(), file);
+	std::fclose(file);
+
+	// Small reads & chunks so lines straddle both
+	MathVector::TextOptions options;
+	options.chunk_bytes = 100;
+	options.read_bytes = 333;
+	MathVector::ThreadPool pool(3);
+	auto result = MathVector::read_vectors<vec4, MathVector::VectorSoA<vec4>>(path, options, pool);
+	std::remove(path);
+	vcs.erase(vcs.begin() + 1000);
+
+	bool equal = result.vectors.size() == vcs.size() && result.rows == 2000
+		&& result.error_count == 1 && result.errors[0].row == 1001 && result.errors[0].column == 5;
+	for (auto i = 0U; i < vcs.size() && equal; i++)
+		equal = result.vectors[i].get() == vcs[i];
+	return equal;
+}
+
+/////////////////////////////////////////////////////////////////////
+// k-d tree
+/////////////////////////////////////////////////////////////////////
+
+template <class V>
+std::vector<MathVector::Neighbor<typename V::scalar>> brute_neighbors(const std::vector<V>& points, const V& query)
+{
+	std::vector<MathVector::Neighbor<typename V::scalar>> all;
+	for (auto i = 0U; i < points.size(); i++)
+		all.push_back({i, MathVector::dot_product(points[i] - query, points[i] - query)});
+	std::stable_sort(all.begin(), all.end(), [](auto& a, auto& b) {
+		return a.squared_distance < b.squared_distance;
+	});
+	return all;
+}
+
+bool kd_nearest()
+{
+	std::uniform_real_distribution<double> range(-100.0, 100.0);
+	std::vector<MathVector::Vector3<double>> points(3000), queries(100);
+	for (auto& vc : points)
+		vc = MathVector::Vector3(range(random_eng), range(random_eng), range(random_eng));
+	for (auto& vc : queries)
+		vc = MathVector::Vector3(range(random_eng), range(random_eng), range(random_eng));
+	// Duplicates & a point on a query
+	points[10] = points[20];
+	queries[0] = points[30];
+
+	MathVector::ThreadPool pool(4);
+	MathVector::KdTree<MathVector::Vector3<double>> tree(points, 8, pool);
+	auto batch = tree.batch_nearest(queries, 5, pool);
+	for (auto q = 0U; q < queries.size(); q++) {
+		auto expected = brute_neighbors(points, queries[q]);
+		auto found = tree.nearest(queries[q], 5);
+		for (auto i = 0U; i < 5; i++) {
+			if (found[i].squared_distance != expected[i].squared_distance
+				|| batch[q * 5 + i].squared_distance != expected[i].squared_distance
+				|| points[found[i].index] != points[expected[i].index])
+				return false;
+		}
+	}
+
+	MathVector::KdTree<MathVector::Vector2<float>> small(std::vector{MathVector::Vector2(1.0f, 1.0f)});
+	MathVector::KdTree<MathVector::Vector2<float>> empty(std::vector<MathVector::Vector2<float>>{});
+	return queries[0] == points[tree.nearest(queries[0], 1)[0].index]
+		&& small.nearest(MathVector::Vector2(0.0f, 0.0f), 3).size() == 1
+		&& empty.nearest(MathVector::Vector2(0.0f, 0.0f), 3).empty();
+}
+
+bool kd_radius()
+{
+	std::uniform_real_distribution<float> range(-10.0f, 10.0f);
+	std::vector<MathVector::Vector<float, 4>> points(2000), queries(50);
+	for (auto& vc : points)
+		for (auto& x : vc)
+			x = range(random_eng);
+	for (auto& vc : queries)
+		for (auto& x : vc)
+			x = range(random_eng);
+
+	MathVector::KdTree<MathVector::Vector<float, 4>> tree(points, 4);
+	auto batch = tree.batch_within(queries, 5.0f);
+	for (auto q = 0U; q < queries.size(); q++) {
+		auto expected = brute_neighbors(points, queries[q]);
+		std::size_t count = 0;
+		while (count < expected.size() && expected[count].squared_distance <= 25.0f)
+			count++;
+		auto found = tree.within(queries[q], 5.0f);
+		if (found.size() != count || batch[q].size() != count)
+			return false;
+		for (auto i = 0U; i < count; i++)
+			if (found[i].squared_distance != expected[i].squared_distance)
+				return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Spatial hash
+/////////////////////////////////////////////////////////////////////
+
+bool hash_pairs()
+{
+	std::uniform_real_distribution<float> range(-20.0f, 20.0f);
+	std::vector<MathVector::Vector3<float>> points(1500);
+	for (auto& vc : points)
+		vc = MathVector::Vector3(range(random_eng), range(random_eng), range(random_eng));
+	points[5] = points[6];
+
+	std::vector<std::pair<std::size_t, std::size_t>> expected;
+	for (auto i = 0U; i < points.size(); i++)
+		for (auto j = i + 1; j < points.size(); j++)
+			if (MathVector::dot_product(points[i] - points[j], points[i] - points[j]) <= 1.5f * 1.5f)
+				expected.emplace_back(i, j);
+
+	MathVector::ThreadPool pool(3);
+	MathVector::SpatialHash<MathVector::Vector3<float>> grid(1.5f);
+	grid.build(points, pool);
+	auto found = grid.pairs(pool);
+	std::size_t serial = 0;
+	grid.for_each_pair([&](std::size_t, std::size_t, float) {
+		serial++;
+	});
+
+	// Rebuilding reuses the grid & gives the same pairs in the same order
+	MathVector::ThreadPool single(1);
+	grid.build(points, single);
+	bool same_order = grid.pairs(single) == found;
+	std::sort(found.begin(), found.end());
+	return found == expected && same_order && serial == expected.size();
+}
+
+bool hash_neighbors()
+{
+	std::uniform_real_distribution<double> range(-5.0, 5.0);
+	std::vector<MathVector::Vector2<double>> points(800);
+	for (auto& vc : points)
+		vc = MathVector::Vector2(range(random_eng), range(random_eng));
+
+	MathVector::SpatialHash<MathVector::Vector2<double>> grid(0.75);
+	grid.build(points);
+	for (int q = 0; q < 50; q++) {
+		MathVector::Vector2 query(range(random_eng), range(random_eng));
+		std::vector<std::size_t> expected, found;
+		for (auto i = 0U; i < points.size(); i++)
+			if (MathVector::dot_product(points[i] - query, points[i] - query) <= 0.75 * 0.75)
+				expected.push_back(i);
+		grid.for_each_neighbor(query, [&](std::size_t i, double) {
+			found.push_back(i);
+		});
+		std::sort(found.begin(), found.end());
+		if (found != expected)
+			return false;
+	}
+	grid.build(std::vector<MathVector::Vector2<double>>{});
+	return grid.pairs().empty();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Distance matrix
+/////////////////////////////////////////////////////////////////////
+
+bool distance_matrix()
+{
+	typedef MathVector::Vector<float, 37> vec37;
+	std::uniform_real_distribution<float> range(-1.0f, 1.0f);
+	std::vector<vec37> lhs(70), rhs(301);
+	for (auto& vc : lhs)
+		for (auto& x : vc)
+			x = range(random_eng);
+	for (auto& vc : rhs)
+		for (auto& x : vc)
+			x = range(random_eng);
+	rhs[7] = lhs[3];
+
+	MathVector::ThreadPool pool(3);
+	auto single = MathVector::squared_distance_matrix(lhs, rhs, pool);
+	std::vector<double> wide(lhs.size() * rhs.size());
+	MathVector::squared_distance_matrix(MathVector::Span<const vec37>(lhs), MathVector::Span<const vec37>(rhs),
+		MathVector::Span<double>(wide), pool);
+	for (auto i = 0U; i < lhs.size(); i++) {
+		for (auto j = 0U; j < rhs.size(); j++) {
+			double expected = 0;
+			for (auto k = 0U; k < 37; k++)
+				expected += (double(lhs[i][k]) - rhs[j][k]) * (double(lhs[i][k]) - rhs[j][k]);
+			if (std::abs(single[i * rhs.size() + j] - expected) > 1e-4 || std::abs(wide[i * rhs.size() + j] - expected) > 1e-10)
+				return false;
+		}
+	}
+	return single[3 * rhs.size() + 7] < 1e-4 && single[3 * rhs.size() + 7] >= 0;
+}
+
+bool distance_top_k()
+{
+	std::uniform_real_distribution<double> range(-1.0, 1.0);
+	std::vector<MathVector::Vector<double, 6>> lhs(130), rhs(2500);
+	for (auto& vc : lhs)
+		for (auto& x : vc)
+			x = range(random_eng);
+	for (auto& vc : rhs)
+		for (auto& x : vc)
+			x = range(random_eng);
+
+	auto matrix = MathVector::squared_distance_matrix(lhs, rhs);
+	auto nearest = MathVector::nearest_rows(lhs, rhs, 4);
+	for (auto i = 0U; i < lhs.size(); i++) {
+		std::vector<double> row(matrix.begin() + i * rhs.size(), matrix.begin() + (i + 1) * rhs.size());
+		std::sort(row.begin(), row.end());
+		for (auto n = 0U; n < 4; n++) {
+			auto& found = nearest[i * 4 + n];
+			if (found.squared_distance != row[n] || matrix[i * rhs.size() + found.index] != row[n])
+				return false;
+		}
+	}
+
+	// Distances that overflow to infinity still fill every row of a caller's buffer
+	std::vector<MathVector::Vector<float, 3>> near(3), far(5, MathVector::Vector<float, 3>{{1e20f, -1e20f, 1e20f}});
+	std::vector<MathVector::Neighbor<float>> rows(near.size() * 3, MathVector::Neighbor<float>{999, -1.0f});
+	MathVector::nearest_rows(MathVector::Span<const MathVector::Vector<float, 3>>(near), MathVector::Span<const MathVector::Vector<float, 3>>(far),
+		3, MathVector::Span<MathVector::Neighbor<float>>(rows));
+	for (auto i = 0U; i < near.size(); i++) {
+		std::vector<std::size_t> indices;
+		for (auto n = 0U; n < 3; n++) {
+			auto& found = rows[i * 3 + n];
+			if (found.index >= far.size() || found.squared_distance != std::numeric_limits<float>::infinity())
+				return false;
+			indices.push_back(found.index);
+		}
+		std::sort(indices.begin(), indices.end());
+		if (std::unique(indices.begin(), indices.end()) != indices.end())
+			return false;
+	}
+	return MathVector::nearest_rows(lhs, std::vector<MathVector::Vector<double, 6>>(2), 4).size() == lhs.size() * 2;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Quantized vectors
+/////////////////////////////////////////////////////////////////////
+
+bool quant_int8()
+{
+	typedef MathVector::Vector<float, 301> vec301;
+	std::normal_distribution<float> range(0.0f, 1.0f);
+	vec301 a, b;
+	for (auto k = 0U; k < 301; k++) {
+		a[k] = range(random_eng);
+		b[k] = 0.5f * a[k] + range(random_eng);
+	}
+
+	auto qa = MathVector::quantize_int8(a), qb = MathVector::quantize_int8(b);
+	auto back = MathVector::dequantize(qa);
+	for (auto k = 0U; k < 301; k++)
+		if (std::abs(back[k] - a[k]) > qa.scale * 0.5f * 1.001f)
+			return false;
+
+	// Compressed kernels must match the same math on the decoded vectors
+	auto da = MathVector::dequantize<double>(qa), db = MathVector::dequantize<double>(qb);
+	double dot = MathVector::dot_product(da, db);
+	double distance = MathVector::dot_product(da - db, da - db);
+	auto zero = MathVector::quantize_int8(vec301{});
+
+	// Every kernel the cpu runs sums the codes exactly, like the scalar one
+	bool kernels = true;
+#if MATHVECTOR_SIMD_DISPATCH
+	auto same = [](MathVector::detail::Int8Sums x, MathVector::detail::Int8Sums y) {
+		return x.ab == y.ab && x.aa == y.aa && x.bb == y.bb;
+	};
+	auto reference = MathVector::detail::scalar_int8_sums<true>(qa.codes.data(), qb.codes.data(), 301);
+	kernels = same(MathVector::detail::sse2_int8_sums<true>(qa.codes.data(), qb.codes.data(), 301), reference);
+	if (MathVector::simd::supported(MathVector::simd::Isa::avx2))
+		kernels = kernels && same(MathVector::detail::avx2_int8_sums<true>(qa.codes.data(), qb.codes.data(), 301), reference);
+#endif
+	// Integer components below 127 keep their scale & round trip exactly
+	MathVector::Vector<int, 4> integral{{100, -50, 3, 0}};
+	auto qi = MathVector::quantize_int8(integral);
+	kernels = kernels && std::abs(qi.scale - 100.0f / 127) < 1e-7f
+		&& MathVector::dequantize<int>(MathVector::quantize_int8(MathVector::Vector<int, 4>{{127, -127, 5, 1}})) == MathVector::Vector<int, 4>{{127, -127, 5, 1}};
+
+	return kernels && std::abs(MathVector::dot_product(qa, qb) - dot) < 1e-3 * std::abs(dot)
+		&& std::abs(MathVector::squared_distance(qa, qb) - distance) < 1e-3 * distance
+		&& std::abs(MathVector::dot_product(qa, qb) - MathVector::dot_product(a, b)) < 0.02f * std::abs(MathVector::dot_product(a, b))
+		&& zero.scale == 0 && MathVector::dequantize(zero) == vec301{} && MathVector::squared_distance(qa, qa) < 1e-3f;
+}
+
+bool quant_half()
+{
+	using MathVector::float_to_half;
+	using MathVector::half_to_float;
+	// Exact values, rounding to even, overflow, subnormals & NaN
+	bool conversions = half_to_float(float_to_half(1.0f)) == 1.0f
+		&& float_to_half(-2.0f) == 0xc000 && float_to_half(65504.0f) == 0x7bff
+		&& float_to_half(1.0f + 0x1p-11f) == 0x3c00 && float_to_half(1.0f + 3 * 0x1p-11f) == 0x3c02
+		&& float_to_half(1e6f) == 0x7c00 && std::isinf(half_to_float(0xfc00)) && half_to_float(0xfc00) < 0
+		&& half_to_float(0x0001) == 0x1p-24f && float_to_half(0x1p-24f) == 0x0001 && float_to_half(0x1p-26f) == 0
+		&& std::isnan(half_to_float(float_to_half(std::nanf(""))));
+	for (std::uint32_t h = 0; h < 0x7c00 && conversions; h++)
+		conversions = float_to_half(half_to_float(static_cast<std::uint16_t>(h))) == h;
+
+	typedef MathVector::Vector<float, 45> vec45;
+	std::uniform_real_distribution<float> range(-4.0f, 4.0f);
+	vec45 a, b;
+	for (auto k = 0U; k < 45; k++) {
+		a[k] = range(random_eng);
+		b[k] = range(random_eng);
+	}
+	auto qa = MathVector::quantize_half(a), qb = MathVector::quantize_half(b);
+	auto da = MathVector::dequantize<double>(qa), db = MathVector::dequantize<double>(qb);
+	double dot = MathVector::dot_product(da, db);
+	double distance = MathVector::dot_product(da - db, da - db);
+
+	bool kernels = true;
+#if MATHVECTOR_SIMD_DISPATCH
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c")) {
+		float fast = MathVector::detail::f16c_half_sum<true>(qa.bits.data(), qb.bits.data(), 45);
+		float reference = MathVector::detail::scalar_half_sum<true>(qa.bits.data(), qb.bits.data(), 45);
+		kernels = std::abs(fast - reference) < 1e-5f * reference;
+	}
+#endif
+	return conversions && kernels
+		&& std::abs(MathVector::dot_product(qa, qb) - dot) < 1e-4 * (1 + std::abs(dot))
+		&& std::abs(MathVector::squared_distance(qa, qb) - distance) < 1e-4 * distance;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Matrices & affine transforms
+/////////////////////////////////////////////////////////////////////
+
+bool matrix_compose()
+{
+	typedef MathVector::Affine<double, 3> affine3;
+	// Composition happens at compile time
+	constexpr auto transform = affine3::translation(MathVector::Vector3(1.0, 2.0, 3.0))
+		* affine3::scaling(MathVector::Vector3(2.0, 3.0, 4.0));
+	static_assert(transform(MathVector::Vector3(1.0, 1.0, 1.0)) == MathVector::Vector3(3.0, 5.0, 7.0));
+	static_assert(affine3::from_matrix(transform.matrix()) == transform);
+	static_assert((transform.matrix() * MathVector::Vector<double, 4>{{1, 1, 1, 1}})[2] == 7.0);
+	static_assert(MathVector::transpose(MathVector::Matrix<int, 2, 3>{{{{1, 2, 3}, {4, 5, 6}}}})[2][1] == 6);
+
+	// Rotating a quarter turn about z twice is a half turn, composed with the matrix product
+	auto quarter = MathVector::rotation(MathVector::Vector3(0.0, 0.0, 1.0), std::acos(0.0));
+	auto half = affine3{quarter * quarter, {{1, 0, 0}}};
+	auto moved = half(MathVector::Vector3(1.0, 2.0, 5.0)) - MathVector::Vector3(0.0, -2.0, 5.0);
+	auto turned = MathVector::rotation(std::acos(0.0f)) * MathVector::Vector2(1.0f, 0.0f);
+	return MathVector::dot_product(moved, moved) < 1e-20
+		&& std::abs(turned.x) < 1e-7f && std::abs(turned.y - 1) < 1e-7f
+		&& affine3::identity() * half == half && (half * affine3::scaling(1.0)).matrix() == half.matrix();
+}
+
+bool matrix_batch()
+{
+	typedef MathVector::Vector3<float> vec3;
+	auto transform = MathVector::Affine<float, 3>::translation(vec3(1.0f, -2.0f, 0.5f))
+		* MathVector::Affine<float, 3>{MathVector::rotation(vec3(0.6f, 0.0f, 0.8f), 0.3f)}
+		* MathVector::Affine<float, 3>::scaling(1.5f);
+
+	// Enough points for several thread chunks & blocks plus a partial pack
+	std::vector<vec3> points(3 * MathVector::detail::transform_grain + 5);
+	for (auto& vc : points)
+		vc = vec3(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+	MathVector::VectorSoA<vec3> soa(points.begin(), points.end());
+	std::vector<vec3> out(points.size());
+
+	MathVector::transform_points(transform, MathVector::Span<const vec3>(points), MathVector::Span<vec3>(out));
+	MathVector::transform_points(transform, soa);
+	for (auto i = 0U; i < points.size(); i++) {
+		auto expected = transform(points[i]);
+		auto diff = out[i] - expected, soa_diff = soa[i].get() - expected;
+		if (MathVector::dot_product(diff, diff) > 1e-8f || MathVector::dot_product(soa_diff, soa_diff) > 1e-8f)
+			return false;
+	}
+	MathVector::transform_points(transform, points);
+	if (points != out)
+		return false;
+
+	// Vector<T, N> with a scalar tail
+	typedef MathVector::Vector<double, 5> vec5;
+	MathVector::Affine<double, 5> wide;
+	for (auto r = 0U; r < 5; r++) {
+		wide.offset[r] = float_number_range(random_eng);
+		for (auto c = 0U; c < 5; c++)
+			wide.linear[r][c] = float_number_range(random_eng);
+	}
+	std::vector<vec5> vcs(7);
+	for (auto& vc : vcs)
+		for (auto k = 0U; k < 5; k++)
+			vc[k] = float_number_range(random_eng);
+	auto original = vcs;
+	MathVector::transform_points(wide, vcs);
+	for (auto i = 0U; i < vcs.size(); i++) {
+		auto diff = vcs[i] - wide(original[i]);
+		if (MathVector::dot_product(diff, diff) > 1e-18)
+			return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Quaternions
+/////////////////////////////////////////////////////////////////////
+
+bool quat_ops()
+{
+	typedef MathVector::Vector3<double> vec3;
+	typedef MathVector::Quaternion<double> quat;
+	static_assert(quat::identity() * quat(0, 1, 0, 0) == quat(0, 1, 0, 0));
+	static_assert(MathVector::rotate(quat::identity(), vec3(1, 2, 3)) == vec3(1, 2, 3));
+
+	auto close = [](vec3 a, vec3 b) { return MathVector::dot_product(a - b, a - b) < 1e-20; };
+	double quarter = std::acos(0.0);
+	auto about_z = quat::from_axis_angle(vec3(0, 0, 1), quarter);
+	auto about_x = quat::from_axis_angle(vec3(1, 0, 0), quarter);
+	auto axis = vec3(2, -1, 2) * (1.0 / 3);
+	auto q = quat::from_axis_angle(axis, 0.7);
+	auto v = vec3(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+
+	// Products compose right to left & the conjugate undoes a rotation
+	bool rotations = close(MathVector::rotate(about_z, vec3(1, 0, 0)), vec3(0, 1, 0))
+		&& close(MathVector::rotate(about_x * about_z, vec3(1, 0, 0)), vec3(0, 0, 1))
+		&& close(MathVector::rotate(q, v), MathVector::rotation(axis, 0.7) * v)
+		&& close(MathVector::rotate(q, v), q.matrix() * v)
+		&& close(MathVector::rotate(MathVector::conjugate(q), MathVector::rotate(q, v)), v);
+
+	// Halfway between no rotation & a quarter turn is an eighth turn, whichever sign the end has
+	auto half = MathVector::slerp(quat::identity(), -about_z, 0.5);
+	auto expected = quat::from_axis_angle(vec3(0, 0, 1), quarter / 2);
+	auto same = MathVector::slerp(q, q, 0.3);
+	auto normalized = MathVector::normalize(quat(0, 3, 0, 4));
+	return rotations && std::abs(half.w - expected.w) < 1e-12 && std::abs(half.z - expected.z) < 1e-12
+		&& std::abs(same.w - q.w) < 1e-12 && std::abs(same.y - q.y) < 1e-12
+		&& std::abs(MathVector::slerp(about_x, about_z, 1.0).z - about_z.z) < 1e-12
+		&& !MathVector::normalize(quat(0, 0, 0, 0)) && normalized && std::abs(normalized->x - 0.6) < 1e-15 && std::abs(normalized->z - 0.8) < 1e-15;
+}
+
+bool quat_batch()
+{
+	typedef MathVector::Vector3<float> vec3;
+	typedef MathVector::Quaternion<float> quat;
+	// Several thread chunks plus a partial pack
+	std::size_t count = 2 * MathVector::detail::transform_grain + 3;
+	std::vector<vec3> vcs(count);
+	std::vector<quat> qs(count);
+	for (auto i = 0U; i < count; i++) {
+		vcs[i] = vec3(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+		auto axis = MathVector::unit_vector(vec3(float_number_range(random_eng), float_number_range(random_eng), 1.0f),
+			[](float a, float b, float c) { return std::hypot(a, b, c); });
+		qs[i] = quat::from_axis_angle(axis.value_or(vec3(0, 0, 1)), float_number_range(random_eng));
+	}
+	MathVector::VectorSoA<vec3> soa(vcs.begin(), vcs.end()), soa_single(vcs.begin(), vcs.end());
+	MathVector::VectorSoA<quat> soa_qs(qs.begin(), qs.end());
+	std::vector<vec3> single(count), each(count);
+
+	MathVector::rotate_batch(qs[0], MathVector::Span<const vec3>(vcs), MathVector::Span<vec3>(single));
+	MathVector::rotate_batch(qs[0], soa_single);
+	MathVector::rotate_batch(MathVector::Span<const quat>(qs), MathVector::Span<const vec3>(vcs), MathVector::Span<vec3>(each));
+	MathVector::rotate_batch(soa_qs, soa);
+	auto far = [](vec3 a, vec3 b) { return MathVector::dot_product(a - b, a - b) > 1e-8f; };
+	for (auto i = 0U; i < count; i++) {
+		auto expected_single = MathVector::rotate(qs[0], vcs[i]), expected = MathVector::rotate(qs[i], vcs[i]);
+		if (far(single[i], expected_single) || far(soa_single[i], expected_single) || far(each[i], expected) || far(soa[i], expected))
+			return false;
+	}
+	MathVector::rotate_batch(MathVector::Span<const quat>(qs), vcs);
+	return vcs == each;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Cross product & meshes
+/////////////////////////////////////////////////////////////////////
+
+bool cross_product()
+{
+	typedef MathVector::Vector3<int> vec3;
+	static_assert(MathVector::cross_product(vec3(1, 0, 0), vec3(0, 1, 0)) == vec3(0, 0, 1));
+	static_assert(MathVector::cross_product(MathVector::Vector<int, 3>{{0, 0, 1}}, MathVector::Vector<int, 3>{{1, 0, 0}})[1] == 1);
+
+	// Components under 2^9 keep the triple products within int
+	auto a = vec3(number_range(random_eng) / 64, number_range(random_eng) / 64, number_range(random_eng) / 64);
+	auto b = vec3(number_range(random_eng) / 64, number_range(random_eng) / 64, number_range(random_eng) / 64);
+	auto c = MathVector::cross_product(a, b);
+	return MathVector::dot_product(c, a) == 0 && MathVector::dot_product(c, b) == 0
+		&& MathVector::cross_product(b, a) == -c && MathVector::cross_product(a, a) == vec3(0, 0, 0);
+}
+
+bool mesh_normals()
+{
+	typedef MathVector::Vector3<double> vec3;
+	typedef MathVector::Triangle<std::uint32_t> tri;
+	// A grid of quads bent over a ridge, big enough for several chunks, plus a degenerate triangle & a lone vertex
+	const std::uint32_t side = 120;
+	std::vector<vec3> vertices;
+	for (auto y = 0U; y < side; y++)
+		for (auto x = 0U; x < side; x++)
+			vertices.push_back(vec3(x, y, std::abs(double(x) - side / 2) * 0.5 + float_number_range(random_eng) * 0.01));
+	vertices.push_back(vec3(1, 1, 1));
+	std::vector<tri> triangles;
+	for (auto y = 0U; y + 1 < side; y++) {
+		for (auto x = 0U; x + 1 < side; x++) {
+			std::uint32_t i = y * side + x;
+			triangles.push_back({i, i + 1, i + side + 1});
+			triangles.push_back({i, i + side + 1, i + side});
+		}
+	}
+	triangles.push_back({0, 1, 2});
+
+	std::vector<vec3> face(triangles.size()), vertex(vertices.size());
+	std::vector<double> areas(triangles.size());
+	MathVector::face_normals(MathVector::Span<const vec3>(vertices), MathVector::Span<const tri>(triangles), MathVector::Span<vec3>(face));
+	MathVector::face_areas(MathVector::Span<const vec3>(vertices), MathVector::Span<const tri>(triangles), MathVector::Span<double>(areas));
+	MathVector::VertexTriangles adjacency(vertices.size(), MathVector::Span<const tri>(triangles));
+	MathVector::vertex_normals(MathVector::Span<const vec3>(vertices), MathVector::Span<const tri>(triangles), adjacency, MathVector::Span<vec3>(vertex));
+
+	auto far = [](vec3 a, vec3 b) { return MathVector::dot_product(a - b, a - b) > 1e-20; };
+	for (auto t = 0U; t < triangles.size(); t++) {
+		auto& a = vertices[triangles[t][0]];
+		auto cross = MathVector::cross_product(vertices[triangles[t][1]] - a, vertices[triangles[t][2]] - a);
+		double length = std::sqrt(MathVector::dot_product(cross, cross));
+		if (std::abs(areas[t] - length / 2) > 1e-12 || far(face[t], length == 0 ? vec3(0, 0, 0) : cross * (1 / length)))
+			return false;
+	}
+	std::vector<vec3> sums(vertices.size(), vec3(0, 0, 0));
+	for (auto t = 0U; t < triangles.size(); t++)
+		for (auto corner : triangles[t])
+			sums[corner] += face[t] * (2 * areas[t]);
+	for (auto v = 0U; v < vertices.size(); v++) {
+		double length = std::sqrt(MathVector::dot_product(sums[v], sums[v]));
+		if (far(vertex[v], length == 0 ? vec3(0, 0, 0) : sums[v] * (1 / length)))
+			return false;
+	}
+
+	bool threw = false;
+	try {
+		MathVector::VertexTriangles bad(3, MathVector::Span<const tri>(triangles));
+	}
+	catch (const std::out_of_range&) {
+		threw = true;
+	}
+	return threw && adjacency[side + 1].size() == 6 && adjacency[vertices.size() - 1].empty();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Particle integration
+/////////////////////////////////////////////////////////////////////
+
+bool integrate_euler()
+{
+	typedef MathVector::Vector3<double> vec3;
+	// Several thread chunks plus a partial pack
+	std::size_t count = 2 * MathVector::detail::integrate_grain + 3;
+	std::vector<vec3> x(count), v(count), a(count);
+	auto random_vec = [] { return vec3(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng)); };
+	for (auto i = 0U; i < count; i++) {
+		x[i] = random_vec();
+		v[i] = random_vec();
+		a[i] = random_vec();
+	}
+	MathVector::VectorSoA<vec3> xs(x.begin(), x.end()), vs(v.begin(), v.end()), as(a.begin(), a.end());
+	auto xs2 = xs, vs2 = vs, xs3 = xs, vs3 = vs;
+	auto gravity = vec3(0, 0, -9.8);
+	double dt = 0.01;
+
+	MathVector::euler_step(xs, vs, as, dt);
+	MathVector::semi_implicit_euler_step(xs2, vs2, as, dt);
+	MathVector::semi_implicit_euler_step(xs3, vs3, gravity, dt);
+	auto far = [](vec3 p, vec3 q) { return MathVector::dot_product(p - q, p - q) > 1e-24; };
+	for (auto i = 0U; i < count; i++) {
+		auto implicit_v = v[i] + a[i] * dt, gravity_v = v[i] + gravity * dt;
+		if (far(xs[i], x[i] + v[i] * dt) || far(vs[i], implicit_v)
+			|| far(xs2[i], x[i] + implicit_v * dt) || far(vs2[i], implicit_v)
+			|| far(xs3[i], x[i] + gravity_v * dt) || far(vs3[i], gravity_v))
+			return false;
+	}
+	return true;
+}
+
+bool integrate_verlet()
+{
+	typedef MathVector::Vector2<double> vec2;
+	// Springs to the origin, a = -x, from x = (1, 0) & v = (0, 1) circle once in 2 pi
+	std::size_t count = 37;
+	MathVector::VectorSoA<vec2> x(count), v(count), a(count);
+	for (auto i = 0U; i < count; i++) {
+		x[i] = vec2(1, 0);
+		v[i] = vec2(0, 1);
+		a[i] = vec2(-1, 0);
+	}
+	auto spring = [](const MathVector::VectorSoA<vec2>& positions, MathVector::VectorSoA<vec2>& accelerations) {
+		for (auto i = 0U; i < positions.size(); i++)
+			accelerations[i] = -positions[i];
+	};
+	const int steps = 1000;
+	double dt = 2 * std::acos(-1.0) / steps;
+	for (int s = 0; s < steps; s++)
+		MathVector::velocity_verlet_step(x, v, a, dt, spring);
+
+	// Falling under gravity Verlet is exact
+	MathVector::VectorSoA<vec2> fx(count), fv(count);
+	for (auto i = 0U; i < count; i++)
+		fv[i] = vec2(3, 0);
+	for (int s = 0; s < 10; s++)
+		MathVector::velocity_verlet_step(fx, fv, vec2(0, -2), 0.5);
+
+	for (auto i = 0U; i < count; i++) {
+		vec2 p = x[i], q = v[i];
+		vec2 fp = fx[i], fq = fv[i];
+		if (std::abs(p.x - 1) > 1e-4 || std::abs(p.y) > 1e-4 || std::abs(q.x) > 1e-4 || std::abs(q.y - 1) > 1e-4
+			|| std::abs(fp.x - 15) > 1e-12 || std::abs(fp.y + 25) > 1e-12 || std::abs(fq.y + 10) > 1e-12)
+			return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Barnes-Hut
+/////////////////////////////////////////////////////////////////////
+
+bool nbody_exact()
+{
+	typedef MathVector::Vector3<double> vec3;
+	// Two clusters & some duplicated positions, with an opening angle of 0 the tree sums every pair
+	std::vector<vec3> bodies(700);
+	std::vector<double> masses(bodies.size());
+	std::uniform_real_distribution<double> mass_range(0.1, 2.0);
+	for (auto i = 0U; i < bodies.size(); i++) {
+		double offset = i % 2 ? 100 : 0;
+		bodies[i] = vec3(float_number_range(random_eng) + offset, float_number_range(random_eng), float_number_range(random_eng) * 0.01);
+		masses[i] = mass_range(random_eng);
+	}
+	bodies[5] = bodies[6] = bodies[7];
+
+	MathVector::ThreadPool pool(3);
+	MathVector::BarnesHut<vec3> tree(MathVector::Span<const vec3>(bodies), MathVector::Span<const double>(masses), 4, pool);
+	std::vector<vec3> exact(bodies.size()), approx(bodies.size()), soft(bodies.size()), soft_exact(bodies.size());
+	MathVector::pairwise_accelerations(MathVector::Span<const vec3>(bodies), MathVector::Span<const double>(masses), MathVector::Span<vec3>(exact), 0.0, pool);
+	MathVector::pairwise_accelerations(MathVector::Span<const vec3>(bodies), MathVector::Span<const double>(masses), MathVector::Span<vec3>(soft_exact), 0.5, pool);
+	tree.accelerations(MathVector::Span<vec3>(approx), 0.0, 0.0, pool);
+	tree.accelerations(MathVector::Span<vec3>(soft), 0.0, 0.5, pool);
+
+	auto far = [](vec3 a, vec3 b) { return MathVector::dot_product(a - b, a - b) > 1e-20 * (1 + MathVector::dot_product(b, b)); };
+	for (auto i = 0U; i < bodies.size(); i++)
+		if (far(approx[i], exact[i]) || far(soft[i], soft_exact[i]) || far(tree.acceleration(bodies[i], 0.0), exact[i]))
+			return false;
+	MathVector::BarnesHut<vec3> empty{MathVector::Span<const vec3>(), MathVector::Span<const double>()};
+	return tree.size() == bodies.size() && empty.acceleration(vec3(1, 2, 3)) == vec3(0, 0, 0);
+}
+
+bool nbody_approx()
+{
+	typedef MathVector::Vector3<double> vec3;
+	// A dense core in a sparse halo, with positive & negative charges
+	std::vector<vec3> bodies(5000);
+	std::vector<double> masses(bodies.size());
+	std::normal_distribution<double> core(0.0, 1.0);
+	for (auto i = 0U; i < bodies.size(); i++) {
+		double spread = i % 4 ? 1.0 : 30.0;
+		bodies[i] = vec3(core(random_eng) * spread, core(random_eng) * spread, core(random_eng) * spread);
+		masses[i] = i % 3 ? 1.0 : -0.5;
+	}
+	MathVector::BarnesHut<vec3> tree{MathVector::Span<const vec3>(bodies), MathVector::Span<const double>(masses)};
+	std::vector<vec3> approx(bodies.size()), serial(bodies.size());
+	tree.accelerations(MathVector::Span<vec3>(approx), 0.5, 0.01);
+
+	// Results don't depend on the number of threads
+	MathVector::ThreadPool one(1);
+	MathVector::BarnesHut<vec3> serial_tree(MathVector::Span<const vec3>(bodies), MathVector::Span<const double>(masses), 8, one);
+	serial_tree.accelerations(MathVector::Span<vec3>(serial), 0.5, 0.01, one);
+	if (serial != approx)
+		return false;
+
+	// Check a sample of bodies against the direct sum, the relative error should be around a percent
+	double error = 0, total = 0;
+	for (auto i = 0U; i < bodies.size(); i += 37) {
+		vec3 exact(0, 0, 0);
+		for (auto j = 0U; j < bodies.size(); j++) {
+			vec3 d = bodies[j] - bodies[i];
+			double squared = MathVector::dot_product(d, d) + 0.01 * 0.01;
+			if (j != i)
+				exact += d * (masses[j] / (squared * std::sqrt(squared)));
+		}
+		error += std::sqrt(MathVector::dot_product(approx[i] - exact, approx[i] - exact));
+		total += std::sqrt(MathVector::dot_product(exact, exact));
+	}
+	return error < 0.01 * total;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Compile time unrolling
+/////////////////////////////////////////////////////////////////////
+
+// Writes through the non-const index so the member pointer lookup is evaluated as a constant
+template <class V>
+constexpr V indexed(typename V::scalar start)
+{
+	V vc{};
+	for (auto i = 0U; i < V::SIZE; i++)
+		vc[i] = start + i;
+	return vc;
+}
+
+bool unroll_constexpr()
+{
+	typedef MathVector::Vector<double, 5> vec5;
+	typedef MathVector::Vector<int, 20> vec20;
+	constexpr auto vc2 = indexed<MathVector::Vector2<int>>(1);
+	constexpr auto vc3 = indexed<MathVector::Vector3<double>>(1);
+	constexpr auto vc5 = indexed<vec5>(1);
+	constexpr auto vc20 = indexed<vec20>(1);
+
+	static_assert(vc2 == MathVector::Vector2(1, 2) && vc3 == MathVector::Vector3(1.0, 2.0, 3.0));
+	static_assert(vc3[2] == 3.0 && vc5[4] == 5.0 && vc20[19] == 20);
+	static_assert((vc5 + vc5 - vc5 * 3.0)[3] == -4.0);
+	static_assert((-vc5)[0] == -1.0 && (-vc20)[19] == -20);
+	static_assert((vc20 * 2 - vc20)[11] == 12);
+	static_assert(MathVector::dot_product(vc2, vc2) == 5);
+	static_assert(MathVector::dot_product(vc3, vc3) == 14.0);
+	static_assert(MathVector::dot_product(vc5, vc5) == 55.0);
+	// Past max_unroll the loop is kept
+	static_assert(MathVector::dot_product(vc20, vc20) == 2870);
+	static_assert(MathVector::is_trivial(MathVector::Vector3(0, 0, 0)) && !MathVector::is_trivial(vc3));
+	static_assert(MathVector::is_trivial(vec20{}) && !MathVector::is_trivial(vc20));
+
+	// The same expressions evaluated at run time
+	auto rt5 = indexed<vec5>(1);
+	auto rt20 = indexed<vec20>(1);
+	return MathVector::dot_product(rt5, rt5) == 55.0 && MathVector::dot_product(rt20, rt20) == 2870
+		&& -rt5 == rt5 * -1.0 && MathVector::is_trivial(rt20 - rt20);
+}
+
+bool unroll_get()
+{
+	constexpr MathVector::Vector3 vc3(4, 5, 6);
+	static_assert(MathVector::get<0>(vc3) == 4 && MathVector::get<2>(vc3) == 6);
+	static_assert(MathVector::get<1>(MathVector::Vector2(7, 8)) == 8);
+	static_assert(MathVector::get<3>(indexed<MathVector::Vector<int, 4>>(0)) == 3);
+
+	constexpr auto squares = [] {
+		MathVector::Vector<int, 6> vc{};
+		MathVector::unroll<6>([&](auto i) { MathVector::get<i>(vc) = int(i * i); });
+		return vc;
+	}();
+	static_assert(squares[5] == 25);
+
+	int x = number_range(random_eng);
+	auto vc = MathVector::Vector3(x, x + 1, x + 2);
+	MathVector::get<1>(vc) = x;
+	int sum = 0;
+	MathVector::for_each_index<3>([&](auto i) { sum += vc[i]; });
+	return vc.y == x && sum == 3 * x + 2;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Dynamic vectors
+/////////////////////////////////////////////////////////////////////
+
+template <class T, std::size_t N>
+MathVector::Vector<T, N> random_vector()
+{
+	MathVector::Vector<T, N> vc;
+	for (auto& x : vc)
+		x = static_cast<T>(float_number_range(random_eng));
+	return vc;
+}
+
+// Checks a run time length vector against Vector<T, N>, inline or on the heap depending on N
+template <class T, std::size_t N>
+bool dynamic_matches()
+{
+	typedef MathVector::DynamicVector<T> dyn;
+	auto a = random_vector<T, N>();
+	auto b = random_vector<T, N>();
+	T s = static_cast<T>(float_number_range(random_eng));
+	dyn da(a), db(b);
+	if (da.size() != N || da.is_inline() != (N <= MathVector::detail::dynamic_inline_size<T>))
+		return false;
+
+	auto expected = (a + b) * s - a;
+	auto result = (da + db) * s - da;
+	for (auto i = 0U; i < N; i++)
+		if (std::fabs(result[i] - expected[i]) > 1e-3)
+			return false;
+
+	if constexpr (std::is_floating_point_v<T>) {
+		T tolerance = static_cast<T>(1e-4) * N * 400;
+		auto unit = MathVector::unit_vector(da, [](T x) { return std::sqrt(x); });
+		if (std::fabs(MathVector::dot_product(da, db) - MathVector::dot_product(a, b)) > tolerance
+			|| std::fabs(MathVector::magnitude(da, [](T x) { return std::sqrt(x); })
+				- std::sqrt(MathVector::dot_product(a, a))) > tolerance
+			|| !unit || std::fabs(MathVector::dot_product(*unit, *unit) - 1) > 1e-3)
+			return false;
+	}
+	else if (MathVector::dot_product(da, db) != MathVector::dot_product(a, b)) {
+		return false;
+	}
+	return -da == da * T(-1) && +da == da
+		&& !MathVector::is_trivial(da) && MathVector::is_trivial(da - da);
+}
+
+bool dynamic_ops()
+{
+	typedef MathVector::DynamicVector<float> dyn;
+	if (!dynamic_matches<float, 3>() || !dynamic_matches<float, 16>() || !dynamic_matches<float, 17>()
+		|| !dynamic_matches<float, 384>() || !dynamic_matches<double, 768>() || !dynamic_matches<int, 40>())
+		return false;
+
+	// Copies & moves between inline & heap storage
+	dyn small{1, 2, 3};
+	dyn large(100, 2.0f);
+	dyn copy(large);
+	dyn moved(std::move(copy));
+	if (!copy.empty() || !copy.is_inline() || moved != large || moved.is_inline())
+		return false;
+	if (reinterpret_cast<std::uintptr_t>(large.data()) % 64 != 0)
+		return false;
+	moved = small;
+	large = std::move(moved);
+	large.resize(20, 5.0f);
+	small.resize(2);
+	if (large.size() != 20 || large[2] != 3 || large[19] != 5 || small != dyn{1, 2})
+		return false;
+
+	// Growing the heap buffer with one of its own components as the value
+	dyn grown(40, 3.0f);
+	grown.resize(100, grown[0]);
+	if (grown.size() != 100 || grown[99] != 3)
+		return false;
+
+	// Dimensions that differ throw
+	try {
+		small += large;
+		return false;
+	}
+	catch (const std::length_error&) {
+	}
+	try {
+		MathVector::dot_product(small, large);
+		return false;
+	}
+	catch (const std::length_error&) {
+	}
+	return !MathVector::unit_vector(dyn(5), [](float x) { return std::sqrt(x); });
+}
+
+bool dynamic_views()
+{
+	const std::size_t dimension = 96, rows = 4;
+	std::vector<float> matrix(dimension * rows);
+	for (auto& x : matrix)
+		x = float_number_range(random_eng);
+
+	MathVector::VectorView<float> row0(matrix.data(), dimension);
+	MathVector::VectorView<const float> row1(matrix.data() + dimension, dimension);
+	MathVector::DynamicVector<float> copy0(row0);
+	float expected = 0;
+	for (auto i = 0U; i < dimension; i++)
+		expected += matrix[i] * matrix[dimension + i];
+	if (std::fabs(MathVector::dot_product(row0, row1) - expected) > 1e-2f || copy0 != row0)
+		return false;
+
+	// Writes go to the borrowed rows, results of binary operators are owned
+	auto sum = row0 + row1;
+	row0 += row1;
+	row0 *= 0.5f;
+	if (row0 != sum * 0.5f || matrix[0] != sum[0] * 0.5f)
+		return false;
+	row0 -= copy0;
+
+	// Views of fixed size vectors & of dynamic vectors
+	auto fixed = random_vector<float, 8>();
+	MathVector::DynamicVector<float> dyn(fixed);
+	MathVector::VectorView view(dyn);
+	MathVector::VectorView<const float> fixed_view(fixed);
+	view *= 2.0f;
+	return dyn == fixed_view * 2.0f && MathVector::dot_product(fixed_view, fixed_view) == MathVector::dot_product(fixed, fixed)
+		&& std::fabs(row0[1] - (sum[1] * 0.5f - copy0[1])) < 1e-5f;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Sparse vectors
+/////////////////////////////////////////////////////////////////////
+
+// Small whole numbers at about density of the components, so every sum is exact
+template <std::size_t N>
+MathVector::Vector<double, N> random_sparse_dense(double density)
+{
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	std::uniform_int_distribution<int> value(-8, 8);
+	MathVector::Vector<double, N> vc{};
+	for (auto& x : vc)
+		if (chance(random_eng) < density)
+			x = value(random_eng);
+	return vc;
+}
+
+bool sparse_dense()
+{
+	typedef MathVector::SparseVector<double> sparse;
+	const std::size_t N = 2000;
+	auto a = random_sparse_dense<N>(0.02);
+	auto b = random_sparse_dense<N>(0.5);
+	sparse sa(a);
+	MathVector::DynamicVector<double> db(b);
+	if (sa.to_vector<N>() != a || sa.to_dynamic() != MathVector::DynamicVector<double>(a) || sparse(db).to_vector<N>() != b)
+		return false;
+	for (auto k = 0U; k < sa.nonzeros(); k++)
+		if (sa.values()[k] == 0 || sa[sa.indices()[k]] != a[sa.indices()[k]])
+			return false;
+	if (sa[0] != a[0] || sa[N - 1] != a[N - 1])
+		return false;
+
+	// Unsorted pairs with repeats & a pair that cancels
+	std::vector<std::uint32_t> indices{7, 3, 7, 9, 3, 1};
+	std::vector<double> values{1, 2, 4, 5, -2, 0};
+	sparse pairs(10, indices, values);
+	if (pairs.nonzeros() != 2 || pairs[7] != 5 || pairs[9] != 5 || pairs[3] != 0)
+		return false;
+	try {
+		sparse(5, indices, values);
+		return false;
+	}
+	catch (const std::out_of_range&) {
+	}
+
+	double magn = MathVector::magnitude(sa, [](double x) { return std::sqrt(x); });
+	auto unit = MathVector::unit_vector(sa, [](double x) { return std::sqrt(x); });
+	return MathVector::dot_product(sa, b) == MathVector::dot_product(a, b)
+		&& MathVector::dot_product(b, sa) == MathVector::dot_product(a, b)
+		&& MathVector::dot_product(sa, db) == MathVector::dot_product(a, b)
+		&& std::fabs(magn - std::sqrt(MathVector::dot_product(a, a))) < 1e-9
+		&& unit && std::fabs(MathVector::magnitude(*unit, [](double x) { return std::sqrt(x); }) - 1) < 1e-9
+		&& MathVector::is_trivial(sparse(N)) && !MathVector::is_trivial(sa)
+		&& !MathVector::unit_vector(sparse(N), [](double x) { return std::sqrt(x); });
+}
+
+bool sparse_sparse()
+{
+	typedef MathVector::SparseVector<double> sparse;
+	const std::size_t N = 5000;
+	auto a = random_sparse_dense<N>(0.005);
+	auto b = random_sparse_dense<N>(0.3);
+	auto c = random_sparse_dense<N>(0.01);
+	sparse sa(a), sb(b), sc(c);
+	double ab = MathVector::dot_product(a, b), ac = MathVector::dot_product(a, c);
+	if (MathVector::detail::merge_dot(sa, sb) != ab || MathVector::detail::gallop_dot(sa, sb) != ab
+		|| MathVector::detail::merge_dot(sa, sc) != ac || MathVector::detail::gallop_dot(sa, sc) != ac
+		|| MathVector::dot_product(sa, sb) != ab || MathVector::dot_product(sb, sa) != ab
+		|| MathVector::dot_product(sc, sa) != ac)
+		return false;
+
+	// The results only keep the components that aren't zero
+	auto sum = sa + sb - sc * 2.0;
+	auto negated = -sb + sb;
+	if (sum.to_vector<N>() != a + b - c * 2.0 || sum != sparse(a + b - c * 2.0) || negated.nonzeros() != 0)
+		return false;
+	auto scaled = 3.0 * sc;
+	if (scaled.to_vector<N>() != c * 3.0 || (sc * 0.0).nonzeros() != 0 || scaled.nonzeros() != sc.nonzeros())
+		return false;
+
+	try {
+		sa += sparse(N + 1);
+		return false;
+	}
+	catch (const std::length_error&) {
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// HNSW index
+/////////////////////////////////////////////////////////////////////
+
+typedef MathVector::Vector<float, 16> vec16f;
+
+std::vector<vec16f> random_vec16f(std::size_t count)
+{
+	std::vector<vec16f> vcs(count);
+	for (auto& vc : vcs)
+		for (auto& x : vc)
+			x = float_number_range(random_eng);
+	return vcs;
+}
+
+// Share of the exact k nearest found, by distance so ties don't count against it
+double hnsw_recall(const std::vector<MathVector::Neighbor<float>>& found, const std::vector<MathVector::Neighbor<float>>& exact, std::size_t k)
+{
+	std::size_t hits = 0;
+	for (auto row = 0U; row < exact.size() / k; row++) {
+		float bound = exact[row * k + k - 1].squared_distance * (1 + 1e-4f);
+		for (auto i = 0U; i < k; i++)
+			hits += found[row * k + i].squared_distance <= bound;
+	}
+	return static_cast<double>(hits) / exact.size();
+}
+
+bool hnsw_search()
+{
+	auto points = random_vec16f(2000);
+	auto queries = random_vec16f(100);
+	MathVector::HnswParameters parameters;
+	parameters.m = 12;
+	parameters.ef_construction = 100;
+
+	MathVector::ThreadPool pool(4);
+	MathVector::HnswIndex<vec16f> index(points, parameters, pool);
+	auto exact = MathVector::nearest_rows(queries, points, 10, pool);
+	auto batch = index.batch_nearest(queries, 10, 64, pool);
+	for (auto q = 0U; q < queries.size(); q++) {
+		auto found = index.nearest(queries[q], 10, 64);
+		for (auto i = 0U; i < 10; i++) {
+			auto offset = points[found[i].index] - queries[q];
+			if (found[i].index != batch[q * 10 + i].index
+				|| std::fabs(found[i].squared_distance - MathVector::dot_product(offset, offset)) > 1e-2f)
+				return false;
+		}
+	}
+
+	// Points added one at a time from several threads link into the same graph
+	MathVector::HnswIndex<vec16f> incremental(points.size(), parameters);
+	pool.parallel_for(points.size(), [&](std::size_t i) { incremental.insert(points[i]); });
+	auto incremental_batch = incremental.batch_nearest(queries, 10, 64, pool);
+
+	MathVector::HnswIndex<vec16f> empty(4);
+	return hnsw_recall(batch, exact, 10) >= 0.9
+		&& hnsw_recall(incremental_batch, exact, 10) >= 0.9
+		&& index.nearest(points[7], 1)[0].squared_distance == 0
+		&& empty.nearest(queries[0], 3).empty();
+}
+
+// Single inserts from plain threads, each search's marks must cover points claimed after it starts
+bool hnsw_threads()
+{
+	auto points = random_vec16f(4000);
+	MathVector::HnswParameters parameters;
+	parameters.m = 8;
+	parameters.ef_construction = 40;
+	MathVector::HnswIndex<vec16f> index(points.size(), parameters);
+	std::vector<std::thread> threads;
+	for (auto t = 0U; t < 8; t++)
+		threads.emplace_back([&, t] {
+			for (auto i = t; i < points.size(); i += 8)
+				index.insert(points[i]);
+		});
+	for (auto& thread : threads)
+		thread.join();
+
+	std::size_t self = 0;
+	for (auto i = 0U; i < points.size(); i += 40)
+		self += index.nearest(points[i], 1)[0].squared_distance == 0;
+	return index.size() == points.size() && self >= 90;
+}
+
+// A sparse graph leaves points unreachable, so asking for every point can't be satisfied
+bool hnsw_unreachable()
+{
+	auto points = random_vec16f(300);
+	MathVector::HnswParameters parameters;
+	parameters.m = 2;
+	parameters.ef_construction = 2;
+	MathVector::HnswIndex<vec16f> index(points.size(), parameters);
+	for (auto& point : points)
+		index.insert(point);
+
+	std::size_t k = index.size();
+	auto batch = index.batch_nearest(MathVector::Span<const vec16f>(points).subspan(0, 10), k, k);
+	bool short_row = false;
+	for (auto q = 0U; q < 10; q++) {
+		auto found = index.nearest(points[q], k, k);
+		if (found.empty() || !std::is_sorted(found.begin(), found.end(), [](auto& a, auto& b) {
+			return a.squared_distance < b.squared_distance;
+		}))
+			return false;
+		for (auto i = 0U; i < k; i++) {
+			auto& padded = batch[q * k + i];
+			bool matches = i < found.size()
+				? padded.index == found[i].index
+				: padded.index == index.NONE && padded.squared_distance == std::numeric_limits<float>::infinity();
+			if (!matches)
+				return false;
+		}
+		short_row |= found.size() < k;
+	}
+	return short_row;
+}
+
+bool hnsw_file()
+{
+	const char* path = "test_index.mvhn";
+	auto points = random_vec16f(500);
+	auto queries = random_vec16f(20);
+	MathVector::HnswParameters parameters;
+	parameters.m = 8;
+	parameters.ef_construction = 50;
+	MathVector::HnswIndex<vec16f> index(points, parameters);
+	index.save(path);
+
+	bool equal = false, grows = false, wrong_type = false;
+	{
+		auto loaded = MathVector::HnswIndex<vec16f>::load(path, points.size() + 1);
+		auto before = index.batch_nearest(queries, 5);
+		auto after = loaded.batch_nearest(queries, 5);
+		equal = loaded.size() == index.size() && loaded.parameters().m == 8
+			&& std::equal(before.begin(), before.end(), after.begin(), [](auto& a, auto& b) {
+				return a.index == b.index && a.squared_distance == b.squared_distance;
+			});
+		grows = loaded.insert(queries[0]) == points.size() && loaded.nearest(queries[0], 1)[0].index == points.size();
+		try {
+			loaded.insert(queries[1]);
+			grows = false;
+		}
+		catch (const std::length_error&) {
+		}
+		try {
+			MathVector::HnswIndex<MathVector::Vector<double, 16>>::load(path);
+		}
+		catch (const std::runtime_error&) {
+			wrong_type = true;
+		}
+	}
+	auto bytes = read_file_bytes(path);
+	std::remove(path);
+
+	using MathVector::HnswFileHeader;
+	auto rejected = [&](std::size_t size, auto patch) {
+		return file_rejected<HnswFileHeader>(bytes, size, patch, [](const char* corrupt) {
+			MathVector::HnswIndex<vec16f>::load(corrupt);
+		});
+	};
+	auto unchanged = [](HnswFileHeader&) {};
+	bool corrupt = !rejected(bytes.size(), unchanged)
+		&& rejected(bytes.size() - 4, unchanged)
+		&& rejected(bytes.size(), [](HnswFileHeader& h) { h.top_level += 3; })
+		&& rejected(bytes.size(), [](HnswFileHeader& h) { h.count = 0x7fffffff; })
+		&& rejected(bytes.size(), [](HnswFileHeader& h) { h.count += 1; })
+		&& rejected(bytes.size(), [](HnswFileHeader& h) { h.m = 4096; });
+	return equal && grows && wrong_type && corrupt;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Dot product accumulation
+/////////////////////////////////////////////////////////////////////
+
+bool accumulate_float()
+{
+	// Magnitudes spread over 2^-12 to 2^12 & an odd length so the tails run
+	const std::size_t N = 4099;
+	std::uniform_real_distribution<float> mantissa(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> exponent(-12, 12);
+	MathVector::Vector<float, N> a, b;
+	long double exact = 0, absolute = 0;
+	for (auto i = 0U; i < N; i++) {
+		a[i] = std::ldexp(mantissa(random_eng), exponent(random_eng));
+		b[i] = std::ldexp(mantissa(random_eng), exponent(random_eng));
+		exact += static_cast<double>(a[i]) * b[i];
+		absolute += std::fabs(static_cast<double>(a[i]) * b[i]);
+	}
+	auto error = [&](auto sum) { return static_cast<double>(std::fabs(sum - exact) / absolute); };
+	const double eps = std::numeric_limits<float>::epsilon();
+
+	auto serial = MathVector::dot_product<MathVector::SerialAccumulation>(a, b);
+	auto unrolled = MathVector::dot_product<MathVector::UnrolledAccumulation>(a, b);
+	auto pairwise = MathVector::dot_product<MathVector::PairwiseAccumulation>(a, b);
+	auto compensated = MathVector::dot_product<MathVector::CompensatedAccumulation>(a, b);
+	auto widened = MathVector::dot_product<MathVector::WidenedAccumulation>(a, b);
+	static_assert(std::is_same_v<decltype(widened), double> && std::is_same_v<decltype(compensated), float>);
+
+	// The bounds every order of summation guarantees, & within a rounding of the exact sum
+	if (error(serial) > N * eps || error(unrolled) > N * eps || error(pairwise) > 64 * eps
+		|| std::fabs(compensated - exact) > eps * std::fabs(exact) + 1e-12 * absolute
+		|| error(widened) > 1e-12)
+		return false;
+
+	// Vectors without data(), run time lengths & raw arrays
+	MathVector::Vector3<float> c(1e8f, 1.0f, -1e8f), d(1.0f, 1.0f, 1.0f);
+	MathVector::DynamicVector<float> da(a), db(b);
+	return MathVector::dot_product<MathVector::CompensatedAccumulation>(c, d) == 1.0f
+		&& MathVector::dot_product<MathVector::SerialAccumulation>(c, d) == 0.0f
+		&& MathVector::dot_product<MathVector::PairwiseAccumulation>(da, MathVector::VectorView<const float>(b)) == pairwise
+		&& MathVector::dot_product<MathVector::UnrolledAccumulation>(a.data(), b.data(), N) == unrolled;
+}
+
+bool accumulate_int()
+{
+	// Sums past INT_MAX are exact once widened
+	MathVector::Vector3<int> big(40000, 40000, 40000);
+	auto wide = MathVector::dot_product<MathVector::WidenedAccumulation>(big, big);
+	static_assert(std::is_same_v<decltype(wide), std::int64_t>);
+	if (wide != 4800000000)
+		return false;
+
+	std::uniform_int_distribution<int> range(-32768, 32767);
+	MathVector::Vector<short, 1001> a, b;
+	std::int64_t exact = 0;
+	for (auto i = 0U; i < a.size(); i++) {
+		a[i] = static_cast<short>(range(random_eng));
+		b[i] = static_cast<short>(range(random_eng));
+		exact += a[i] * b[i];
+	}
+	MathVector::Vector<unsigned, 5> u{4000000000U, 1, 2, 3, 4}, v{2, 1, 1, 1, 1};
+
+	MathVector::Vector<int, 37> c, d;
+	for (auto i = 0U; i < c.size(); i++) {
+		c[i] = number_range(random_eng) / 64;
+		d[i] = number_range(random_eng) / 64;
+	}
+	int plain = MathVector::dot_product(c, d);
+	return MathVector::dot_product<MathVector::WidenedAccumulation>(a, b) == exact
+		&& MathVector::dot_product<MathVector::WidenedAccumulation>(u, v) == 8000000010ULL
+		&& MathVector::dot_product<MathVector::SerialAccumulation>(c, d) == plain
+		&& MathVector::dot_product<MathVector::UnrolledAccumulation>(c, d) == plain
+		&& MathVector::dot_product<MathVector::PairwiseAccumulation>(c, d) == plain;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Functor free magnitudes
+/////////////////////////////////////////////////////////////////////
+
+template <class T>
+bool close_relative(T a, T b, T tolerance)
+{
+	return std::fabs(a - b) <= tolerance * std::fabs(b);
+}
+
+bool magnitude_single()
+{
+	MathVector::Vector2<double> right(3.0, 4.0);
+	MathVector::Vector3<int> integral(3, 4, 12);
+	auto unit = MathVector::unit_vector(right);
+	static_assert(std::is_same_v<decltype(MathVector::magnitude(integral)), double>);
+	if (MathVector::squared_magnitude(right) != 25 || MathVector::magnitude(right) != 5 || MathVector::scaled_magnitude(right) != 5
+		|| MathVector::fast_magnitude(right) != 5 || MathVector::magnitude(integral) != 13.0
+		|| !unit || !close_relative(unit->x, 0.6, 1e-15) || !close_relative(unit->y, 0.8, 1e-15)
+		|| MathVector::unit_vector(MathVector::Vector2<double>()))
+		return false;
+
+	// The squares overflow or underflow, hypot doesn't
+	MathVector::Vector3<float> huge(3e30f, 4e30f, 0.0f);
+	MathVector::Vector<float, 8> tiny;
+	tiny.fill(1e-30f);
+	MathVector::Vector3<float> infinite(1.0f, std::numeric_limits<float>::infinity(), 0.0f);
+	MathVector::Vector3<float> nan(1e30f, std::nanf(""), 1e30f);
+	if (MathVector::magnitude(huge) != std::numeric_limits<float>::infinity() || MathVector::magnitude(tiny) != 0
+		|| !close_relative(MathVector::scaled_magnitude(huge), 5e30f, 1e-6f)
+		|| !close_relative(MathVector::scaled_magnitude(tiny), std::sqrt(8.0f) * 1e-30f, 1e-6f)
+		|| MathVector::scaled_magnitude(infinite) != std::numeric_limits<float>::infinity()
+		|| !std::isnan(MathVector::scaled_magnitude(nan)))
+		return false;
+
+	auto random = random_vec16f(1)[0];
+	float exact = std::sqrt(MathVector::dot_product(random, random));
+	// A subnormal square has an infinite reciprocal square root estimate
+	MathVector::Vector<float, 4> small{1e-20f, 0.0f, 0.0f, 0.0f};
+	if (!close_relative(MathVector::fast_magnitude(random), exact, 1e-6f) || MathVector::fast_magnitude(vec16f{}) != 0
+		|| MathVector::fast_magnitude(small) != MathVector::magnitude(small) || !(MathVector::fast_magnitude(small) > 0))
+		return false;
+
+	// Run time length & sparse vectors
+	MathVector::Vector<float, 3> big{3e30f, 4e30f, 0.0f};
+	MathVector::DynamicVector<float> dynamic(big);
+	MathVector::SparseVector<float> sparse(big);
+	MathVector::VectorView<const float> view(random);
+	return MathVector::scaled_magnitude(dynamic) == MathVector::scaled_magnitude(huge)
+		&& MathVector::scaled_magnitude(sparse) == MathVector::scaled_magnitude(huge)
+		&& MathVector::magnitude(view) == exact && MathVector::squared_magnitude(sparse) == MathVector::squared_magnitude(huge)
+		&& close_relative(MathVector::fast_magnitude(view), exact, 1e-6f)
+		&& close_relative(MathVector::magnitude(*MathVector::unit_vector(MathVector::DynamicVector<float>(random))), 1.0f, 1e-6f)
+		&& close_relative(MathVector::magnitude(*MathVector::unit_vector(MathVector::SparseVector<float>(random))), 1.0f, 1e-6f);
+}
+
+bool magnitude_batch()
+{
+	// Odd count so the pack tails run, with some vectors out of range for the plain square root
+	const std::size_t count = 1001;
+	std::vector<MathVector::Vector3<float>> vcs;
+	for (auto i = 0U; i < count; i++)
+		vcs.emplace_back(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+	vcs[3] = vcs[3] * 1e37f;
+	vcs[500] = vcs[500] * 1e-35f;
+	vcs[7] = MathVector::Vector3<float>(1e-20f, 0.0f, 0.0f);
+	vcs[1000] = MathVector::Vector3<float>();
+	MathVector::VectorSoA<MathVector::Vector3<float>> soa(vcs.begin(), vcs.end());
+
+	std::vector<float> squared(count), exact(count), fast(count), scaled(count);
+	MathVector::batch_squared_magnitude(vcs, squared);
+	MathVector::batch_magnitude(vcs, exact);
+	MathVector::batch_fast_magnitude(vcs, fast);
+	MathVector::batch_scaled_magnitude(vcs, scaled);
+	std::vector<float> soa_squared(count), soa_fast(count), soa_scaled(count);
+	MathVector::batch_squared_magnitude(soa, soa_squared.data());
+	MathVector::batch_fast_magnitude(soa, soa_fast.data());
+	MathVector::batch_scaled_magnitude(soa, soa_scaled.data());
+
+	for (auto i = 0U; i < count; i++) {
+		float expected = MathVector::scaled_magnitude(vcs[i]);
+		if (squared[i] != MathVector::squared_magnitude(vcs[i]) || exact[i] != MathVector::magnitude(vcs[i])
+			|| scaled[i] != expected || !close_relative(soa_scaled[i], expected, 1e-6f))
+			return false;
+		if (i == 3 || i == 500)
+			continue;
+		if (!close_relative(fast[i], exact[i], 1e-6f) || !close_relative(soa_fast[i], exact[i], 1e-6f)
+			|| !close_relative(soa_squared[i], squared[i], 1e-6f))
+			return false;
+	}
+	return scaled[3] > 1e37f && scaled[500] > 0 && fast[1000] == 0 && soa_fast[1000] == 0
+		&& fast[7] == exact[7] && soa_fast[7] == exact[7] && fast[7] > 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Expression templates
+/////////////////////////////////////////////////////////////////////
+
+typedef MathVector::Vector<int, 8> vec8;
+
+vec8 random_vec8()
+{
+	vec8 vc;
+	for (auto& x : vc)
+		x = number_range(random_eng) / 64;
+	return vc;
+}
+
+bool expr_eval()
+{
+	auto a = random_vec8();
+	auto b = random_vec8();
+	auto c = random_vec8();
+	int s = number_range(random_eng) / 64;
+
+	vec8 eager = a + b * s - c;
+	vec8 lazy = MathVector::lazy(a) + MathVector::lazy(b) * s - c;
+	vec8 assigned = a;
+	assigned = -(MathVector::lazy(a) - b) + assigned;
+	vec8 compound = a;
+	compound += MathVector::lazy(b) * 2;
+
+	return lazy == eager
+		&& assigned == b
+		&& compound == a + b * 2
+		&& MathVector::evaluate(MathVector::lazy(c) * 3) == c * 3;
+}
+
+bool expr_dot()
+{
+	auto a = random_vec8();
+	auto b = random_vec8();
+	auto c = random_vec8();
+
+	return MathVector::dot_product(MathVector::lazy(a) + b, c) == MathVector::dot_product(a + b, c)
+		&& MathVector::dot_product(c, MathVector::lazy(a) - b) == MathVector::dot_product(c, a - b)
+		&& MathVector::dot_product(MathVector::lazy(a) * 2, MathVector::lazy(b) + c) == MathVector::dot_product(a * 2, b + c);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Structure of arrays
+/////////////////////////////////////////////////////////////////////
+
+bool soa_proxy()
+{
+	auto vc1 = MathVector::Vector3(number_range(random_eng), number_range(random_eng), number_range(random_eng));
+	auto vc2 = MathVector::Vector3(number_range(random_eng), number_range(random_eng), number_range(random_eng));
+	MathVector::VectorSoA<MathVector::Vector3<int>> soa(3);
+	soa[0] = vc1;
+	soa[1] = vc2;
+	soa[1] += vc1;
+	soa[2] = soa[0];
+	soa[2][1] = 7;
+
+	MathVector::Vector3<int> vc3 = soa[2];
+	return soa[0].get() == vc1 && soa[1].get() == vc1 + vc2
+		&& vc3 == MathVector::Vector3(vc1.x, 7, vc1.z)
+		&& soa.lane(2)[1] == vc1.z + vc2.z;
+}
+
+bool soa_kernels()
+{
+	// Odd count so both the packed & the tail path run
+	const std::size_t count = 37;
+	std::vector<MathVector::Vector3<float>> aos1, aos2;
+	for (auto i = 0U; i < count; i++) {
+		aos1.emplace_back(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+		aos2.emplace_back(float_number_range(random_eng), float_number_range(random_eng), float_number_range(random_eng));
+	}
+	MathVector::VectorSoA<MathVector::Vector3<float>> soa1(aos1.begin(), aos1.end());
+	MathVector::VectorSoA<MathVector::Vector3<float>> soa2(aos2.begin(), aos2.end());
+
+	std::vector<float> dots(count), magns(count);
+	MathVector::batch_dot(soa1, soa2, dots.data());
+	MathVector::batch_add(soa1, soa2);
+	MathVector::batch_scale(soa1, 2.0f);
+	MathVector::batch_sub(soa1, soa2);
+	MathVector::batch_magnitude(soa1, magns.data());
+
+	for (auto i = 0U; i < count; i++) {
+		auto expected = (aos1[i] + aos2[i]) * 2.0f - aos2[i];
+		if (soa1[i].get() != expected)
+			return false;
+		if (std::fabs(dots[i] - MathVector::dot_product(aos1[i], aos2[i])) > 1e-3f)
+			return false;
+		if (std::fabs(magns[i] - std::sqrt(MathVector::dot_product(expected, expected))) > 1e-3f)
+			return false;
+	}
+	return true;
+}
+
+#define TEST_NUMBER 79
 #define STRING_LENGTH 18
 #define STRINGIFY(x) #x
 #define TO_STRING(x) STRINGIFY(x)
@@ -735,6 +2597,81 @@ int main()
 		"|vcn| stdc++17",
 		"unit vector",
 		"trivial",
+		// simd dispatch
+		"simd kernels",
+		"simd vector",
+		// batched dot products
+		"thread pool",
+		"dot matrix",
+		// normalization
+		"normalize aos",
+		"normalize soa",
+		// reductions
+		"reduce summary",
+		"reduce threads",
+		// arena allocator
+		"arena frames",
+		"arena soa",
+		// vector files
+		"file aos",
+		"file soa",
+		"file corrupt",
+		// text parsing
+		"text errors",
+		"text chunks",
+		// k-d tree
+		"kd nearest",
+		"kd radius",
+		// spatial hash
+		"hash pairs",
+		"hash neighbors",
+		// distance matrix
+		"distance matrix",
+		"distance top k",
+		// quantized vectors
+		"quant int8",
+		"quant half",
+		// matrices
+		"matrix compose",
+		"matrix batch",
+		// quaternions
+		"quat ops",
+		"quat batch",
+		// cross product & meshes
+		"cross product",
+		"mesh normals",
+		// particle integration
+		"integrate euler",
+		"integrate verlet",
+		// barnes-hut
+		"nbody exact",
+		"nbody approx",
+		// compile time unrolling
+		"unroll constexpr",
+		"unroll get",
+		// dynamic vectors
+		"dynamic ops",
+		"dynamic views",
+		// sparse vectors
+		"sparse dense",
+		"sparse sparse",
+		// hnsw index
+		"hnsw search",
+		"hnsw threads",
+		"hnsw unreachable",
+		"hnsw file",
+		// dot product accumulation
+		"accumulate float",
+		"accumulate int",
+		// functor free magnitudes
+		"magnitude single",
+		"magnitude batch",
+		// expression templates
+		"expr eval",
+		"expr dot",
+		// soa
+		"soa proxy",
+		"soa kernels",
 	};
 	testfun func[TEST_NUMBER] = {
 		// vc2
@@ -769,6 +2706,81 @@ int main()
 		magn_n_17,
 		unit_vector,
 		trivial,
+		// simd dispatch
+		simd_kernels,
+		simd_vector,
+		// batched dot products
+		thread_pool,
+		dot_matrix,
+		// normalization
+		normalize_aos,
+		normalize_soa,
+		// reductions
+		reduce_summary,
+		reduce_determinism,
+		// arena allocator
+		arena_frames,
+		arena_soa,
+		// vector files
+		file_aos,
+		file_soa,
+		file_corrupt,
+		// text parsing
+		text_errors,
+		text_chunks,
+		// k-d tree
+		kd_nearest,
+		kd_radius,
+		// spatial hash
+		hash_pairs,
+		hash_neighbors,
+		// distance matrix
+		distance_matrix,
+		distance_top_k,
+		// quantized vectors
+		quant_int8,
+		quant_half,
+		// matrices
+		matrix_compose,
+		matrix_batch,
+		// quaternions
+		quat_ops,
+		quat_batch,
+		// cross product & meshes
+		cross_product,
+		mesh_normals,
+		// particle integration
+		integrate_euler,
+		integrate_verlet,
+		// barnes-hut
+		nbody_exact,
+		nbody_approx,
+		// compile time unrolling
+		unroll_constexpr,
+		unroll_get,
+		// dynamic vectors
+		dynamic_ops,
+		dynamic_views,
+		// sparse vectors
+		sparse_dense,
+		sparse_sparse,
+		// hnsw index
+		hnsw_search,
+		hnsw_threads,
+		hnsw_unreachable,
+		hnsw_file,
+		// dot product accumulation
+		accumulate_float,
+		accumulate_int,
+		// functor free magnitudes
+		magnitude_single,
+		magnitude_batch,
+		// expression templates
+		expr_eval,
+		expr_dot,
+		// soa
+		soa_proxy,
+		soa_kernels,
 	};
 
 	printf("No certainty this is correct.\n");